@@ -6,9 +6,18 @@
 #include "Session.h"
 
 #include "DatabaseModule.h"
+#include "WriteBatcher.h"
 #include "ApiProcessor.h"
+#include "AdminProcessor.h"
 #include "DoSProtectionModule.h"
+#include "LoadShedder.h"
+#include "AccessLog.h"
+#include "Tracer.h"
+#include "SlowLog.h"
+#include "Profiler.h"
+#include "StallWatchdog.h"
 #include "ServerConfig.h"
+#include "Logger.h"
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/thread.hpp>
@@ -18,6 +27,7 @@
 #include <iostream>
 #include <memory>
 #include <fstream>
+#include <optional>
 #include <sstream>
 
 void printConnectionInfo(tcp::socket& socket) {
@@ -26,12 +36,10 @@ void printConnectionInfo(tcp::socket& socket) {
         boost::asio::ip::address client_address = remote_ep.address();
         unsigned short client_port = remote_ep.port();
 
-        std::cout << "Client connected from: "
-            << client_address.to_string()
-            << ":" << client_port << std::endl;
+        LOG_DEBUG("Client connected from: " << client_address << ":" << client_port);
     }
     catch (const boost::system::system_error& e) {
-        std::cerr << "Error getting connection info: " << e.what() << std::endl;
+        LOG_WARN("Error getting connection info: " << e.what());
     }
 }
 
@@ -41,50 +49,120 @@ void CreateAPIHandlers(RequestHandler* module, ApiProcessor* apiProcessor) {
         apiProcessor->handleGetAllData(req, res);
         });
 
-    // Список сотрудников (можно оставить как есть, но лучше сделать отдельный обработчик позже)
-    module->addRouteHandler("/api/employees", [apiProcessor](const sRequest& req, sResponce& res) {
+    // Только сводка для дашборда (одна строка dashboard_summary)
+    module->addRouteHandler("/api/dashboard", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleGetDashboard(req, res);
+        });
+
+    // Список сотрудников: GET — постранично (?after_id=&limit=&fields=&status=), POST — добавление
+    module->addAsyncRouteHandler("/api/employees", [apiProcessor](const sRequest& req, sResponce&& res, RequestHandler::Responder done) {
         if (req.method() == http::verb::post) {
-            apiProcessor->handleAddEmployee(req, res);
+            return apiProcessor->handleAddEmployee(req, std::move(res), std::move(done));
         }
-        else if (req.method() == http::verb::get) {
-            apiProcessor->handleGetAllData(req, res); // временно ок — фронт пока не использует отдельно
+        if (req.method() == http::verb::get) {
+            apiProcessor->handleListEmployees(req, res);
         }
         else {
             res.result(http::status::method_not_allowed);
         }
+        done(std::move(res));
         });
 
-    module->addDynamicRouteHandler("/api/employees/\\d+(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
+    // Отдельные списки по ресурсам — те же параметры пагинации и проекции
+    module->addRouteHandler("/api/hours", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleListHours(req, res);
+        });
+    module->addRouteHandler("/api/penalties", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleListPenalties(req, res);
+        });
+    module->addRouteHandler("/api/bonuses", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleListBonuses(req, res);
+        });
+
+    // Пакетная запись: JSON-массив или NDJSON, одна транзакция на весь пакет
+    module->addRouteHandler("/api/employees/batch", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleBatchAddEmployees(req, res);
+        });
+    module->addRouteHandler("/api/hours/batch", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleBatchUpsertHours(req, res);
+        });
+    module->addRouteHandler("/api/penalties/batch", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleBatchAddPenalties(req, res);
+        });
+    module->addRouteHandler("/api/bonuses/batch", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleBatchAddBonuses(req, res);
+        });
+
+    // Изменения идут через ApiProcessor::submitWrite — при включённом групповом коммите ответ отложенный
+    module->addAsyncDynamicRouteHandler("/api/employees/\\d+(?:/)?", [apiProcessor](const sRequest& req, sResponce&& res, RequestHandler::Responder done) {
         if (req.method() == http::verb::put) {
-            apiProcessor->handleUpdateEmployee(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
+            return apiProcessor->handleUpdateEmployee(req, std::move(res), std::move(done));
         }
+        res.result(http::status::method_not_allowed);
+        done(std::move(res));
         });
-    module->addDynamicRouteHandler("/api/hours/\\d+(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
+    module->addAsyncDynamicRouteHandler("/api/hours/\\d+(?:/)?", [apiProcessor](const sRequest& req, sResponce&& res, RequestHandler::Responder done) {
         if (req.method() == http::verb::post) {
-            apiProcessor->handleAddHours(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
+            return apiProcessor->handleAddHours(req, std::move(res), std::move(done));
         }
+        res.result(http::status::method_not_allowed);
+        done(std::move(res));
         });
-    module->addDynamicRouteHandler("/api/employees/\\d+/penalties(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
+    module->addAsyncDynamicRouteHandler("/api/employees/\\d+/penalties(?:/)?", [apiProcessor](const sRequest& req, sResponce&& res, RequestHandler::Responder done) {
         if (req.method() == http::verb::post) {
-            apiProcessor->handleAddPenalty(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
+            return apiProcessor->handleAddPenalty(req, std::move(res), std::move(done));
         }
+        res.result(http::status::method_not_allowed);
+        done(std::move(res));
         });
-    module->addDynamicRouteHandler("/api/employees/\\d+/bonuses(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
+    module->addAsyncDynamicRouteHandler("/api/employees/\\d+/bonuses(?:/)?", [apiProcessor](const sRequest& req, sResponce&& res, RequestHandler::Responder done) {
         if (req.method() == http::verb::post) {
-            apiProcessor->handleAddBonus(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
+            return apiProcessor->handleAddBonus(req, std::move(res), std::move(done));
         }
+        res.result(http::status::method_not_allowed);
+        done(std::move(res));
+        });
+}
+
+// Служебные эндпоинты — только на admin-слушателе (--admin-port), с токеном
+void CreateAdminHandlers(RequestHandler* module, AdminProcessor* admin) {
+    // Кэш файлов: статистика и очистка, прогрев и вытеснение маршрутов, бюджет
+    module->addRouteHandler("/admin/cache", [admin](const sRequest& req, sResponce& res) {
+        admin->handleCache(req, res);
+        });
+    module->addRouteHandler("/admin/cache/warm", [admin](const sRequest& req, sResponce& res) {
+        admin->handleCacheWarm(req, res);
+        });
+    module->addRouteHandler("/admin/cache/evict", [admin](const sRequest& req, sResponce& res) {
+        admin->handleCacheEvict(req, res);
+        });
+    module->addRouteHandler("/admin/cache/budget", [admin](const sRequest& req, sResponce& res) {
+        admin->handleCacheBudget(req, res);
+        });
+
+    // Лимиты и клиенты DoSProtection, открытые сессии
+    module->addRouteHandler("/admin/limits", [admin](const sRequest& req, sResponce& res) {
+        admin->handleLimits(req, res);
+        });
+    module->addRouteHandler("/admin/clients", [admin](const sRequest& req, sResponce& res) {
+        admin->handleClients(req, res);
+        });
+    module->addRouteHandler("/admin/clients/unban", [admin](const sRequest& req, sResponce& res) {
+        admin->handleUnban(req, res);
+        });
+    module->addRouteHandler("/admin/sessions", [admin](const sRequest& req, sResponce& res) {
+        admin->handleSessions(req, res);
+        });
+
+    // Диагностика: медленные запросы, зависания цикла событий, CPU-профиль
+    module->addRouteHandler("/admin/slow", [admin](const sRequest& req, sResponce& res) {
+        admin->handleSlow(req, res);
+        });
+    module->addRouteHandler("/admin/stalls", [admin](const sRequest& req, sResponce& res) {
+        admin->handleStalls(req, res);
+        });
+    module->addAsyncRouteHandler("/admin/profile", [admin](const sRequest& req, sResponce&& res, RequestHandler::Responder done) {
+        admin->handleProfile(req, std::move(res), std::move(done));
         });
 }
 
@@ -106,6 +184,7 @@ void CreateNewHandlers(RequestHandler* module, std::string staticFolder) {
 
 int main(int argc, char* argv[]) {
     const ServerConfig config = ServerConfig::parse(argc, argv);
+    Logger::instance().setLevel(config.log_level);
 
 #ifdef _WIN32
     std::cout << "Console CP: " << GetConsoleCP() << std::endl;
@@ -127,18 +206,72 @@ int main(int argc, char* argv[]) {
     ModuleRegistry registry;
     auto* cacheModule = registry.registerModule<FileCache>(config.directory.c_str(), true, 100);
     auto* requestModule = registry.registerModule<RequestHandler>();
-    auto* dosProtectionModule = registry.registerModule<DoSProtectionModule>();
+    auto* adminModule = registry.registerModule<RequestHandler>("Admin Request Handler");
+    auto* dosProtectionModule = registry.registerModule<DoSProtectionModule>(ioc);
+    dosProtectionModule->setConnectionLimit(config.connection_limit);
+    for (size_t i = 0; i < kRouteClassCount; ++i) {
+        dosProtectionModule->setRouteLimit(static_cast<RouteClass>(i), config.route_limits[i]);
+    }
+    dosProtectionModule->setMaxConnectionsPerIp(config.max_connections_per_ip);
+    for (const auto& [cidrs, action] : { std::pair{ &config.allow_cidrs, CidrAction::Allow },
+                                         std::pair{ &config.deny_cidrs, CidrAction::Deny } }) {
+        for (const auto& cidr : *cidrs) {
+            std::string error;
+            if (!dosProtectionModule->addCidrRule(cidr, action, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    auto* loadShedder = registry.registerModule<LoadShedder>(ioc);
+    loadShedder->setTargets(std::chrono::milliseconds(config.shed_lag_ms),
+        std::chrono::milliseconds(config.shed_latency_ms));
+    loadShedder->addLowPriorityPath("/api/all-data");  // Полная перезагрузка — отдаём первой
+    AccessLog::Options accessLogOptions;
+    accessLogOptions.path = config.access_log;
+    accessLogOptions.max_bytes = static_cast<std::uint64_t>(config.access_log_max_mb) * 1024 * 1024;
+    accessLogOptions.max_age = std::chrono::hours(config.access_log_rotate_hours);
+    accessLogOptions.keep_files = static_cast<unsigned>(config.access_log_keep);
+    auto* accessLog = registry.registerModule<AccessLog>(accessLogOptions);
+    Tracer::Options tracerOptions;
+    tracerOptions.file.path = config.trace_file;
+    tracerOptions.sample_ratio = config.trace_sample;
+    auto* tracer = registry.registerModule<Tracer>(tracerOptions);
+    SlowLog::Options slowLogOptions;
+    slowLogOptions.connection_string = databaseStr;
+    slowLogOptions.request_threshold = std::chrono::milliseconds(config.slow_request_ms);
+    slowLogOptions.query_threshold = std::chrono::milliseconds(config.slow_query_ms);
+    slowLogOptions.explain_rate = config.slow_explain_rate;
+    slowLogOptions.capacity = static_cast<size_t>(config.slow_log_size);
+    auto* slowLog = registry.registerModule<SlowLog>(slowLogOptions);
+    auto* profiler = registry.registerModule<Profiler>(ioc);
+    StallWatchdog::Options watchdogOptions;
+    watchdogOptions.threshold = std::chrono::milliseconds(config.stall_threshold_ms);
+    auto* watchdog = registry.registerModule<StallWatchdog>(watchdogOptions);
+    watchdog->watch(ioc, "main");
     auto* dbModule = registry.registerModule<DatabaseModule>(ioc, databaseStr);
+    auto* writeBatcher = registry.registerModule<WriteBatcher>(ioc, dbModule,
+        std::chrono::microseconds(config.group_commit_us), config.group_commit_max);
 
-    ApiProcessor apiProcessor(dbModule); //TODO: Не совсем подходит моей идеологии управления жизнью через реестр модулей. Однако это по сути обёртка
+    ApiProcessor apiProcessor(dbModule, writeBatcher); //TODO: Не совсем подходит моей идеологии управления жизнью через реестр модулей. Однако это по сути обёртка
 
     CreateAPIHandlers(requestModule, &apiProcessor);
 
+    AdminProcessor adminProcessor(cacheModule, dosProtectionModule, slowLog, profiler, watchdog);
+
+    CreateAdminHandlers(adminModule, &adminProcessor);
+
     CreateNewHandlers(requestModule, config.directory);
 
     registry.initializeAll();
 
     static_cast<RequestHandler*>(requestModule)->setFileCache(cacheModule);
+    requestModule->setRateLimiter(dosProtectionModule);
+    requestModule->setLoadShedder(loadShedder);
+    requestModule->setAccessLog(accessLog);
+    requestModule->setTracer(tracer);
+    requestModule->setSlowLog(slowLog);
+    adminModule->setAuthToken(config.admin_token);
 
 
 ///////////////////////////////////////////////////////////
@@ -156,22 +289,60 @@ int main(int argc, char* argv[]) {
                 [socket_ptr = socket, &do_accept_func, requestModule, &dosProtectionModule](beast::error_code ec) {
                     if (!ec) {
                         printConnectionInfo(*socket_ptr);
-                        std::string ip = (*socket_ptr).remote_endpoint().address().to_string();
-                        if (dosProtectionModule->isAllowed(ip)) {
-                            std::make_shared<session>(std::move(*socket_ptr), requestModule)->run();
+                        // Проверка по бинарному адресу — без строки на каждое соединение
+                        beast::error_code ep_ec;
+                        auto remote = socket_ptr->remote_endpoint(ep_ec);
+                        if (ep_ec) {
+                            // Клиент уже отвалился
                         }
                         else {
-                            std::cout << "[" << ip << "] Connection terminated: DoS protection triggered (rate limit exceeded)\n";
+                            DoSProtectionModule::ConnectionLease lease;
+                            switch (dosProtectionModule->admitConnection(remote.address(), lease)) {
+                            case DoSProtectionModule::Admission::Accepted:
+                                std::make_shared<session>(std::move(*socket_ptr), requestModule, std::move(lease))->run();
+                                break;
+                            case DoSProtectionModule::Admission::Denied:
+                                LOG_WARN("[" << remote.address() << "] Connection terminated: address is in deny list");
+                                break;
+                            case DoSProtectionModule::Admission::RateLimited:
+                                LOG_WARN("[" << remote.address() << "] Connection terminated: DoS protection triggered (rate limit exceeded)");
+                                break;
+                            case DoSProtectionModule::Admission::TooManyConnections:
+                                LOG_WARN("[" << remote.address() << "] Connection terminated: too many open connections");
+                                break;
+                            }
                         }
                     }
                     else {
-                        std::cerr << "Accept error: " << ec.message() << std::endl;
+                        LOG_ERROR("Accept error: " << ec.message());
                     }
                     do_accept_func();  // Рекурсия via function call (safe)
                 });
             };
 
         do_accept_func();
+
+        // Admin API — отдельный слушатель (по умолчанию только localhost), без лимитов DoSProtection
+        std::optional<tcp::acceptor> adminAcceptor;
+        std::function<void()> do_admin_accept;
+        if (config.admin_port > 0) {
+            adminAcceptor.emplace(ioc, tcp::endpoint{ net::ip::make_address(config.admin_address),
+                static_cast<unsigned short>(config.admin_port) });
+            do_admin_accept = [&adminAcceptor, &do_admin_accept, adminModule]() {
+                adminAcceptor->async_accept([&do_admin_accept, adminModule](beast::error_code ec, tcp::socket socket) {
+                    if (!ec) {
+                        std::make_shared<session>(std::move(socket), adminModule)->run();
+                    }
+                    else {
+                        LOG_ERROR("Admin accept error: " << ec.message());
+                    }
+                    do_admin_accept();
+                    });
+                };
+            do_admin_accept();
+            std::cout << "Admin API on http://" << config.admin_address << ":" << config.admin_port << std::endl;
+        }
+
         ioc.run();  // Блокирует, обрабатывает все async
     }
     catch (const std::exception& e) {
@@ -0,0 +1,294 @@
+﻿#include "AdminProcessor.h"
+#include "FileCache.h"
+#include "DoSProtectionModule.h"
+#include "SlowLog.h"
+#include "Profiler.h"
+#include "StallWatchdog.h"
+#include "Session.h"
+
+#include <boost/asio/ip/address.hpp>
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+    std::string formatLimit(const RateLimit& limit) {
+        if (limit.unlimited()) return "0";
+        char buf[64];
+        std::snprintf(buf, sizeof buf, "%g:%g", limit.per_second, limit.burst);
+        return buf;
+    }
+
+    double seconds(std::chrono::steady_clock::duration d) {
+        return std::chrono::duration<double>(d).count();
+    }
+
+    int hexDigit(char ch) {
+        if (ch >= '0' && ch <= '9') return ch - '0';
+        if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+        if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+        return -1;
+    }
+
+    // Ключи PUT /admin/limits в порядке RouteClass
+    constexpr std::array<const char*, kRouteClassCount> kRouteLimitKeys = { "static", "api-read", "api-write" };
+}
+
+AdminProcessor::AdminProcessor(FileCache* cache, DoSProtectionModule* limiter, SlowLog* slow_log,
+    Profiler* profiler, StallWatchdog* watchdog)
+    : cache_(cache), limiter_(limiter), slow_log_(slow_log), profiler_(profiler), watchdog_(watchdog) {
+}
+
+void AdminProcessor::sendJson(http::response<http::string_body>& res, const bj::value& body) {
+    res.result(http::status::ok);
+    res.set(http::field::content_type, "application/json");
+    res.set(http::field::cache_control, "no-store");
+    res.body() = bj::serialize(body);
+}
+
+void AdminProcessor::sendJsonError(http::response<http::string_body>& res, http::status status,
+    const std::string& message) {
+    bj::object err;
+    err["error"] = message;
+    res.result(status);
+    res.set(http::field::content_type, "application/json");
+    res.set(http::field::cache_control, "no-store");
+    res.body() = bj::serialize(err);
+}
+
+bool AdminProcessor::requireMethod(const sRequest& req, http::response<http::string_body>& res, http::verb method) {
+    if (req.method() == method) return true;
+    const auto name = http::to_string(method);
+    sendJsonError(res, http::status::method_not_allowed, "Only " + std::string(name.data(), name.size()) + " allowed");
+    return false;
+}
+
+std::optional<std::string> AdminProcessor::queryParam(std::string_view target, std::string_view name) {
+    const auto pos = target.find('?');
+    if (pos == std::string_view::npos) return std::nullopt;
+    std::string_view query = target.substr(pos + 1);
+    while (!query.empty()) {
+        const auto amp = query.find('&');
+        const std::string_view pair = query.substr(0, amp);
+        query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+
+        const auto eq = pair.find('=');
+        if (pair.substr(0, eq) != name) continue;
+        if (eq == std::string_view::npos) return std::string();
+
+        std::string value;
+        const std::string_view raw = pair.substr(eq + 1);
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] == '%' && i + 2 < raw.size() && hexDigit(raw[i + 1]) >= 0 && hexDigit(raw[i + 2]) >= 0) {
+                value += static_cast<char>(hexDigit(raw[i + 1]) * 16 + hexDigit(raw[i + 2]));
+                i += 2;
+            }
+            else {
+                value += raw[i] == '+' ? ' ' : raw[i];
+            }
+        }
+        return value;
+    }
+    return std::nullopt;
+}
+
+std::optional<long long> AdminProcessor::parseInteger(const std::string& text) {
+    long long value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || end != text.data() + text.size()) return std::nullopt;
+    return value;
+}
+
+void AdminProcessor::handleCache(const sRequest& req, http::response<http::string_body>& res) {
+    if (req.method() == http::verb::delete_) {
+        cache_->clear_cache();
+        return sendJson(res, bj::object{ { "cleared", true } });
+    }
+    if (!requireMethod(req, res, http::verb::get)) return;
+
+    const auto info = cache_->get_cache_info();
+    const auto stats = cache_->get_detailed_stats();
+    const auto now = std::chrono::system_clock::now();
+
+    bj::object out;
+    out["enabled"] = info.cache_enabled;
+    out["cachedFiles"] = info.cached_files_count;
+    out["maxFiles"] = info.max_cache_size;
+    out["routes"] = info.total_routes_count;
+    out["bytes"] = info.total_cache_size_bytes;
+    out["hits"] = info.hits;
+    out["misses"] = info.misses;
+    out["evictions"] = info.evictions;
+    bj::array files;
+    files.reserve(stats.files.size());
+    for (const auto& file : stats.files) {
+        bj::object item;
+        item["route"] = file.route;
+        item["bytes"] = file.size;
+        item["idleSec"] = std::chrono::duration<double>(now - file.last_accessed).count();
+        files.push_back(std::move(item));
+    }
+    out["files"] = std::move(files);
+    sendJson(res, out);
+}
+
+void AdminProcessor::handleCacheWarm(const sRequest& req, http::response<http::string_body>& res) {
+    if (!requireMethod(req, res, http::verb::post)) return;
+    const auto route = queryParam(std::string_view(req.target().data(), req.target().size()), "route");
+    if (!route || route->empty()) return sendJsonError(res, http::status::bad_request, "route is required");
+    if (!cache_->preload_file(*route)) return sendJsonError(res, http::status::not_found, "Unknown route: " + *route);
+    sendJson(res, bj::object{ { "route", *route }, { "cached", true } });
+}
+
+void AdminProcessor::handleCacheEvict(const sRequest& req, http::response<http::string_body>& res) {
+    if (!requireMethod(req, res, http::verb::post)) return;
+    const auto route = queryParam(std::string_view(req.target().data(), req.target().size()), "route");
+    if (!route || route->empty()) return sendJsonError(res, http::status::bad_request, "route is required");
+    sendJson(res, bj::object{ { "route", *route }, { "evicted", cache_->evict_from_cache(*route) } });
+}
+
+void AdminProcessor::handleCacheBudget(const sRequest& req, http::response<http::string_body>& res) {
+    if (!requireMethod(req, res, http::verb::put)) return;
+    const auto files = queryParam(std::string_view(req.target().data(), req.target().size()), "files");
+    const auto value = files ? parseInteger(*files) : std::nullopt;
+    if (!value || *value < 0) return sendJsonError(res, http::status::bad_request, "files must be a non-negative integer");
+    cache_->set_max_cache_size(static_cast<size_t>(*value));
+    sendJson(res, bj::object{ { "maxFiles", cache_->get_max_cache_size() } });
+}
+
+void AdminProcessor::handleLimits(const sRequest& req, http::response<http::string_body>& res) {
+    const std::string_view target(req.target().data(), req.target().size());
+    if (req.method() == http::verb::put) {
+        // Сначала проверяем все параметры, применяем только если верны все
+        std::optional<RateLimit> connections;
+        std::array<std::optional<RateLimit>, kRouteClassCount> routes;
+        std::optional<long long> per_ip;
+        if (auto text = queryParam(target, "connections")) {
+            if (!(connections = RateLimit::parse(*text))) {
+                return sendJsonError(res, http::status::bad_request, "connections must look like rate:burst");
+            }
+        }
+        for (size_t i = 0; i < kRouteClassCount; ++i) {
+            if (auto text = queryParam(target, kRouteLimitKeys[i])) {
+                if (!(routes[i] = RateLimit::parse(*text))) {
+                    return sendJsonError(res, http::status::bad_request,
+                        std::string(kRouteLimitKeys[i]) + " must look like rate:burst");
+                }
+            }
+        }
+        if (auto text = queryParam(target, "max_connections_per_ip")) {
+            per_ip = parseInteger(*text);
+            if (!per_ip || *per_ip < 0 || *per_ip > 1000000) {
+                return sendJsonError(res, http::status::bad_request, "max_connections_per_ip must be >= 0");
+            }
+        }
+
+        if (connections) limiter_->setConnectionLimit(*connections);
+        for (size_t i = 0; i < kRouteClassCount; ++i) {
+            if (routes[i]) limiter_->setRouteLimit(static_cast<RouteClass>(i), *routes[i]);
+        }
+        if (per_ip) limiter_->setMaxConnectionsPerIp(static_cast<int>(*per_ip));
+    }
+    else if (!requireMethod(req, res, http::verb::get)) {
+        return;
+    }
+
+    bj::object out;
+    out["connections"] = formatLimit(limiter_->connectionLimit());
+    for (size_t i = 0; i < kRouteClassCount; ++i) {
+        out[kRouteLimitKeys[i]] = formatLimit(limiter_->routeLimit(static_cast<RouteClass>(i)));
+    }
+    out["max_connections_per_ip"] = limiter_->maxConnectionsPerIp();
+    sendJson(res, out);
+}
+
+void AdminProcessor::handleClients(const sRequest& req, http::response<http::string_body>& res) {
+    if (!requireMethod(req, res, http::verb::get)) return;
+    long long limit = 100;
+    if (auto text = queryParam(std::string_view(req.target().data(), req.target().size()), "limit")) {
+        auto parsed = parseInteger(*text);
+        if (!parsed || *parsed <= 0) return sendJsonError(res, http::status::bad_request, "limit must be a positive integer");
+        limit = *parsed;
+    }
+
+    bj::array clients;
+    for (const auto& client : limiter_->listClients(static_cast<size_t>(limit))) {
+        bj::object item;
+        item["ip"] = client.key.toAddress().to_string();
+        item["openConnections"] = client.open_connections;
+        item["idleSec"] = seconds(client.idle);
+        item["bannedForSec"] = seconds(client.banned_for);
+        clients.push_back(std::move(item));
+    }
+    bj::object out;
+    out["tracked"] = limiter_->trackedClients();
+    out["clients"] = std::move(clients);
+    sendJson(res, out);
+}
+
+void AdminProcessor::handleUnban(const sRequest& req, http::response<http::string_body>& res) {
+    if (!requireMethod(req, res, http::verb::post)) return;
+    const auto ip = queryParam(std::string_view(req.target().data(), req.target().size()), "ip");
+    boost::system::error_code ec;
+    const auto address = ip ? boost::asio::ip::make_address(*ip, ec) : boost::asio::ip::address{};
+    if (!ip || ec) return sendJsonError(res, http::status::bad_request, "ip must be an IPv4 or IPv6 address");
+    sendJson(res, bj::object{ { "ip", address.to_string() }, { "found", limiter_->unban(address) } });
+}
+
+void AdminProcessor::handleSessions(const sRequest& req, http::response<http::string_body>& res) {
+    if (!requireMethod(req, res, http::verb::get)) return;
+    sendJson(res, bj::object{ { "open", session::openCount() }, { "trackedClients", limiter_->trackedClients() } });
+}
+
+void AdminProcessor::handleSlow(const sRequest& req, http::response<http::string_body>& res) {
+    if (!requireMethod(req, res, http::verb::get)) return;
+    sendJson(res, slow_log_->report());
+}
+
+void AdminProcessor::handleStalls(const sRequest& req, http::response<http::string_body>& res) {
+    if (!requireMethod(req, res, http::verb::get)) return;
+    sendJson(res, watchdog_->report());
+}
+
+void AdminProcessor::handleProfile(const sRequest& req, http::response<http::string_body>&& res, Responder done) {
+    if (!requireMethod(req, res, http::verb::get)) return done(std::move(res));
+
+    const std::string_view target(req.target().data(), req.target().size());
+    auto readInt = [&](const char* name, long long fallback) -> std::optional<long long> {
+        auto text = queryParam(target, name);
+        return text ? parseInteger(*text) : fallback;
+    };
+    const auto secs = readInt("seconds", 10);
+    const auto hz = readInt("hz", 99);
+    if (!secs || !hz || *secs < 1 || *secs > Profiler::kMaxSeconds || *hz < 1 || *hz > Profiler::kMaxHz) {
+        sendJsonError(res, http::status::bad_request, "seconds must be 1-" + std::to_string(Profiler::kMaxSeconds)
+            + ", hz must be 1-" + std::to_string(Profiler::kMaxHz));
+        return done(std::move(res));
+    }
+    if (!profiler_->available()) {
+        sendJsonError(res, http::status::not_implemented, "Profiling is not available on this platform");
+        return done(std::move(res));
+    }
+
+    const bool started = profiler_->start(std::chrono::seconds(*secs), static_cast<int>(*hz),
+        [res, done](Profiler::Result&& result) mutable {
+            if (!result.error.empty()) {
+                sendJsonError(res, http::status::internal_server_error, result.error);
+            }
+            else {
+                res.result(http::status::ok);
+                res.set(http::field::content_type, "text/plain; charset=utf-8");
+                res.set(http::field::cache_control, "no-store");
+                res.set("X-Profile-Samples", std::to_string(result.samples));
+                res.set("X-Profile-Dropped", std::to_string(result.dropped));
+                res.body() = std::move(result.collapsed);
+            }
+            done(std::move(res));
+        });
+    if (!started) {
+        sendJsonError(res, http::status::conflict, "Another profile is already running");
+        done(std::move(res));
+    }
+}
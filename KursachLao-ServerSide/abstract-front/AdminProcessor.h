@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <boost/json.hpp>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "macros.h"  // Для http::request, http::response и т.д.
+
+class FileCache;
+class DoSProtectionModule;
+class SlowLog;
+class Profiler;
+class StallWatchdog;
+
+namespace bj = boost::json;
+namespace http = boost::beast::http;
+
+// Служебный API (отдельный слушатель с токеном, см. --admin-port): состояние и настройка
+// модулей на ходу — кэш файлов, лимиты и клиенты DoSProtection, сессии, диагностика.
+// Обработчики выполняются на потоке io_context, как и сами модули, поэтому изменения
+// настроек не требуют синхронизации. Параметры — в query-строке, ответы — JSON.
+class AdminProcessor {
+public:
+    using Responder = std::function<void(http::response<http::string_body>&&)>;
+
+    AdminProcessor(FileCache* cache, DoSProtectionModule* limiter, SlowLog* slow_log,
+        Profiler* profiler, StallWatchdog* watchdog);
+
+    // GET /admin/cache — размеры и файлы; DELETE — очистить
+    void handleCache(const sRequest& req, http::response<http::string_body>& res);
+    // POST /admin/cache/warm?route=/index.html — загрузить заранее
+    void handleCacheWarm(const sRequest& req, http::response<http::string_body>& res);
+    // POST /admin/cache/evict?route=/index.html
+    void handleCacheEvict(const sRequest& req, http::response<http::string_body>& res);
+    // PUT /admin/cache/budget?files=N — сколько файлов держать в памяти
+    void handleCacheBudget(const sRequest& req, http::response<http::string_body>& res);
+
+    // GET /admin/limits; PUT ?connections=&static=&api-read=&api-write=&max_connections_per_ip=
+    void handleLimits(const sRequest& req, http::response<http::string_body>& res);
+    // GET /admin/clients?limit=100 — сначала заблокированные
+    void handleClients(const sRequest& req, http::response<http::string_body>& res);
+    // POST /admin/clients/unban?ip=10.0.0.5
+    void handleUnban(const sRequest& req, http::response<http::string_body>& res);
+    // GET /admin/sessions
+    void handleSessions(const sRequest& req, http::response<http::string_body>& res);
+
+    void handleSlow(const sRequest& req, http::response<http::string_body>& res);
+    void handleStalls(const sRequest& req, http::response<http::string_body>& res);
+    // GET /admin/profile?seconds=10&hz=99 — ответ через seconds, collapsed stacks
+    void handleProfile(const sRequest& req, http::response<http::string_body>&& res, Responder done);
+
+private:
+    FileCache* cache_;
+    DoSProtectionModule* limiter_;
+    SlowLog* slow_log_;
+    Profiler* profiler_;
+    StallWatchdog* watchdog_;
+
+    static void sendJson(http::response<http::string_body>& res, const bj::value& body);
+    static void sendJsonError(http::response<http::string_body>& res, http::status status, const std::string& message);
+    static bool requireMethod(const sRequest& req, http::response<http::string_body>& res, http::verb method);
+
+    // Значение параметра query-строки с %XX-декодированием; nullopt — параметра нет
+    static std::optional<std::string> queryParam(std::string_view target, std::string_view name);
+    static std::optional<long long> parseInteger(const std::string& text);
+};
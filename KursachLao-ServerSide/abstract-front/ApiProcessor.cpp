@@ -1,10 +1,21 @@
 ﻿#include "ApiProcessor.h"
 #include "DatabaseModule.h"
+#include "DatabaseMapper.h"
+#include "db_handlers.h"
+#include "ApiRequests.h"
+#include "MsgPack.h"
+#include "DbTime.h"
+#include "JsonEscape.h"
+#include "Tracer.h"
+#include "DbObserver.h"
 
 #include <boost/algorithm/string.hpp>
 #include <boost/json.hpp>
 #include <pqxx/pqxx>
 
+#include <algorithm>
+#include <charconv>
+#include <limits>
 #include <sstream>
 #include <iostream>
 #include <regex>
@@ -12,7 +23,113 @@
 namespace bj = boost::json;
 namespace http = boost::beast::http;
 
-ApiProcessor::ApiProcessor(DatabaseModule* db_module) : db_module_(db_module) {}
+struct ApiProcessor::ListResource {
+    struct Column {
+        const char* json;    // имя поля в ответе
+        const char* column;  // колонка в БД
+        bool numeric;        // выводить как число (без кавычек)
+        const char* type;    // имя типа для ?layout=columnar, см. columnTypeName
+    };
+
+    const char* table;
+    const char* key;                // колонка keyset-пагинации (уникальная, монотонная)
+    std::vector<Column> columns;    // первая колонка всегда key
+    const char* filter_param;       // необязательный фильтр равенства (?status=, ?employee_id=)
+    const char* filter_column;
+    bool filter_numeric;
+
+    // Колонки берутся из привязок модели (Models.h); первая колонка модели — ключ
+    template <MappedModel Model>
+    static ListResource fromModel(const char* filter_param = nullptr,
+        const char* filter_column = nullptr,
+        bool filter_numeric = false) {
+        ListResource resource{ ModelTraits<Model>::table, nullptr, {}, filter_param, filter_column, filter_numeric };
+        forEachColumn<Model>([&resource](const auto& binding) {
+            using T = typename std::decay_t<decltype(binding)>::value_type;
+            resource.columns.push_back({ binding.json, binding.column, std::is_arithmetic_v<T>, columnTypeName<T>() });
+        });
+        resource.key = resource.columns.front().column;
+        return resource;
+    }
+};
+
+namespace {
+    constexpr long long kDefaultPageLimit = 100;
+    constexpr long long kMaxPageLimit = 1000;
+
+    constexpr size_t kMaxBatchItems = 10000;
+
+    std::string_view trimOws(std::string_view s) {
+        auto begin = s.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) return {};
+        return s.substr(begin, s.find_last_not_of(" \t") - begin + 1);
+    }
+
+    // Следующий элемент списка через sep; list укорачивается на него
+    std::string_view nextToken(std::string_view& list, char sep) {
+        auto pos = list.find(sep);
+        auto token = list.substr(0, pos);
+        list = pos == std::string_view::npos ? std::string_view{} : list.substr(pos + 1);
+        return trimOws(token);
+    }
+
+    // Вес, с которым Accept допускает type/subtype (0 — не допускает). Решает самый
+    // конкретный подходящий диапазон: type/subtype, затем type/*, затем */*.
+    // Без заголовка годится всё (q=1)
+    double acceptQuality(std::string_view accept, std::string_view type, std::string_view subtype) {
+        if (trimOws(accept).empty()) return 1.0;
+
+        int best_specificity = -1;
+        double best_q = 0.0;
+        while (!accept.empty()) {
+            auto params = nextToken(accept, ',');
+            auto range = nextToken(params, ';');
+            auto slash = range.find('/');
+            if (slash == std::string_view::npos) continue;
+            auto range_type = trimOws(range.substr(0, slash));
+            auto range_subtype = trimOws(range.substr(slash + 1));
+
+            int specificity;
+            if (range_type == "*" && range_subtype == "*") specificity = 0;
+            else if (!boost::algorithm::iequals(range_type, type)) continue;
+            else if (range_subtype == "*") specificity = 1;
+            else if (boost::algorithm::iequals(range_subtype, subtype)) specificity = 2;
+            else continue;
+            if (specificity <= best_specificity) continue;
+
+            double q = 1.0;
+            bool valid = true;
+            while (!params.empty()) {
+                auto param = nextToken(params, ';');
+                auto eq = param.find('=');
+                if (eq == std::string_view::npos) continue;
+                if (!boost::algorithm::iequals(trimOws(param.substr(0, eq)), "q")) continue;
+                auto value = trimOws(param.substr(eq + 1));
+                auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), q);
+                valid = ec == std::errc{} && end == value.data() + value.size() && q >= 0.0 && q <= 1.0;
+                break;
+            }
+            if (!valid) continue;  // Кривой q — диапазон не учитываем
+
+            best_specificity = specificity;
+            best_q = q;
+        }
+        return best_q;
+    }
+
+    std::optional<long long> parseNonNegative(const std::string& value) {
+        if (value.empty() || value.size() > 18) return std::nullopt;
+        long long result = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') return std::nullopt;
+            result = result * 10 + (c - '0');
+        }
+        return result;
+    }
+}
+
+ApiProcessor::ApiProcessor(DatabaseModule* db_module, WriteBatcher* write_batcher)
+    : db_module_(db_module), write_batcher_(write_batcher) {}
 
 pqxx::connection* ApiProcessor::getConn() {
     if (!db_module_ || !db_module_->isDatabaseReady()) {
@@ -32,46 +149,28 @@ void ApiProcessor::sendJsonError(http::response<http::string_body>& res,
     res.prepare_payload();
 }
 
-bj::object ApiProcessor::employeeToJson(const pqxx::row& row) {
-    bj::object obj;
-    obj["id"] = row["id"].as<int>();
-    obj["fullname"] = row["fullname"].c_str();
-    obj["status"] = row["status"].c_str();
-    obj["salary"] = row["salary"].as<double>();
-    obj["penalties"] = row["penalties_count"].as<int>();
-    obj["bonuses"] = row["bonuses_count"].as<int>();
-    obj["totalPenalties"] = row["total_penalties"].as<double>();
-    obj["totalBonuses"] = row["total_bonuses"].as<double>();
-    return obj;
-}
-
-bj::object ApiProcessor::hoursToJson(const pqxx::row& row) {
-    bj::object obj;
-    obj["employeeId"] = row["employee_id"].as<int>();
-    obj["regularHours"] = row["regular_hours"].as<double>();
-    obj["overtime"] = row["overtime"].as<double>();
-    obj["undertime"] = row["undertime"].as<double>();
-    return obj;
-}
-
-bj::object ApiProcessor::penaltyToJson(const pqxx::row& row) {
-    bj::object obj;
-    obj["id"] = row["id"].as<int>();
-    obj["employeeId"] = row["employee_id"].as<int>();
-    obj["reason"] = row["reason"].c_str();
-    obj["amount"] = row["amount"].as<double>();
-    obj["date"] = row["created_at"].c_str();
-    return obj;
-}
-
-bj::object ApiProcessor::bonusToJson(const pqxx::row& row) {
-    bj::object obj;
-    obj["id"] = row["id"].as<int>();
-    obj["employeeId"] = row["employee_id"].as<int>();
-    obj["note"] = row["note"].c_str();
-    obj["amount"] = row["amount"].as<double>();
-    obj["date"] = row["created_at"].c_str();
-    return obj;
+ApiProcessor::BodyFormat ApiProcessor::negotiateFormat(const sRequest& req) {
+    auto header = req[http::field::accept];
+    std::string_view accept(header.data(), header.size());
+
+    // MessagePack только если клиент предпочёл его строго выше JSON; при равенстве — JSON
+    double json_q = acceptQuality(accept, "application", "json");
+    double msgpack_q = std::max(acceptQuality(accept, "application", "msgpack"),
+        acceptQuality(accept, "application", "x-msgpack"));
+    return msgpack_q > json_q ? BodyFormat::MsgPack : BodyFormat::Json;
+}
+
+void ApiProcessor::writeBody(http::response<http::string_body>& res, const bj::value& body, BodyFormat format) {
+    Tracer::Span span("serialize");
+    if (format == BodyFormat::MsgPack) {
+        res.set(http::field::content_type, "application/msgpack");
+        res.body() = msgpack::encode(body);
+    }
+    else {
+        res.set(http::field::content_type, "application/json");
+        res.body() = bj::serialize(body);
+    }
+    res.set(http::field::vary, "Accept");
 }
 
 std::optional<std::string> ApiProcessor::getQueryParam(const std::string& target,
@@ -103,7 +202,7 @@ std::optional<int> ApiProcessor::parseIdFromPath(const std::string& path,
     return std::nullopt;
 }
 
-void ApiProcessor::handleGetAllData(const http::request<http::string_body>& req,
+void ApiProcessor::handleGetAllData(const sRequest& req,
     http::response<http::string_body>& res) {
     auto* conn = getConn();
     if (!conn) {
@@ -116,66 +215,18 @@ void ApiProcessor::handleGetAllData(const http::request<http::string_body>& req,
 
     std::string target_str = std::string(req.target());
     auto since_opt = getQueryParam(target_str, "since");
-    std::string since_clause;
-    if (since_opt) {
-        since_clause = " WHERE updated_at > " + conn->quote(*since_opt);
-    }
 
     try {
-        pqxx::work txn(*conn);
-
-        bj::object dashboard;
-        auto agg = txn.exec(
-            "SELECT "
-            "COALESCE(SUM(penalties_count), 0) AS penalties, "
-            "COALESCE(SUM(bonuses_count), 0) AS bonuses, "
-            "COALESCE(SUM(wh.undertime), 0) AS undertime "
-            "FROM employees e "
-            "LEFT JOIN work_hours wh ON e.id = wh.employee_id "
-            "WHERE e.status = 'hired'");
-
-        dashboard["penalties"] = agg[0]["penalties"].as<int64_t>();
-        dashboard["bonuses"] = agg[0]["bonuses"].as<int64_t>();
-        dashboard["undertime"] = agg[0]["undertime"].as<double>();
-
-        bj::array employees_arr;
-        auto emp_res = txn.exec(pqxx::zview("SELECT * FROM employees" + since_clause));
-        for (const auto& row : emp_res) employees_arr.emplace_back(employeeToJson(row));
-
-        bj::array hours_arr;
-        auto hours_res = txn.exec(pqxx::zview("SELECT * FROM work_hours" + since_clause));
-        for (const auto& row : hours_res) hours_arr.emplace_back(hoursToJson(row));
-
-        bj::array penalties_arr;
-        auto pen_res = txn.exec(pqxx::zview("SELECT * FROM penalties" + since_clause));
-        for (const auto& row : pen_res) penalties_arr.emplace_back(penaltyToJson(row));
-
-        bj::array bonuses_arr;
-        auto bon_res = txn.exec(pqxx::zview("SELECT * FROM bonuses" + since_clause));
-        for (const auto& row : bon_res) bonuses_arr.emplace_back(bonusToJson(row));
-
-        auto last_res = txn.exec(pqxx::zview(R"(
-            SELECT GREATEST(
-                COALESCE((SELECT MAX(updated_at) FROM employees),  '1970-01-01'::timestamp),
-                COALESCE((SELECT MAX(updated_at) FROM work_hours),  '1970-01-01'::timestamp),
-                COALESCE((SELECT MAX(created_at) FROM penalties), '1970-01-01'::timestamp),
-                COALESCE((SELECT MAX(created_at) FROM bonuses),   '1970-01-01'::timestamp)
-            ) AS ts
-        )"));
-
-        std::string last_updated = last_res[0]["ts"].as<std::string>();
-
-        bj::object response;
-        response["dashboard"] = dashboard;
-        response["employees"] = std::move(employees_arr);
-        response["hours"] = std::move(hours_arr);
-        response["penalties"] = std::move(penalties_arr);
-        response["bonuses"] = std::move(bonuses_arr);
-        response["lastUpdated"] = last_updated;
+        DbTime::Scope db_time;
+        pqxx::read_transaction txn(*conn);
+        DatabaseMapper mapper(txn);
+        // Дерево ответа — на арене запроса: освобождается вместе с ней, без free() по узлам
+        bj::object response = HRDatabaseHandlers(mapper).getAllData(since_opt, jsonStorage(req.get_allocator()),
+            getQueryParam(target_str, "layout") == "columnar");
+        txn.commit();
 
         res.result(http::status::ok);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(response);
+        writeBody(res, bj::value(std::move(response)), negotiateFormat(req));
         res.prepare_payload();
     }
     catch (const std::exception& e) {
@@ -183,289 +234,637 @@ void ApiProcessor::handleGetAllData(const http::request<http::string_body>& req,
     }
 }
 
-void ApiProcessor::handleAddEmployee(const http::request<http::string_body>& req,
+void ApiProcessor::handleGetDashboard(const sRequest& req,
     http::response<http::string_body>& res) {
     auto* conn = getConn();
-    if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
-
-    if (req.method() != http::verb::post) {
-        return sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
+    if (!conn) {
+        return sendJsonError(res, http::status::service_unavailable, "Database not ready");
     }
 
-    //std::cout << "Received request target: " << req.target() << std::endl;
-    //std::cout << "Received body: |" << req.body() << "|" << std::endl;
+    if (req.method() != http::verb::get) {
+        return sendJsonError(res, http::status::method_not_allowed, "Only GET allowed");
+    }
 
     try {
-        bj::value jv = bj::parse(req.body());
-        if (jv.is_array()) {
-            std::cout << "Received unexpected array instead of object" << std::endl;
-            return sendJsonError(res, http::status::bad_request, "Expected JSON object, got array");
-        }
-        if (!jv.is_object()) {
-            return sendJsonError(res, http::status::bad_request, "Invalid JSON: not an object");
-        }
-        const bj::object& body = jv.as_object();
+        DbTime::Scope db_time;
+        pqxx::read_transaction txn(*conn);
+        DatabaseMapper mapper(txn);
+        Dashboard dashboard = HRDatabaseHandlers(mapper).getDashboard();
+        txn.commit();
 
-        std::string fullname = std::string(body.at("fullname").as_string());
-        std::string status = std::string(body.at("status").as_string());
-        double salary = 0.0;
-        if (body.at("salary").is_int64()) {
-            salary = static_cast<double>(body.at("salary").as_int64());
-        }
-        else if (body.at("salary").is_double()) {
-            salary = body.at("salary").as_double();
-        }
-        else {
-            return sendJsonError(res, http::status::bad_request, "Salary must be a number");
-        }
-        if (fullname.size() < 3) return sendJsonError(res, http::status::bad_request, "Fullname too short");
-        if (status != "hired" && status != "fired" && status != "interview") {
-            return sendJsonError(res, http::status::bad_request, "Invalid status");
-        }
-        if (salary <= 0) return sendJsonError(res, http::status::bad_request, "Salary must be > 0");
+        res.result(http::status::ok);
+        writeBody(res, bj::value_from(dashboard), negotiateFormat(req));
+        res.prepare_payload();
+    }
+    catch (const std::exception& e) {
+        sendJsonError(res, http::status::internal_server_error, e.what());
+    }
+}
+
+void ApiProcessor::submitWrite(http::response<http::string_body>&& res, Responder done, WriteBatcher::Apply apply) {
+    if (!apply) {
+        // prepare* уже записал ошибку в res
+        return done(std::move(res));
+    }
+
+    if (write_batcher_ && write_batcher_->isActive()) {
+        return write_batcher_->submit(std::move(res), std::move(apply), std::move(done));
+    }
 
+    auto* conn = getConn();
+    if (!conn) {
+        sendJsonError(res, http::status::service_unavailable, "Database not ready");
+        return done(std::move(res));
+    }
+    try {
+        DbTime::Scope db_time;
         pqxx::work txn(*conn);
+        apply(txn, res);
+        txn.commit();
+    }
+    catch (const std::exception& e) {
+        sendJsonError(res, http::status::internal_server_error, e.what());
+    }
+    done(std::move(res));
+}
+
+void ApiProcessor::handleAddEmployee(const sRequest& req,
+    http::response<http::string_body>&& res, Responder done) {
+    auto apply = prepareAddEmployee(req, res);
+    submitWrite(std::move(res), std::move(done), std::move(apply));
+}
 
-        auto r = txn.exec(pqxx::zview(
-            "INSERT INTO employees (fullname, status, salary) VALUES ($1, $2, $3) RETURNING *"),
-            pqxx::params{ fullname, status, salary });
+void ApiProcessor::handleUpdateEmployee(const sRequest& req,
+    http::response<http::string_body>&& res, Responder done) {
+    auto apply = prepareUpdateEmployee(req, res);
+    submitWrite(std::move(res), std::move(done), std::move(apply));
+}
 
-        int new_id = r[0]["id"].as<int>();
+void ApiProcessor::handleAddHours(const sRequest& req,
+    http::response<http::string_body>&& res, Responder done) {
+    auto apply = prepareAddHours(req, res);
+    submitWrite(std::move(res), std::move(done), std::move(apply));
+}
 
-        txn.exec(pqxx::zview("INSERT INTO work_hours (employee_id) VALUES ($1)"),
-            pqxx::params{ new_id });
+void ApiProcessor::handleAddPenalty(const sRequest& req,
+    http::response<http::string_body>&& res, Responder done) {
+    auto apply = prepareAddPenalty(req, res);
+    submitWrite(std::move(res), std::move(done), std::move(apply));
+}
 
-        txn.commit();
+void ApiProcessor::handleAddBonus(const sRequest& req,
+    http::response<http::string_body>&& res, Responder done) {
+    auto apply = prepareAddBonus(req, res);
+    submitWrite(std::move(res), std::move(done), std::move(apply));
+}
 
-        res.result(http::status::created);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(employeeToJson(r[0]));
-        res.prepare_payload();
+WriteBatcher::Apply ApiProcessor::prepareAddEmployee(const sRequest& req,
+    http::response<http::string_body>& res) {
+    if (!getConn()) {
+        sendJsonError(res, http::status::service_unavailable, "Database not ready");
+        return {};
     }
-    catch (const boost::system::system_error& se) {
-        std::cout << "Parse error: " << se.what() << std::endl; //FIXME: Будет срать ошибками boost в фронт
-        sendJsonError(res, http::status::bad_request, "Invalid JSON");
+
+    if (req.method() != http::verb::post) {
+        sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
+        return {};
     }
-    catch (const std::exception& e) {
-        sendJsonError(res, http::status::bad_request, e.what());
+
+    EmployeeBody body;
+    std::string error;
+    if (!parseRequest(req.body(), body, error)) {
+        sendJsonError(res, http::status::bad_request, error);
+        return {};
     }
+
+    return [body = std::move(body), format = negotiateFormat(req)](pqxx::transaction_base& txn, http::response<http::string_body>& res) {
+        DatabaseMapper mapper(txn);
+        Employee employee = HRDatabaseHandlers(mapper).createEmployee(body.fullname, body.status, body.salary);
+
+        res.result(http::status::created);
+        writeBody(res, bj::value_from(employee), format);
+        };
 }
 
-void ApiProcessor::handleUpdateEmployee(const http::request<http::string_body>& req,
+WriteBatcher::Apply ApiProcessor::prepareUpdateEmployee(const sRequest& req,
     http::response<http::string_body>& res) {
-    auto* conn = getConn();
-    if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
+    if (!getConn()) {
+        sendJsonError(res, http::status::service_unavailable, "Database not ready");
+        return {};
+    }
 
     if (req.method() != http::verb::put) {
-        return sendJsonError(res, http::status::method_not_allowed, "Only PUT allowed");
+        sendJsonError(res, http::status::method_not_allowed, "Only PUT allowed");
+        return {};
     }
 
     std::string target_str = std::string(req.target());
     auto id_opt = parseIdFromPath(target_str, "/api/employees/");
-    if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid employee ID");
+    if (!id_opt) {
+        sendJsonError(res, http::status::bad_request, "Invalid employee ID");
+        return {};
+    }
     int id = *id_opt;
 
-    try {
-        bj::value jv = bj::parse(req.body());
-        const bj::object& body = jv.as_object();
+    EmployeePatch patch;
+    std::string error;
+    if (!parseRequest(req.body(), patch, error)) {
+        sendJsonError(res, http::status::bad_request, error);
+        return {};
+    }
 
-        std::string set_clause;
-        pqxx::params update_params;
+    std::string set_clause;
+    pqxx::params update_params;
 
-        if (body.contains("fullname")) {
-            std::string fn = std::string(body.at("fullname").as_string());
-            if (fn.size() < 3) return sendJsonError(res, http::status::bad_request, "Fullname too short");
-            set_clause += "fullname = $" + std::to_string(update_params.size() + 1) + ", ";
-            update_params.append(fn);
-        }
-        if (body.contains("status")) {
-            std::string st = std::string(body.at("status").as_string());
-            if (st != "hired" && st != "fired" && st != "interview") {
-                return sendJsonError(res, http::status::bad_request, "Invalid status");
-            }
-            set_clause += "status = $" + std::to_string(update_params.size() + 1) + ", ";
-            update_params.append(st);
-        }
-        if (body.contains("salary")) {
-            double sal = 0.0;
-            if (body.at("salary").is_int64()) {
-                sal = static_cast<double>(body.at("salary").as_int64());
-            }
-            else if (body.at("salary").is_double()) {
-                sal = body.at("salary").as_double();
-            }
-            if (sal <= 0) return sendJsonError(res, http::status::bad_request, "Salary must be > 0");
-            set_clause += "salary = $" + std::to_string(update_params.size() + 1) + ", ";
-            update_params.append(sal);
-        }
-
-        if (set_clause.empty()) {
-            return sendJsonError(res, http::status::bad_request, "No fields to update");
-        }
+    if (patch.fullname) {
+        set_clause += "fullname = $" + std::to_string(update_params.size() + 1) + ", ";
+        update_params.append(*patch.fullname);
+    }
+    if (patch.status) {
+        set_clause += "status = $" + std::to_string(update_params.size() + 1) + ", ";
+        update_params.append(*patch.status);
+    }
+    if (patch.salary) {
+        set_clause += "salary = $" + std::to_string(update_params.size() + 1) + ", ";
+        update_params.append(*patch.salary);
+    }
 
-        set_clause += "updated_at = CURRENT_TIMESTAMP";
-        update_params.append(id); // последний параметр — id
+    if (set_clause.empty()) {
+        sendJsonError(res, http::status::bad_request, "No fields to update");
+        return {};
+    }
 
-        pqxx::work txn(*conn);
-        std::string query = "UPDATE employees SET " + set_clause +
-            " WHERE id = $" + std::to_string(update_params.size()) + " RETURNING *";
+    set_clause += "updated_at = CURRENT_TIMESTAMP";
+    update_params.append(id); // последний параметр — id
 
-        auto r = txn.exec(pqxx::zview(query), update_params);
+    return [this, set_clause, update_params, format = negotiateFormat(req)](pqxx::transaction_base& txn, http::response<http::string_body>& res) {
+        DatabaseMapper mapper(txn);
+        auto employee = HRDatabaseHandlers(mapper).updateEmployee(set_clause, update_params);
 
-        if (r.empty()) {
+        if (!employee) {
             return sendJsonError(res, http::status::not_found, "Employee not found");
         }
 
-        txn.commit();
+        res.result(http::status::ok);
+        writeBody(res, bj::value_from(*employee), format);
+        };
+}
+
+WriteBatcher::Apply ApiProcessor::prepareAddHours(const sRequest& req,
+    http::response<http::string_body>& res) {
+    if (!getConn()) {
+        sendJsonError(res, http::status::service_unavailable, "Database not ready");
+        return {};
+    }
+
+    if (req.method() != http::verb::post) {
+        sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
+        return {};
+    }
+
+    std::string target_str = std::string(req.target());
+    auto id_opt = parseIdFromPath(target_str, "/api/hours/");
+    if (!id_opt) {
+        sendJsonError(res, http::status::bad_request, "Invalid employee ID");
+        return {};
+    }
+    int employee_id = *id_opt;
+
+    HoursBody body;
+    std::string error;
+    if (!parseRequest(req.body(), body, error)) {
+        sendJsonError(res, http::status::bad_request, error);
+        return {};
+    }
+
+    return [employee_id, body, format = negotiateFormat(req)](pqxx::transaction_base& txn, http::response<http::string_body>& res) {
+        DatabaseMapper mapper(txn);
+        Hours hours = HRDatabaseHandlers(mapper).upsertHours(employee_id, body.regular_hours, body.overtime, body.undertime);
 
         res.result(http::status::ok);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(employeeToJson(r[0]));
-        res.prepare_payload();
+        writeBody(res, bj::value_from(hours), format);
+        };
+}
+
+template <class Body>
+WriteBatcher::Apply ApiProcessor::prepareAdjustment(const sRequest& req,
+    http::response<http::string_body>& res) {
+    if (!getConn()) {
+        sendJsonError(res, http::status::service_unavailable, "Database not ready");
+        return {};
     }
-    catch (const boost::system::system_error&) {
-        sendJsonError(res, http::status::bad_request, "Invalid JSON");
+
+    if (req.method() != http::verb::post) {
+        sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
+        return {};
     }
-    catch (const std::exception& e) {
-        sendJsonError(res, http::status::internal_server_error, e.what());
+
+    std::string target_str = std::string(req.target());
+    auto id_opt = parseIdFromPath(target_str, "/api/employees/");
+    if (!id_opt) {
+        sendJsonError(res, http::status::bad_request, "Invalid employee ID");
+        return {};
     }
+    int employee_id = *id_opt;
+
+    Body body;
+    std::string error;
+    if (!parseRequest(req.body(), body, error)) {
+        sendJsonError(res, http::status::bad_request, error);
+        return {};
+    }
+
+    return [this, employee_id, body = std::move(body), format = negotiateFormat(req)](pqxx::transaction_base& txn, http::response<http::string_body>& res) {
+        DatabaseMapper mapper(txn);
+        HRDatabaseHandlers db(mapper);
+        if (!db.isHired(employee_id)) return sendJsonError(res, http::status::bad_request, "Employee not found or not hired");
+
+        bj::value created;
+        if constexpr (std::is_same_v<Body, PenaltyBody>) {
+            created = bj::value_from(db.createPenalty(employee_id, body.text, body.amount));
+        }
+        else {
+            created = bj::value_from(db.createBonus(employee_id, body.text, body.amount));
+        }
+
+        res.result(http::status::created);
+        writeBody(res, created, format);
+        };
+}
+
+WriteBatcher::Apply ApiProcessor::prepareAddPenalty(const sRequest& req,
+    http::response<http::string_body>& res) {
+    return prepareAdjustment<PenaltyBody>(req, res);
 }
 
-void ApiProcessor::handleAddHours(const http::request<http::string_body>& req,
+WriteBatcher::Apply ApiProcessor::prepareAddBonus(const sRequest& req,
     http::response<http::string_body>& res) {
+    return prepareAdjustment<BonusBody>(req, res);
+}
+
+void ApiProcessor::streamList(const sRequest& req,
+    http::response<http::string_body>& res,
+    const ListResource& resource) {
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
-    if (req.method() != http::verb::post) {
-        return sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
+    if (req.method() != http::verb::get) {
+        return sendJsonError(res, http::status::method_not_allowed, "Only GET allowed");
     }
 
     std::string target_str = std::string(req.target());
-    auto id_opt = parseIdFromPath(target_str, "/api/hours/");
-    if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid employee ID");
-    int employee_id = *id_opt;
 
-    try {
-        bj::value jv = bj::parse(req.body());
-        const bj::object& body = jv.as_object();
+    long long after_id = 0;
+    if (auto param = getQueryParam(target_str, "after_id")) {
+        auto parsed = parseNonNegative(*param);
+        if (!parsed) return sendJsonError(res, http::status::bad_request, "after_id must be a non-negative integer");
+        after_id = *parsed;
+    }
 
-        double regular = 0.0;
-        if (body.contains("regularHours")) {
-            if (body.at("regularHours").is_int64()) {
-                regular = static_cast<double>(body.at("regularHours").as_int64());
+    long long limit = kDefaultPageLimit;
+    if (auto param = getQueryParam(target_str, "limit")) {
+        auto parsed = parseNonNegative(*param);
+        if (!parsed || *parsed == 0) return sendJsonError(res, http::status::bad_request, "limit must be a positive integer");
+        limit = std::min(*parsed, kMaxPageLimit);
+    }
+
+    // Проекция: ключ выбирается всегда (нужен для nextAfterId), но в ответ попадает только если запрошен
+    std::vector<const ListResource::Column*> selected;
+    bool emit_key = true;
+    if (auto param = getQueryParam(target_str, "fields")) {
+        emit_key = false;
+        std::vector<std::string> names;
+        boost::split(names, *param, boost::is_any_of(","));
+        for (const auto& name : names) {
+            if (name.empty()) continue;
+            auto it = std::find_if(resource.columns.begin(), resource.columns.end(),
+                [&name](const ListResource::Column& c) { return name == c.json; });
+            if (it == resource.columns.end()) {
+                return sendJsonError(res, http::status::bad_request, "Unknown field: " + name);
             }
-            else if (body.at("regularHours").is_double()) {
-                regular = body.at("regularHours").as_double();
+            if (it == resource.columns.begin()) {
+                emit_key = true;
             }
-        }
-        double overtime = 0.0;
-        if (body.contains("overtime")) {
-            if (body.at("overtime").is_int64()) {
-                overtime = static_cast<double>(body.at("overtime").as_int64());
-            }
-            else if (body.at("overtime").is_double()) {
-                overtime = body.at("overtime").as_double();
+            else if (std::find(selected.begin(), selected.end(), &*it) == selected.end()) {
+                selected.push_back(&*it);
             }
         }
-        double undertime = 0.0;
-        if (body.contains("undertime")) {
-            if (body.at("undertime").is_int64()) {
-                undertime = static_cast<double>(body.at("undertime").as_int64());
-            }
-            else if (body.at("undertime").is_double()) {
-                undertime = body.at("undertime").as_double();
-            }
+    }
+    else {
+        for (auto it = std::next(resource.columns.begin()); it != resource.columns.end(); ++it) {
+            selected.push_back(&*it);
         }
+    }
 
-        if (regular < 0 || overtime < 0 || undertime < 0) {
-            return sendJsonError(res, http::status::bad_request, "Hours cannot be negative");
+    std::string sql = "SELECT ";
+    sql += resource.key;
+    for (const auto* col : selected) {
+        sql += ", ";
+        sql += col->column;
+    }
+    sql += " FROM ";
+    sql += resource.table;
+    sql += " WHERE ";
+    sql += resource.key;
+    sql += " > " + std::to_string(after_id);
+
+    if (resource.filter_param) {
+        if (auto param = getQueryParam(target_str, resource.filter_param)) {
+            if (resource.filter_numeric && !parseNonNegative(*param)) {
+                return sendJsonError(res, http::status::bad_request,
+                    std::string(resource.filter_param) + " must be a non-negative integer");
+            }
+            sql += " AND ";
+            sql += resource.filter_column;
+            sql += " = " + (resource.filter_numeric ? *param : conn->quote(*param));
         }
+    }
 
-        pqxx::work txn(*conn);
+    // Берём на одну строку больше — так узнаём, есть ли следующая страница, без COUNT(*)
+    sql += " ORDER BY ";
+    sql += resource.key;
+    sql += " LIMIT " + std::to_string(limit + 1);
+
+    // ?layout=columnar — items как {"layout":"columnar","fields":[...],"types":[...],"rows":N,"columns":[[...],...]}
+    const bool columnar = getQueryParam(target_str, "layout") == "columnar";
+
+    // Выводимые колонки: (индекс в строке COPY, описание)
+    std::vector<std::pair<size_t, const ListResource::Column*>> emitted;
+    emitted.reserve(selected.size() + 1);
+    if (emit_key) emitted.emplace_back(0, &resource.columns.front());
+    for (size_t i = 0; i < selected.size(); ++i) emitted.emplace_back(i + 1, selected[i]);
+
+    auto appendValue = [](std::string& out, bool numeric, const pqxx::zview& value) {
+        if (value.data() == nullptr) out += "null";
+        else if (numeric) out.append(value.data(), value.size());
+        else appendJsonString(out, value);
+    };
 
-        auto r = txn.exec(pqxx::zview(
-            "INSERT INTO work_hours (employee_id, regular_hours, overtime, undertime) "
-            "VALUES ($1, $2, $3, $4) "
-            "ON CONFLICT (employee_id) DO UPDATE SET "
-            "regular_hours = EXCLUDED.regular_hours, "
-            "overtime = EXCLUDED.overtime, "
-            "undertime = EXCLUDED.undertime "
-            "RETURNING *"),
-            pqxx::params{ employee_id, regular, overtime, undertime });
+    try {
+        DbTime::Scope db_time;
+        pqxx::work txn(*conn);
+        // Строки COPY сразу пишутся в тело ответа: запрос и сериализация — один спан.
+        // Литералы фильтра уже в тексте — план снимается как есть
+        DbObserver::Scope op("db.stream", sql);
+        auto stream = pqxx::stream_from::query(txn, sql);
+
+        std::string& body = res.body();
+        body.clear();
+        body.reserve(static_cast<size_t>(limit) * 32 * (selected.size() + 1));
+
+        // В колоночном режиме значения копятся по колонкам и склеиваются в конце
+        std::vector<std::string> column_bufs(columnar ? emitted.size() : 0);
+        if (!columnar) body += "{\"items\":[";
+
+        long long rows = 0;
+        bool has_more = false;
+        std::string last_key;
+        while (auto fields = stream.read_row()) {
+            if (rows == limit) {
+                has_more = true;  // Лишняя строка — только признак продолжения
+                break;
+            }
+            const auto& row = *fields;
+            if (columnar) {
+                for (size_t c = 0; c < emitted.size(); ++c) {
+                    if (rows > 0) column_bufs[c] += ',';
+                    appendValue(column_bufs[c], emitted[c].second->numeric, row[emitted[c].first]);
+                }
+            }
+            else {
+                if (rows > 0) body += ',';
+                body += '{';
+                for (size_t c = 0; c < emitted.size(); ++c) {
+                    if (c > 0) body += ',';
+                    appendJsonString(body, emitted[c].second->json);
+                    body += ':';
+                    appendValue(body, emitted[c].second->numeric, row[emitted[c].first]);
+                }
+                body += '}';
+            }
 
+            last_key.assign(row[0].data(), row[0].size());
+            ++rows;
+        }
+        stream.complete();  // Дочитывает COPY до конца, иначе соединение останется занятым
         txn.commit();
 
+        if (columnar) {
+            body += "{\"items\":{\"layout\":\"columnar\",\"fields\":[";
+            for (size_t c = 0; c < emitted.size(); ++c) {
+                if (c > 0) body += ',';
+                appendJsonString(body, emitted[c].second->json);
+            }
+            body += "],\"types\":[";
+            for (size_t c = 0; c < emitted.size(); ++c) {
+                if (c > 0) body += ',';
+                appendJsonString(body, emitted[c].second->type);
+            }
+            body += "],\"rows\":" + std::to_string(rows) + ",\"columns\":[";
+            for (size_t c = 0; c < emitted.size(); ++c) {
+                if (c > 0) body += ',';
+                body += '[';
+                body += column_bufs[c];
+                body += ']';
+            }
+            body += "]}";
+        }
+        else {
+            body += ']';
+        }
+
+        body += ",\"nextAfterId\":";
+        body += has_more ? last_key : "null";
+        body += '}';
+
         res.result(http::status::ok);
         res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(hoursToJson(r[0]));
-        res.prepare_payload();
-    }
-    catch (const boost::system::system_error& se) {
-        std::cout << "ApiProcessor Error: " << se.what();
-        sendJsonError(res, http::status::bad_request, "Invalid JSON");
+        res.set(http::field::cache_control, "no-cache, must-revalidate");
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::internal_server_error, e.what());
     }
 }
 
-void ApiProcessor::handleAddPenalty(const http::request<http::string_body>& req,
+void ApiProcessor::handleListEmployees(const sRequest& req,
     http::response<http::string_body>& res) {
-    auto* conn = getConn();
-    if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
+    static const ListResource resource = ListResource::fromModel<Employee>("status", "status", false);
+    streamList(req, res, resource);
+}
 
-    if (req.method() != http::verb::post) {
-        return sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
-    }
+void ApiProcessor::handleListHours(const sRequest& req,
+    http::response<http::string_body>& res) {
+    static const ListResource resource = ListResource::fromModel<Hours>();
+    streamList(req, res, resource);
+}
 
-    std::string target_str = std::string(req.target());
-    auto id_opt = parseIdFromPath(target_str, "/api/employees/");
-    if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid employee ID");
-    int employee_id = *id_opt;
+void ApiProcessor::handleListPenalties(const sRequest& req,
+    http::response<http::string_body>& res) {
+    static const ListResource resource = ListResource::fromModel<Penalty>("employee_id", "employee_id", true);
+    streamList(req, res, resource);
+}
 
-    try {
-        bj::value jv = bj::parse(req.body());
-        const bj::object& body = jv.as_object();
+void ApiProcessor::handleListBonuses(const sRequest& req,
+    http::response<http::string_body>& res) {
+    static const ListResource resource = ListResource::fromModel<Bonus>("employee_id", "employee_id", true);
+    streamList(req, res, resource);
+}
 
-        std::string reason = std::string(body.at("reason").as_string());
-        double amount = 0.0;
-        if (body.at("amount").is_int64()) {
-            amount = static_cast<double>(body.at("amount").as_int64());
+template <class Item>
+bool ApiProcessor::parseBatch(const sRequest& req,
+    http::response<http::string_body>& res,
+    std::vector<std::optional<Item>>& items,
+    std::vector<BatchError>& errors) {
+    auto content_type = req[http::field::content_type];
+    bool ndjson = content_type.find("ndjson") != boost::beast::string_view::npos;
+
+    // Лимит проверяем по ходу разбора: тело на миллион строк не разбираем до конца ради 413
+    auto tooMany = [this, &res] {
+        sendJsonError(res, http::status::payload_too_large,
+            "Too many items, max " + std::to_string(kMaxBatchItems));
+        return false;
+    };
+
+    if (ndjson) {
+        std::string_view body = req.body();
+        size_t pos = 0;
+        while (pos < body.size()) {
+            size_t end = body.find('\n', pos);
+            if (end == std::string_view::npos) end = body.size();
+            std::string_view line = body.substr(pos, end - pos);
+            pos = end + 1;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.find_first_not_of(" \t") == std::string_view::npos) continue;
+            if (items.size() == kMaxBatchItems) return tooMany();
+
+            Item item;
+            std::string error;
+            if (parseRequest(line, item, error)) {
+                items.emplace_back(std::move(item));
+            }
+            else {
+                errors.push_back({ items.size(), std::move(error) });
+                items.emplace_back(std::nullopt);
+            }
         }
-        else if (body.at("amount").is_double()) {
-            amount = body.at("amount").as_double();
+    }
+    else {
+        std::string error;
+        switch (parseRequestArray(req.body(), items, errors, error, kMaxBatchItems)) {
+        case RequestArrayStatus::Ok:
+            break;
+        case RequestArrayStatus::TooMany:
+            return tooMany();
+        case RequestArrayStatus::Invalid:
+            sendJsonError(res, http::status::bad_request, error);
+            return false;
         }
+    }
+    return true;
+}
 
-        if (reason.size() < 3) return sendJsonError(res, http::status::bad_request, "Reason too short");
-        if (amount <= 0) return sendJsonError(res, http::status::bad_request, "Amount must be > 0");
+void ApiProcessor::sendBatchResult(http::response<http::string_body>& res,
+    BodyFormat format,
+    int64_t applied,
+    std::vector<BatchError>& errors,
+    bj::object extra) {
+    std::sort(errors.begin(), errors.end(),
+        [](const BatchError& a, const BatchError& b) { return a.index < b.index; });
+
+    bj::array errors_arr;
+    errors_arr.reserve(errors.size());
+    for (const auto& err : errors) {
+        bj::object e;
+        e["index"] = err.index;
+        e["error"] = err.message;
+        errors_arr.emplace_back(std::move(e));
+    }
 
-        pqxx::work txn(*conn);
+    bj::object response = std::move(extra);
+    response["applied"] = applied;
+    response["errors"] = std::move(errors_arr);
 
-        auto check = txn.exec(pqxx::zview("SELECT 1 FROM employees WHERE id = $1 AND status = 'hired'"),
-            pqxx::params{ employee_id });
-        if (check.empty()) return sendJsonError(res, http::status::bad_request, "Employee not found or not hired");
+    // Если не применилось ничего и есть ошибки — это ошибка клиента целиком
+    res.result(applied == 0 && !errors.empty() ? http::status::bad_request : http::status::ok);
+    writeBody(res, bj::value(std::move(response)), format);
+    res.prepare_payload();
+}
 
-        auto r = txn.exec(pqxx::zview(
-            "INSERT INTO penalties (employee_id, reason, amount) VALUES ($1, $2, $3) RETURNING *"),
-            pqxx::params{ employee_id, reason, amount });
+void ApiProcessor::handleBatchAddEmployees(const sRequest& req,
+    http::response<http::string_body>& res) {
+    auto* conn = getConn();
+    if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
+
+    if (req.method() != http::verb::post) {
+        return sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
+    }
+
+    std::vector<std::optional<EmployeeBody>> items;
+    std::vector<BatchError> errors;
+    if (!parseBatch(req, res, items, errors)) return;
+
+    try {
+        DbTime::Scope db_time;
+        pqxx::work txn(*conn);
+        DatabaseMapper::execute(txn, pqxx::zview(
+            "CREATE TEMP TABLE employees_stage ("
+            "idx INTEGER, fullname TEXT, status TEXT, salary NUMERIC(12,2)"
+            ") ON COMMIT DROP"));
+
+        size_t staged = 0;
+        {
+            Tracer::Span span("db.copy", "db.table", "employees_stage");
+            auto stream = pqxx::stream_to::table(txn, { "employees_stage" },
+                { "idx", "fullname", "status", "salary" });
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (!items[i]) continue;  // Не прошёл схему, ошибка уже в errors
+                const auto& item = *items[i];
+                stream.write_values(static_cast<int>(i), item.fullname, item.status, item.salary);
+                ++staged;
+            }
+            stream.complete();
+        }
 
+        bj::array ids;
+        if (staged > 0) {
+            // Одним оператором: сотрудники + пустые строки часов для них.
+            // RETURNING видит только вставленную строку, поэтому id берём из последовательности
+            // заранее, рядом с idx, и по нему сопоставляем вставленное с элементами запроса
+            auto r = DatabaseMapper::execute(txn, pqxx::zview(
+                "WITH stage AS ("
+                "  SELECT idx, nextval(pg_get_serial_sequence('employees', 'id'))::int AS id, "
+                "         fullname, status, salary "
+                "  FROM employees_stage ORDER BY idx"
+                "), ins AS ("
+                "  INSERT INTO employees (id, fullname, status, salary) "
+                "  SELECT id, fullname, status, salary FROM stage "
+                "  RETURNING id"
+                "), hours AS ("
+                "  INSERT INTO work_hours (employee_id) SELECT id FROM ins"
+                ") "
+                "SELECT stage.idx, stage.id FROM stage JOIN ins USING (id) ORDER BY stage.idx"));
+            ids.reserve(r.size());
+            for (const auto& row : r) {
+                bj::object pair;
+                pair["index"] = row[0].as<int>();
+                pair["id"] = row[1].as<int>();
+                ids.emplace_back(std::move(pair));
+            }
+        }
         txn.commit();
 
-        res.result(http::status::created);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(penaltyToJson(r[0]));
-        res.prepare_payload();
-    }
-    catch (const boost::system::system_error& se) {
-        std::cout << "ApiProcessor Error:" << se.what();
-        sendJsonError(res, http::status::bad_request, "Invalid JSON");
+        // ids — пары {index, id}: index — позиция элемента в запросе, отклонённые есть в errors
+        bj::object extra;
+        auto applied = static_cast<int64_t>(ids.size());
+        extra["ids"] = std::move(ids);
+        sendBatchResult(res, negotiateFormat(req), applied, errors, std::move(extra));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::internal_server_error, e.what());
     }
 }
 
-void ApiProcessor::handleAddBonus(const http::request<http::string_body>& req,
+void ApiProcessor::handleBatchUpsertHours(const sRequest& req,
     http::response<http::string_body>& res) {
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
@@ -474,48 +873,136 @@ void ApiProcessor::handleAddBonus(const http::request<http::string_body>& req,
         return sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
     }
 
-    std::string target_str = std::string(req.target());
-    auto id_opt = parseIdFromPath(target_str, "/api/employees/");
-    if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid employee ID");
-    int employee_id = *id_opt;
+    std::vector<std::optional<HoursItem>> items;
+    std::vector<BatchError> errors;
+    if (!parseBatch(req, res, items, errors)) return;
 
     try {
-        bj::value jv = bj::parse(req.body());
-        const bj::object& body = jv.as_object();
-
-        std::string note = std::string(body.at("note").as_string());
-        double amount = 0.0;
-        if (body.at("amount").is_int64()) {
-            amount = static_cast<double>(body.at("amount").as_int64());
+        DbTime::Scope db_time;
+        pqxx::work txn(*conn);
+        DatabaseMapper::execute(txn, pqxx::zview(
+            "CREATE TEMP TABLE hours_stage ("
+            "idx INTEGER, employee_id INTEGER, regular_hours NUMERIC(8,2), "
+            "overtime NUMERIC(8,2), undertime NUMERIC(8,2)"
+            ") ON COMMIT DROP"));
+
+        size_t staged = 0;
+        {
+            Tracer::Span span("db.copy", "db.table", "hours_stage");
+            auto stream = pqxx::stream_to::table(txn, { "hours_stage" },
+                { "idx", "employee_id", "regular_hours", "overtime", "undertime" });
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (!items[i]) continue;
+                const auto& item = *items[i];
+                stream.write_values(static_cast<int>(i), item.employee_id,
+                    item.regular_hours, item.overtime, item.undertime);
+                ++staged;
+            }
+            stream.complete();
         }
-        else if (body.at("amount").is_double()) {
-            amount = body.at("amount").as_double();
+
+        int64_t applied = 0;
+        if (staged > 0) {
+            auto missing = DatabaseMapper::execute(txn, pqxx::zview(
+                "SELECT s.idx FROM hours_stage s "
+                "WHERE NOT EXISTS (SELECT 1 FROM employees e WHERE e.id = s.employee_id)"));
+            for (const auto& row : missing) {
+                errors.push_back({ row[0].as<size_t>(), "Employee not found" });
+            }
+
+            // Несколько записей для одного сотрудника: побеждает последняя (как при поштучных POST)
+            auto r = DatabaseMapper::execute(txn, pqxx::zview(
+                "INSERT INTO work_hours (employee_id, regular_hours, overtime, undertime) "
+                "SELECT DISTINCT ON (s.employee_id) s.employee_id, s.regular_hours, s.overtime, s.undertime "
+                "FROM hours_stage s JOIN employees e ON e.id = s.employee_id "
+                "ORDER BY s.employee_id, s.idx DESC "
+                "ON CONFLICT (employee_id) DO UPDATE SET "
+                "regular_hours = EXCLUDED.regular_hours, "
+                "overtime = EXCLUDED.overtime, "
+                "undertime = EXCLUDED.undertime"));
+            applied = static_cast<int64_t>(r.affected_rows());
         }
+        txn.commit();
 
-        if (note.size() < 3) return sendJsonError(res, http::status::bad_request, "Note too short");
-        if (amount <= 0) return sendJsonError(res, http::status::bad_request, "Amount must be > 0");
+        sendBatchResult(res, negotiateFormat(req), applied, errors);
+    }
+    catch (const std::exception& e) {
+        sendJsonError(res, http::status::internal_server_error, e.what());
+    }
+}
 
-        pqxx::work txn(*conn);
+template <class Item>
+void ApiProcessor::handleBatchAdjustments(const sRequest& req,
+    http::response<http::string_body>& res,
+    const std::string& table,
+    const std::string& text_field) {
+    auto* conn = getConn();
+    if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
+
+    if (req.method() != http::verb::post) {
+        return sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
+    }
 
-        auto check = txn.exec(pqxx::zview("SELECT 1 FROM employees WHERE id = $1 AND status = 'hired'"),
-            pqxx::params{ employee_id });
-        if (check.empty()) return sendJsonError(res, http::status::bad_request, "Employee not found or not hired");
+    std::vector<std::optional<Item>> items;
+    std::vector<BatchError> errors;
+    if (!parseBatch(req, res, items, errors)) return;
 
-        auto r = txn.exec(pqxx::zview(
-            "INSERT INTO bonuses (employee_id, note, amount) VALUES ($1, $2, $3) RETURNING *"),
-            pqxx::params{ employee_id, note, amount });
+    std::string stage = table + "_stage";
 
+    try {
+        DbTime::Scope db_time;
+        pqxx::work txn(*conn);
+        DatabaseMapper::execute(txn, pqxx::zview(
+            "CREATE TEMP TABLE " + stage + " ("
+            "idx INTEGER, employee_id INTEGER, " + text_field + " TEXT, amount NUMERIC(12,2)"
+            ") ON COMMIT DROP"));
+
+        size_t staged = 0;
+        {
+            Tracer::Span span("db.copy", "db.table", stage);
+            auto stream = pqxx::stream_to::table(txn, { stage },
+                { "idx", "employee_id", text_field, "amount" });
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (!items[i]) continue;
+                const auto& item = *items[i];
+                stream.write_values(static_cast<int>(i), item.employee_id, item.text, item.amount);
+                ++staged;
+            }
+            stream.complete();
+        }
+
+        int64_t applied = 0;
+        if (staged > 0) {
+            auto rejected = DatabaseMapper::execute(txn, pqxx::zview(
+                "SELECT s.idx FROM " + stage + " s "
+                "WHERE NOT EXISTS (SELECT 1 FROM employees e WHERE e.id = s.employee_id AND e.status = 'hired')"));
+            for (const auto& row : rejected) {
+                errors.push_back({ row[0].as<size_t>(), "Employee not found or not hired" });
+            }
+
+            // Один INSERT ... SELECT — триггер уровня оператора пересчитает счётчики один раз
+            auto r = DatabaseMapper::execute(txn, pqxx::zview(
+                "INSERT INTO " + table + " (employee_id, " + text_field + ", amount) "
+                "SELECT s.employee_id, s." + text_field + ", s.amount FROM " + stage + " s "
+                "JOIN employees e ON e.id = s.employee_id AND e.status = 'hired' "
+                "ORDER BY s.idx"));
+            applied = static_cast<int64_t>(r.affected_rows());
+        }
         txn.commit();
 
-        res.result(http::status::created);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(bonusToJson(r[0]));
-        res.prepare_payload();
-    }
-    catch (const boost::system::system_error&) {
-        sendJsonError(res, http::status::bad_request, "Invalid JSON");
+        sendBatchResult(res, negotiateFormat(req), applied, errors);
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::internal_server_error, e.what());
     }
-}
\ No newline at end of file
+}
+
+void ApiProcessor::handleBatchAddPenalties(const sRequest& req,
+    http::response<http::string_body>& res) {
+    handleBatchAdjustments<PenaltyItem>(req, res, "penalties", "reason");
+}
+
+void ApiProcessor::handleBatchAddBonuses(const sRequest& req,
+    http::response<http::string_body>& res) {
+    handleBatchAdjustments<BonusItem>(req, res, "bonuses", "note");
+}
@@ -6,11 +6,14 @@
 #include <optional>
 #include <vector>
 #include <regex>
+#include <functional>
 
 #include <boost/system/error_code.hpp>  
 #include <pqxx/params>                  
 
 #include "macros.h"  // Для http::request, http::response и т.д.
+#include "WriteBatcher.h"
+#include "RequestSchema.h"
 
 class DatabaseModule;
 
@@ -18,8 +21,16 @@ namespace bj = boost::json;
 namespace http = boost::beast::http;
 
 class ApiProcessor {
+public:
+    // Совпадает с RequestHandler::Responder: ответ отправляется, когда его вызовут
+    using Responder = std::function<void(http::response<http::string_body>&&)>;
+
 private:
     DatabaseModule* db_module_;
+    WriteBatcher* write_batcher_;  // nullptr или окно 0 — пишем сразу, без группового коммита
+
+    // Описание ресурса для постраничных списков (см. ApiProcessor.cpp)
+    struct ListResource;
 
     pqxx::connection* getConn();
 
@@ -27,21 +38,78 @@ private:
         http::status status,
         const std::string& message);
 
-    bj::object employeeToJson(const pqxx::row& row);
-    bj::object hoursToJson(const pqxx::row& row);
-    bj::object penaltyToJson(const pqxx::row& row);
-    bj::object bonusToJson(const pqxx::row& row);
+    // Формат тела ответа по заголовку Accept: application/msgpack или JSON (по умолчанию)
+    enum class BodyFormat { Json, MsgPack };
+    static BodyFormat negotiateFormat(const sRequest& req);
+    static void writeBody(http::response<http::string_body>& res, const bj::value& body, BodyFormat format);
+
+    // Валидация запроса на запись. Возвращает операцию над БД либо пустую функцию,
+    // если ошибка уже записана в res.
+    WriteBatcher::Apply prepareAddEmployee(const sRequest& req, http::response<http::string_body>& res);
+    WriteBatcher::Apply prepareUpdateEmployee(const sRequest& req, http::response<http::string_body>& res);
+    WriteBatcher::Apply prepareAddHours(const sRequest& req, http::response<http::string_body>& res);
+    WriteBatcher::Apply prepareAddPenalty(const sRequest& req, http::response<http::string_body>& res);
+    WriteBatcher::Apply prepareAddBonus(const sRequest& req, http::response<http::string_body>& res);
+    template <class Body>
+    WriteBatcher::Apply prepareAdjustment(const sRequest& req, http::response<http::string_body>& res);
+
+    // Выполняет операцию через WriteBatcher (если включён) или в собственной транзакции
+    void submitWrite(http::response<http::string_body>&& res, Responder done, WriteBatcher::Apply apply);
+
+    // Ошибка валидации одного элемента пакетного запроса
+    using BatchError = RequestItemError;
 
-    std::optional<std::string> getQueryParam(const std::string& target, const std::string& param_name);
-    std::optional<int> parseIdFromPath(const std::string& path, const std::string& prefix);
+    // Разбор тела пакетного запроса по схеме Item: JSON-массив или NDJSON (Content-Type: application/x-ndjson).
+    // Элементы, не прошедшие схему, попадают в errors, на их месте остаётся nullopt.
+    template <class Item>
+    bool parseBatch(const sRequest& req,
+        http::response<http::string_body>& res,
+        std::vector<std::optional<Item>>& items,
+        std::vector<BatchError>& errors);
+    void sendBatchResult(http::response<http::string_body>& res,
+        BodyFormat format,
+        int64_t applied,
+        std::vector<BatchError>& errors,
+        bj::object extra = {});
+    // Общая часть для штрафов и бонусов: отличаются только таблица и текстовое поле
+    template <class Item>
+    void handleBatchAdjustments(const sRequest& req,
+        http::response<http::string_body>& res,
+        const std::string& table,
+        const std::string& text_field);
+
+    // Keyset-пагинация + проекция полей, строки читаются потоком через COPY (pqxx::stream_from)
+    void streamList(const sRequest& req,
+        http::response<http::string_body>& res,
+        const ListResource& resource);
 
 public:
-    explicit ApiProcessor(DatabaseModule* db_module);
-
-    void handleGetAllData(const http::request<http::string_body>& req, http::response<http::string_body>& res);
-    void handleAddEmployee(const http::request<http::string_body>& req, http::response<http::string_body>& res);
-    void handleUpdateEmployee(const http::request<http::string_body>& req, http::response<http::string_body>& res);
-    void handleAddHours(const http::request<http::string_body>& req, http::response<http::string_body>& res);
-    void handleAddPenalty(const http::request<http::string_body>& req, http::response<http::string_body>& res);
-    void handleAddBonus(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+    explicit ApiProcessor(DatabaseModule* db_module, WriteBatcher* write_batcher = nullptr);
+
+    // Разбор target без состояния (открыты и для bench/)
+    static std::optional<std::string> getQueryParam(const std::string& target, const std::string& param_name);
+    static std::optional<int> parseIdFromPath(const std::string& path, const std::string& prefix);
+
+    void handleGetAllData(const sRequest& req, http::response<http::string_body>& res);
+    // GET /api/dashboard — только сводка, без выгрузки таблиц
+    void handleGetDashboard(const sRequest& req, http::response<http::string_body>& res);
+
+    // Одиночные изменения — асинхронные: при групповом коммите ответ уходит после коммита пакета
+    void handleAddEmployee(const sRequest& req, http::response<http::string_body>&& res, Responder done);
+    void handleUpdateEmployee(const sRequest& req, http::response<http::string_body>&& res, Responder done);
+    void handleAddHours(const sRequest& req, http::response<http::string_body>&& res, Responder done);
+    void handleAddPenalty(const sRequest& req, http::response<http::string_body>&& res, Responder done);
+    void handleAddBonus(const sRequest& req, http::response<http::string_body>&& res, Responder done);
+
+    // POST /api/<resource>/batch — много записей в одной транзакции через COPY
+    void handleBatchAddEmployees(const sRequest& req, http::response<http::string_body>& res);
+    void handleBatchUpsertHours(const sRequest& req, http::response<http::string_body>& res);
+    void handleBatchAddPenalties(const sRequest& req, http::response<http::string_body>& res);
+    void handleBatchAddBonuses(const sRequest& req, http::response<http::string_body>& res);
+
+    // GET /api/<resource>?after_id=&limit=&fields=
+    void handleListEmployees(const sRequest& req, http::response<http::string_body>& res);
+    void handleListHours(const sRequest& req, http::response<http::string_body>& res);
+    void handleListPenalties(const sRequest& req, http::response<http::string_body>& res);
+    void handleListBonuses(const sRequest& req, http::response<http::string_body>& res);
 };
\ No newline at end of file
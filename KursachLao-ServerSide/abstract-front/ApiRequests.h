@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include "RequestSchema.h"
+
+#include <optional>
+#include <string>
+#include <tuple>
+
+// Тела запросов на запись и их схемы (имя в JSON, член, обязательность, проверка).
+// *Body — одиночный запрос (id сотрудника берётся из пути), *Item — элемент пакета /batch.
+
+namespace request_checks {
+    inline bool fullname(const std::string& v) { return v.size() >= 3; }
+    inline bool status(const std::string& v) { return v == "hired" || v == "fired" || v == "interview"; }
+    inline bool positive(const double& v) { return v > 0; }
+    inline bool nonNegative(const double& v) { return v >= 0; }
+    inline bool text(const std::string& v) { return v.size() >= 3; }
+    inline bool id(const int& v) { return v > 0; }
+}
+
+struct EmployeeBody {
+    std::string fullname;
+    std::string status;
+    double salary = 0;
+};
+
+template <>
+struct RequestSchema<EmployeeBody> {
+    static constexpr auto fields = std::make_tuple(
+        requestField("fullname", &EmployeeBody::fullname, kRequiredField, request_checks::fullname, "Fullname too short"),
+        requestField("status", &EmployeeBody::status, kRequiredField, request_checks::status, "Invalid status"),
+        requestField("salary", &EmployeeBody::salary, kRequiredField, request_checks::positive, "Salary must be > 0"));
+};
+
+// PUT /api/employees/:id — любое подмножество полей
+struct EmployeePatch {
+    std::optional<std::string> fullname;
+    std::optional<std::string> status;
+    std::optional<double> salary;
+};
+
+template <>
+struct RequestSchema<EmployeePatch> {
+    static constexpr auto fields = std::make_tuple(
+        requestField("fullname", &EmployeePatch::fullname, kOptionalField, request_checks::fullname, "Fullname too short"),
+        requestField("status", &EmployeePatch::status, kOptionalField, request_checks::status, "Invalid status"),
+        requestField("salary", &EmployeePatch::salary, kOptionalField, request_checks::positive, "Salary must be > 0"));
+};
+
+// Отсутствующее поле часов считается нулём
+struct HoursBody {
+    double regular_hours = 0;
+    double overtime = 0;
+    double undertime = 0;
+};
+
+template <>
+struct RequestSchema<HoursBody> {
+    static constexpr auto fields = std::make_tuple(
+        requestField("regularHours", &HoursBody::regular_hours, kOptionalField, request_checks::nonNegative, "Hours cannot be negative"),
+        requestField("overtime", &HoursBody::overtime, kOptionalField, request_checks::nonNegative, "Hours cannot be negative"),
+        requestField("undertime", &HoursBody::undertime, kOptionalField, request_checks::nonNegative, "Hours cannot be negative"));
+};
+
+struct HoursItem : HoursBody {
+    int employee_id = 0;
+};
+
+template <>
+struct RequestSchema<HoursItem> {
+    static constexpr auto fields = std::tuple_cat(
+        std::make_tuple(requestField("employeeId", &HoursItem::employee_id, kRequiredField, request_checks::id, "Invalid employee ID")),
+        RequestSchema<HoursBody>::fields);
+};
+
+// Штраф и бонус устроены одинаково, отличается только имя текстового поля (reason / note)
+struct AdjustmentBody {
+    std::string text;
+    double amount = 0;
+};
+
+struct PenaltyBody : AdjustmentBody {};
+struct BonusBody : AdjustmentBody {};
+
+template <>
+struct RequestSchema<PenaltyBody> {
+    static constexpr auto fields = std::make_tuple(
+        requestField("reason", &AdjustmentBody::text, kRequiredField, request_checks::text, "Reason too short"),
+        requestField("amount", &AdjustmentBody::amount, kRequiredField, request_checks::positive, "Amount must be > 0"));
+};
+
+template <>
+struct RequestSchema<BonusBody> {
+    static constexpr auto fields = std::make_tuple(
+        requestField("note", &AdjustmentBody::text, kRequiredField, request_checks::text, "Note too short"),
+        requestField("amount", &AdjustmentBody::amount, kRequiredField, request_checks::positive, "Amount must be > 0"));
+};
+
+struct PenaltyItem : PenaltyBody {
+    int employee_id = 0;
+};
+
+struct BonusItem : BonusBody {
+    int employee_id = 0;
+};
+
+template <>
+struct RequestSchema<PenaltyItem> {
+    static constexpr auto fields = std::tuple_cat(
+        std::make_tuple(requestField("employeeId", &PenaltyItem::employee_id, kRequiredField, request_checks::id, "Invalid employee ID")),
+        RequestSchema<PenaltyBody>::fields);
+};
+
+template <>
+struct RequestSchema<BonusItem> {
+    static constexpr auto fields = std::tuple_cat(
+        std::make_tuple(requestField("employeeId", &BonusItem::employee_id, kRequiredField, request_checks::id, "Invalid employee ID")),
+        RequestSchema<BonusBody>::fields);
+};
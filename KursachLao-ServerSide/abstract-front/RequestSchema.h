@@ -0,0 +1,398 @@
+﻿#pragma once
+
+#include <boost/json/basic_parser_impl.hpp>
+
+#include <bitset>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Декларативные схемы тел запросов.
+// Тело разбирается потоково (boost::json::basic_parser со своим обработчиком) сразу в структуру,
+// без промежуточного DOM. Схема задаёт для каждого поля имя в JSON, член структуры,
+// обязательность и проверку с текстом ошибки — см. ApiRequests.h.
+
+template <class T>
+struct RequestFieldValue {
+    using type = T;
+};
+
+template <class T>
+struct RequestFieldValue<std::optional<T>> {
+    using type = T;
+};
+
+template <class Owner, class T>
+struct RequestField {
+    using value_type = typename RequestFieldValue<T>::type;  // string, double или int
+
+    const char* name;
+    T Owner::* member;
+    bool required;
+    bool (*check)(const value_type&);  // nullptr — без проверки
+    const char* message;               // текст ошибки, если check вернул false
+};
+
+inline constexpr bool kRequiredField = true;
+inline constexpr bool kOptionalField = false;
+
+template <class Owner, class T>
+constexpr RequestField<Owner, T> requestField(const char* name,
+    T Owner::* member,
+    bool required,
+    bool (*check)(const typename RequestFieldValue<T>::type&) = nullptr,
+    const char* message = nullptr) {
+    return { name, member, required, check, message };
+}
+
+// Специализируется для каждого запроса: static constexpr auto fields = std::make_tuple(requestField(...), ...)
+template <class Request>
+struct RequestSchema;
+
+template <class Request>
+concept SchemaRequest = requires { RequestSchema<Request>::fields; };
+
+// Ошибка в одном элементе массива (или в единственном объекте)
+struct RequestItemError {
+    size_t index;
+    std::string message;
+};
+
+// Обработчик событий basic_parser. Shape::Object — один плоский объект,
+// Shape::Array — массив плоских объектов; ошибки полей в элементе массива
+// не прерывают разбор остальных элементов.
+template <SchemaRequest Request>
+class RequestReader {
+public:
+    static constexpr std::size_t max_object_size = std::numeric_limits<std::size_t>::max();
+    static constexpr std::size_t max_array_size = std::numeric_limits<std::size_t>::max();
+    static constexpr std::size_t max_key_size = std::numeric_limits<std::size_t>::max();
+    static constexpr std::size_t max_string_size = std::numeric_limits<std::size_t>::max();
+
+    enum class Shape { Object, Array };
+
+    // max_items — сколько элементов массива принимаем; на следующем разбор обрывается (too_many)
+    explicit RequestReader(Shape shape, std::size_t max_items = std::numeric_limits<std::size_t>::max())
+        : shape_(shape), item_level_(shape == Shape::Object ? 1 : 2), max_items_(max_items) {}
+
+    std::vector<std::optional<Request>> items;  // nullopt — элемент с ошибкой (она в item_errors)
+    std::vector<RequestItemError> item_errors;
+    std::string error;                          // ошибка формы документа, разбор прерван
+    bool too_many = false;                      // элементов больше max_items, разбор прерван
+
+    bool on_document_begin(boost::json::error_code&) { return true; }
+    bool on_document_end(boost::json::error_code&) { return true; }
+
+    bool on_object_begin(boost::json::error_code& ec) {
+        if (depth_ == 0 && shape_ == Shape::Array) return fail(ec, "Expected JSON array");
+        ++depth_;
+        if (depth_ == item_level_) return beginItem(ec);
+        if (depth_ == item_level_ + 1) valueTypeError();
+        return true;
+    }
+
+    bool on_object_end(std::size_t, boost::json::error_code&) {
+        if (depth_ == item_level_) endItem();
+        --depth_;
+        return true;
+    }
+
+    bool on_array_begin(boost::json::error_code& ec) {
+        if (depth_ == 0 && shape_ == Shape::Object) return fail(ec, "Expected JSON object");
+        ++depth_;
+        if (shape_ == Shape::Array && depth_ == 2) return elementNotObject(ec);
+        if (depth_ == item_level_ + 1) valueTypeError();
+        return true;
+    }
+
+    bool on_array_end(std::size_t, boost::json::error_code&) {
+        --depth_;
+        return true;
+    }
+
+    bool on_key_part(boost::json::string_view s, std::size_t, boost::json::error_code&) {
+        if (depth_ == item_level_) key_.append(s.data(), s.size());
+        return true;
+    }
+
+    bool on_key(boost::json::string_view s, std::size_t, boost::json::error_code&) {
+        if (depth_ == item_level_) {
+            key_.append(s.data(), s.size());
+            field_ = findField(key_);
+            key_.clear();
+        }
+        return true;
+    }
+
+    bool on_string_part(boost::json::string_view s, std::size_t, boost::json::error_code&) {
+        if (depth_ == item_level_ && field_ >= 0) str_.append(s.data(), s.size());
+        return true;
+    }
+
+    bool on_string(boost::json::string_view s, std::size_t, boost::json::error_code& ec) {
+        str_.append(s.data(), s.size());
+        bool ok = onScalar(ec, Scalar{ Scalar::String, str_ });
+        str_.clear();
+        return ok;
+    }
+
+    bool on_number_part(boost::json::string_view, boost::json::error_code&) { return true; }
+
+    bool on_int64(std::int64_t i, boost::json::string_view, boost::json::error_code& ec) {
+        Scalar s{ Scalar::Int };
+        s.i = i;
+        return onScalar(ec, s);
+    }
+
+    bool on_uint64(std::uint64_t u, boost::json::string_view, boost::json::error_code& ec) {
+        Scalar s{ Scalar::Uint };
+        s.u = u;
+        return onScalar(ec, s);
+    }
+
+    bool on_double(double d, boost::json::string_view, boost::json::error_code& ec) {
+        Scalar s{ Scalar::Double };
+        s.d = d;
+        return onScalar(ec, s);
+    }
+
+    bool on_bool(bool, boost::json::error_code& ec) { return onScalar(ec, Scalar{ Scalar::Other }); }
+    bool on_null(boost::json::error_code& ec) { return onScalar(ec, Scalar{ Scalar::Other }); }
+
+    bool on_comment_part(boost::json::string_view, boost::json::error_code&) { return true; }
+    bool on_comment(boost::json::string_view, boost::json::error_code&) { return true; }
+
+private:
+    static constexpr size_t kFieldCount = std::tuple_size_v<std::remove_const_t<decltype(RequestSchema<Request>::fields)>>;
+    static_assert(kFieldCount <= 64, "too many fields in request schema");
+
+    struct Scalar {
+        enum Kind { String, Int, Uint, Double, Other } kind;
+        std::string_view str{};
+        std::int64_t i = 0;
+        std::uint64_t u = 0;
+        double d = 0;
+    };
+
+    Shape shape_;
+    int item_level_;
+    int depth_ = 0;
+    std::size_t max_items_;
+    std::size_t count_ = 0;  // начатых элементов, включая ошибочные
+
+    std::optional<Request> current_;
+    std::bitset<kFieldCount> seen_;
+    std::string item_error_;
+    int field_ = -1;  // индекс поля схемы для текущего ключа, -1 — неизвестный ключ
+    std::string key_;
+    std::string str_;
+
+    template <class F>
+    static void forEachField(F&& f) {
+        std::apply([&f](const auto&... field) {
+            size_t index = 0;
+            (f(index++, field), ...);
+            }, RequestSchema<Request>::fields);
+    }
+
+    static int findField(const std::string& key) {
+        int found = -1;
+        forEachField([&](size_t index, const auto& field) {
+            if (found < 0 && key == field.name) found = static_cast<int>(index);
+            });
+        return found;
+    }
+
+    bool fail(boost::json::error_code& ec, const char* message) {
+        error = message;
+        ec = boost::system::errc::make_error_code(boost::system::errc::invalid_argument);
+        return false;
+    }
+
+    void itemError(std::string message) {
+        if (item_error_.empty()) item_error_ = std::move(message);
+    }
+
+    // Считаем элемент до разбора его полей: лишний обрывает документ сразу,
+    // не дожидаясь конца тела
+    bool countItem(boost::json::error_code& ec) {
+        if (++count_ <= max_items_) return true;
+        too_many = true;
+        return fail(ec, "Too many items");
+    }
+
+    bool beginItem(boost::json::error_code& ec) {
+        if (!countItem(ec)) return false;
+        current_.emplace();
+        seen_.reset();
+        item_error_.clear();
+        field_ = -1;
+        return true;
+    }
+
+    void endItem() {
+        forEachField([this](size_t index, const auto& field) {
+            if (!seen_.test(index)) {
+                if (field.required) itemError(std::string("Missing field: ") + field.name);
+                return;
+            }
+            if (!field.check) return;
+            const auto& value = (*current_).*field.member;
+            bool ok;
+            if constexpr (std::is_same_v<std::decay_t<decltype(value)>, typename std::decay_t<decltype(field)>::value_type>) {
+                ok = field.check(value);
+            }
+            else {
+                ok = field.check(*value);
+            }
+            if (!ok) {
+                itemError(field.message ? std::string(field.message) : std::string(field.name) + " is invalid");
+            }
+            });
+
+        if (item_error_.empty()) {
+            items.emplace_back(std::move(current_));
+        }
+        else {
+            item_errors.push_back({ items.size(), std::move(item_error_) });
+            items.emplace_back(std::nullopt);
+        }
+        current_.reset();
+        item_error_.clear();
+        field_ = -1;
+    }
+
+    // Элемент-массив или скаляр: ключ прошлого объекта к нему не относится
+    bool elementNotObject(boost::json::error_code& ec) {
+        if (!countItem(ec)) return false;
+        field_ = -1;
+        item_errors.push_back({ items.size(), "Expected JSON object" });
+        items.emplace_back(std::nullopt);
+        return true;
+    }
+
+    // Известное поле получило объект или массив
+    void valueTypeError() {
+        if (field_ < 0) return;
+        forEachField([this](size_t index, const auto& field) {
+            if (static_cast<int>(index) == field_) {
+                itemError(std::string(field.name) + " must be " + typeName<typename std::decay_t<decltype(field)>::value_type>());
+            }
+            });
+    }
+
+    bool onScalar(boost::json::error_code& ec, const Scalar& s) {
+        if (depth_ == 0) {
+            return fail(ec, shape_ == Shape::Object ? "Expected JSON object" : "Expected JSON array");
+        }
+        if (shape_ == Shape::Array && depth_ == 1) return elementNotObject(ec);
+        if (depth_ == item_level_ && field_ >= 0 && current_) {
+            forEachField([&](size_t index, const auto& field) {
+                if (static_cast<int>(index) == field_) setField(index, field, s);
+                });
+        }
+        return true;
+    }
+
+    template <class V>
+    static const char* typeName() {
+        if constexpr (std::is_same_v<V, std::string>) return "a string";
+        else if constexpr (std::is_same_v<V, int>) return "an integer";
+        else return "a number";
+    }
+
+    template <class Field>
+    void setField(size_t index, const Field& field, const Scalar& s) {
+        using V = typename Field::value_type;
+        auto& target = (*current_).*field.member;
+
+        if constexpr (std::is_same_v<V, std::string>) {
+            if (s.kind != Scalar::String) return itemError(std::string(field.name) + " must be " + typeName<V>());
+            target = std::string(s.str);
+        }
+        else if constexpr (std::is_same_v<V, double>) {
+            if (s.kind == Scalar::Int) target = static_cast<double>(s.i);
+            else if (s.kind == Scalar::Uint) target = static_cast<double>(s.u);
+            else if (s.kind == Scalar::Double) target = s.d;
+            else return itemError(std::string(field.name) + " must be " + typeName<V>());
+        }
+        else if constexpr (std::is_same_v<V, int>) {
+            constexpr auto lo = std::numeric_limits<int>::min();
+            constexpr auto hi = std::numeric_limits<int>::max();
+            if (s.kind == Scalar::Int && s.i >= lo && s.i <= hi) target = static_cast<int>(s.i);
+            else if (s.kind == Scalar::Uint && s.u <= static_cast<std::uint64_t>(hi)) target = static_cast<int>(s.u);
+            else if (s.kind == Scalar::Int || s.kind == Scalar::Uint) return itemError(std::string(field.name) + " is out of range");
+            else return itemError(std::string(field.name) + " must be " + typeName<V>());
+        }
+        else {
+            static_assert(!sizeof(V), "unsupported request field type");
+        }
+        seen_.set(index);
+    }
+};
+
+namespace request_schema_detail {
+    template <class Request>
+    bool run(std::string_view body, boost::json::basic_parser<RequestReader<Request>>& parser, std::string& error) {
+        boost::json::error_code ec;
+        std::size_t n = parser.write_some(false, body.data(), body.size(), ec);
+        if (ec) {
+            error = !parser.handler().error.empty()
+                ? parser.handler().error
+                : "Invalid JSON at offset " + std::to_string(n) + ": " + ec.message();
+            return false;
+        }
+        if (n < body.size()) {
+            error = "Unexpected data after JSON at offset " + std::to_string(n);
+            return false;
+        }
+        return true;
+    }
+}
+
+// Один объект в out. false — причина в error (для ответа 400)
+template <SchemaRequest Request>
+bool parseRequest(std::string_view body, Request& out, std::string& error) {
+    using Reader = RequestReader<Request>;
+    boost::json::basic_parser<Reader> parser(boost::json::parse_options{}, Reader::Shape::Object);
+    if (!request_schema_detail::run(body, parser, error)) return false;
+
+    auto& reader = parser.handler();
+    if (!reader.item_errors.empty()) {
+        error = std::move(reader.item_errors.front().message);
+        return false;
+    }
+    if (reader.items.empty() || !reader.items.front()) {
+        error = "Expected JSON object";
+        return false;
+    }
+    out = std::move(*reader.items.front());
+    return true;
+}
+
+enum class RequestArrayStatus { Ok, Invalid, TooMany };
+
+// Массив объектов: items[i] == nullopt для элементов с ошибкой, сама ошибка — в item_errors.
+// Invalid — документ целиком не разобран, причина в error; TooMany — элементов больше max_items
+template <SchemaRequest Request>
+RequestArrayStatus parseRequestArray(std::string_view body,
+    std::vector<std::optional<Request>>& items,
+    std::vector<RequestItemError>& item_errors,
+    std::string& error,
+    std::size_t max_items = std::numeric_limits<std::size_t>::max()) {
+    using Reader = RequestReader<Request>;
+    boost::json::basic_parser<Reader> parser(boost::json::parse_options{}, Reader::Shape::Array, max_items);
+    if (!request_schema_detail::run(body, parser, error)) {
+        return parser.handler().too_many ? RequestArrayStatus::TooMany : RequestArrayStatus::Invalid;
+    }
+
+    items = std::move(parser.handler().items);
+    item_errors = std::move(parser.handler().item_errors);
+    return RequestArrayStatus::Ok;
+}
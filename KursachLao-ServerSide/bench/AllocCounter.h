@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+// Счётчик выделений памяти: глобальные operator new/delete в AllocCounter.cpp
+// заменены на версии, которые считают вызовы и байты (все потоки, relaxed).
+namespace alloc_counter {
+
+    std::uint64_t allocations();
+    std::uint64_t bytes();
+
+    // На время цикла бенчмарка: в деструкторе пишет allocs/op и bytes/op в state.counters.
+    // Создавать до for (auto _ : state), чтобы подготовка не попала в счёт
+    class Scope {
+    public:
+        explicit Scope(benchmark::State& state)
+            : state_(state), allocations_(allocations()), bytes_(bytes()) {}
+
+        ~Scope() {
+            // Сначала снимаем оба счётчика: вставка в state.counters сама выделяет память
+            const auto count = static_cast<double>(allocations() - allocations_);
+            const auto size = static_cast<double>(bytes() - bytes_);
+            state_.counters["allocs/op"] = benchmark::Counter(count, benchmark::Counter::kAvgIterations);
+            state_.counters["bytes/op"] = benchmark::Counter(size, benchmark::Counter::kAvgIterations);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        benchmark::State& state_;
+        std::uint64_t allocations_;
+        std::uint64_t bytes_;
+    };
+
+}
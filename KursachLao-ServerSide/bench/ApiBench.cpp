@@ -0,0 +1,108 @@
+﻿#include "AllocCounter.h"
+#include "ApiProcessor.h"
+#include "Models.h"
+#include "MsgPack.h"
+
+#include <boost/json.hpp>
+#include <string>
+#include <vector>
+
+// Разбор target в ApiProcessor и сериализация строк моделей (как в DatabaseMapper::toJsonArray
+// и ApiProcessor::writeBody). Декодирование pqxx::result не входит: без БД результата не получить.
+
+namespace {
+    void BM_GetQueryParam(benchmark::State& state) {
+        const std::string target = "/api/all-data?since=2025-01-01T00:00:00Z&layout=columnar&fields=id,fullname";
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(ApiProcessor::getQueryParam(target, "layout"));
+        }
+    }
+
+    void BM_GetQueryParamMissing(benchmark::State& state) {
+        const std::string target = "/api/all-data";
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(ApiProcessor::getQueryParam(target, "since"));
+        }
+    }
+
+    void BM_ParseIdFromPath(benchmark::State& state) {
+        const std::string path = "/api/employees/12345/penalties";
+        const std::string prefix = "/api/employees/";
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(ApiProcessor::parseIdFromPath(path, prefix));
+        }
+    }
+
+    std::vector<Employee> employees(size_t count) {
+        std::vector<Employee> rows(count);
+        for (size_t i = 0; i < count; ++i) {
+            auto& e = rows[i];
+            e.id = static_cast<int>(i + 1);
+            e.fullname = "Сотрудник Номер " + std::to_string(i + 1);
+            e.status = i % 7 == 0 ? "vacation" : "active";
+            e.salary = 50000 + static_cast<double>(i % 100) * 125.5;
+            e.penalties = static_cast<int>(i % 3);
+            e.bonuses = static_cast<int>(i % 5);
+            e.total_penalties = e.penalties * 1500.0;
+            e.total_bonuses = e.bonuses * 2750.25;
+        }
+        return rows;
+    }
+
+    // Строки в дерево JSON на арене запроса — то, что делает toJsonArray после декодирования
+    boost::json::array toArray(const std::vector<Employee>& rows, const boost::json::storage_ptr& sp) {
+        boost::json::array arr(sp);
+        arr.reserve(rows.size());
+        for (const auto& row : rows) {
+            arr.push_back(boost::json::value_from(row, sp));
+        }
+        return arr;
+    }
+
+    void BM_RowsToJsonTree(benchmark::State& state) {
+        const auto rows = employees(static_cast<size_t>(state.range(0)));
+        RequestArena arena;
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            arena.reset();
+            auto arr = toArray(rows, boost::json::storage_ptr(&arena));
+            benchmark::DoNotOptimize(arr);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // Дерево уже построено: меряется только запись тела ответа
+    template <class Encode>
+    void serializeRows(benchmark::State& state, Encode encode) {
+        const auto rows = employees(static_cast<size_t>(state.range(0)));
+        RequestArena arena;
+        const boost::json::value tree = toArray(rows, boost::json::storage_ptr(&arena));
+        size_t bytes = 0;
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            std::string body = encode(tree);
+            bytes += body.size();
+            benchmark::DoNotOptimize(body.data());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(static_cast<int64_t>(bytes));
+    }
+
+    void BM_SerializeJson(benchmark::State& state) {
+        serializeRows(state, [](const boost::json::value& jv) { return boost::json::serialize(jv); });
+    }
+
+    void BM_SerializeMsgPack(benchmark::State& state) {
+        serializeRows(state, [](const boost::json::value& jv) { return msgpack::encode(jv); });
+    }
+}
+
+BENCHMARK(BM_GetQueryParam);
+BENCHMARK(BM_GetQueryParamMissing);
+BENCHMARK(BM_ParseIdFromPath);
+BENCHMARK(BM_RowsToJsonTree)->Arg(1)->Arg(100)->Arg(1000);
+BENCHMARK(BM_SerializeJson)->Arg(1)->Arg(100)->Arg(1000);
+BENCHMARK(BM_SerializeMsgPack)->Arg(1)->Arg(100)->Arg(1000);
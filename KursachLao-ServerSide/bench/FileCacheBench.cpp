@@ -0,0 +1,56 @@
+﻿#include "AllocCounter.h"
+#include "FileCache.h"
+
+// FileCache на каталоге статики сервера: попадание в кэш, проверка свежести файла, маршрут по пути.
+
+namespace {
+    FileCache& cache() {
+        static FileCache c(KURSACH_BENCH_STATIC_DIR, true, 100);
+        return c;
+    }
+
+    void BM_FileCacheGetHit(benchmark::State& state) {
+        auto& c = cache();
+        const std::string route = "/employees";
+        c.preload_file(route);
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            auto file = c.get_file(route);
+            benchmark::DoNotOptimize(file);
+        }
+    }
+
+    void BM_FileCacheGetMiss(benchmark::State& state) {
+        auto& c = cache();
+        const std::string route = "/no/such/page";
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(c.get_file(route));
+        }
+    }
+
+    // Файл в кэше и не менялся: stat() на каждый запрос (так делает RequestHandler)
+    void BM_FileCacheRefresh(benchmark::State& state) {
+        auto& c = cache();
+        const std::string route = "/employees";
+        c.preload_file(route);
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(c.refresh_file(route));
+        }
+    }
+
+    void BM_FileCacheNormalizeRoute(benchmark::State& state) {
+        auto& c = cache();
+        const fs::path path = fs::path(c.get_base_directory()) / "modules" / "dataCache.js";
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(c.normalize_route(path));
+        }
+    }
+}
+
+BENCHMARK(BM_FileCacheGetHit);
+BENCHMARK(BM_FileCacheGetMiss);
+BENCHMARK(BM_FileCacheRefresh);
+BENCHMARK(BM_FileCacheNormalizeRoute);
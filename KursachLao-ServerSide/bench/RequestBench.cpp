@@ -0,0 +1,120 @@
+﻿#include "AllocCounter.h"
+#include "ApiProcessor.h"
+#include "DoSProtectionModule.h"
+#include "FileCache.h"
+#include "RequestHandler.h"
+
+#include <boost/asio/ip/address.hpp>
+#include <vector>
+
+// Диспетчеризация RequestHandler::handleRequest и проверка соединения в DoSProtectionModule.
+// Запрос собирается на арене, как в session::do_read, — его стоимость входит в замер.
+
+namespace {
+    // Ответ никуда не пишется: только не даём компилятору его выбросить
+    struct NullSend {
+        void operator()(http::response<http::string_body>&& res) const {
+            benchmark::DoNotOptimize(res.body().data());
+        }
+    };
+
+    // Маршруты как в main: "/*" для статики, точный и regex-маршрут API (без БД)
+    struct Dispatch {
+        FileCache cache{ KURSACH_BENCH_STATIC_DIR, true, 100 };
+        RequestHandler handler{ "Bench Request Handler" };
+
+        Dispatch() {
+            handler.setFileCache(&cache);
+            handler.addRouteHandler("/*", [](const sRequest&, sResponce&) {});
+            handler.addRouteHandler("/api/bench", [](const sRequest&, sResponce& res) {
+                res.result(http::status::ok);
+                res.set(http::field::content_type, "application/json");
+                res.body() = R"({"status":"ok"})";
+                });
+            handler.addAsyncDynamicRouteHandler("/api/employees/\\d+(?:/)?",
+                [](const sRequest& req, sResponce&& res, RequestHandler::Responder done) {
+                    const auto id = ApiProcessor::parseIdFromPath(std::string(req.target()), "/api/employees/");
+                    res.result(http::status::ok);
+                    res.set(http::field::content_type, "application/json");
+                    res.body() = R"({"id":)" + std::to_string(id.value_or(0)) + "}";
+                    done(std::move(res));
+                });
+        }
+    };
+
+    Dispatch& dispatch() {
+        static Dispatch d;
+        return d;
+    }
+
+    void BM_Dispatch(benchmark::State& state, const char* target) {
+        auto& d = dispatch();
+        RequestArena arena;
+        RequestContext ctx;
+        ctx.remote = boost::asio::ip::make_address("127.0.0.1");
+        ctx.client = ClientKey::from(ctx.remote);
+
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            arena.reset();
+            sRequest req(std::piecewise_construct,
+                std::make_tuple(ArenaAllocator<char>(&arena)),
+                std::make_tuple(ArenaAllocator<char>(&arena)));
+            req.method(http::verb::get);
+            req.target(target);
+            req.version(11);
+            req.set(http::field::host, "localhost");
+            req.set(http::field::user_agent, "bench");
+            ctx.received = std::chrono::steady_clock::now();
+            d.handler.handleRequest(std::move(req), ctx, NullSend{});
+        }
+    }
+
+    // Адреса 10.x.y.z: range(0) разных клиентов по кругу
+    std::vector<boost::asio::ip::address> clientAddresses(size_t count) {
+        std::vector<boost::asio::ip::address> list;
+        list.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            list.emplace_back(boost::asio::ip::address_v4(static_cast<boost::asio::ip::address_v4::uint_type>(0x0A000000u + i)));
+        }
+        return list;
+    }
+
+    // Принятое соединение: лимиты сняты, чтобы не уйти в бан посреди замера
+    void BM_DoSIsAllowed(benchmark::State& state) {
+        boost::asio::io_context ioc;
+        DoSProtectionModule dos(ioc, "Bench DoSProtection");
+        dos.setConnectionLimit({});
+        const auto addresses = clientAddresses(static_cast<size_t>(state.range(0)));
+
+        size_t i = 0;
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(dos.isAllowed(addresses[i]));
+            if (++i == addresses.size()) i = 0;
+        }
+    }
+
+    // Заблокированный адрес: самый дешёвый отказ, путь под наплывом соединений
+    void BM_DoSIsAllowedBanned(benchmark::State& state) {
+        boost::asio::io_context ioc;
+        DoSProtectionModule dos(ioc, "Bench DoSProtection");
+        dos.setConnectionLimit({ 1.0 / 3600, 1 });
+        const auto address = boost::asio::ip::make_address("10.0.0.1");
+        dos.isAllowed(address);
+        dos.isAllowed(address);
+
+        alloc_counter::Scope allocs(state);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(dos.isAllowed(address));
+        }
+    }
+}
+
+BENCHMARK_CAPTURE(BM_Dispatch, static_hit, "/employees");
+BENCHMARK_CAPTURE(BM_Dispatch, exact_route, "/api/bench");
+BENCHMARK_CAPTURE(BM_Dispatch, dynamic_route, "/api/employees/42");
+BENCHMARK_CAPTURE(BM_Dispatch, not_found, "/api/missing");
+
+BENCHMARK(BM_DoSIsAllowed)->Arg(1)->Arg(4096);
+BENCHMARK(BM_DoSIsAllowedBanned);
@@ -0,0 +1,202 @@
+﻿#pragma once
+
+#include "Models.h"
+#include "DbObserver.h"
+
+#include <pqxx/pqxx>
+#include <array>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Отображение pqxx::result в модели из Models.h.
+// Номера колонок ищутся по имени один раз на результат (RowDecoder),
+// дальше каждая строка читается по индексу с типизированным as<>.
+class DatabaseMapper {
+public:
+    template <MappedModel Model>
+    class RowDecoder {
+    public:
+        // Бросает pqxx::argument_error, если в результате нет нужной колонки
+        explicit RowDecoder(const pqxx::result& result) {
+            size_t i = 0;
+            forEachColumn<Model>([&](const auto& binding) {
+                indexes_[i++] = result.column_number(binding.column);
+            });
+        }
+
+        Model decode(const pqxx::row& row) const {
+            Model model;
+            decodeInto(row, model);
+            return model;
+        }
+
+        // В уже существующую модель: строки переиспользуют свой буфер
+        void decodeInto(const pqxx::row& row, Model& model) const {
+            size_t i = 0;
+            forEachColumn<Model>([&](const auto& binding) {
+                readField(row[indexes_[i++]], model.*binding.member);
+            });
+        }
+
+        // Номер колонки результата для i-й привязки модели
+        pqxx::row::size_type index(size_t i) const { return indexes_[i]; }
+
+    private:
+        std::array<pqxx::row::size_type, modelColumnCount<Model>()> indexes_{};
+    };
+
+    explicit DatabaseMapper(pqxx::transaction_base& txn) : txn_(txn) {}
+
+    pqxx::transaction_base& transaction() { return txn_; }
+
+    // Все SQL-операторы идут через execute: каждый виден наблюдателям (DbObserver) —
+    // спан db.query в трейсе запроса, кандидат в журнал медленных операторов
+    static pqxx::result execute(pqxx::transaction_base& txn, pqxx::zview sql, const pqxx::params& params = {}) {
+        DbObserver::Scope op("db.query", std::string_view(sql.data(), sql.size()), &params);
+        return txn.exec(sql, params);
+    }
+
+    pqxx::result exec(pqxx::zview sql, const pqxx::params& params = {}) {
+        return execute(txn_, sql, params);
+    }
+
+    template <MappedModel Model>
+    static std::vector<Model> map(const pqxx::result& result) {
+        std::vector<Model> models;
+        if (result.empty()) return models;
+
+        RowDecoder<Model> decoder(result);
+        models.reserve(static_cast<size_t>(result.size()));
+        for (const auto& row : result) {
+            models.push_back(decoder.decode(row));
+        }
+        return models;
+    }
+
+    // Сразу в JSON-массив, без промежуточного вектора моделей: одна модель на все строки.
+    // sp — память для JSON (например, арена запроса)
+    template <MappedModel Model>
+    static boost::json::array toJsonArray(const pqxx::result& result, boost::json::storage_ptr sp = {}) {
+        boost::json::array arr(sp);
+        if (result.empty()) return arr;
+
+        RowDecoder<Model> decoder(result);
+        Model model;
+        arr.reserve(static_cast<size_t>(result.size()));
+        for (const auto& row : result) {
+            decoder.decodeInto(row, model);
+            arr.push_back(boost::json::value_from(model, sp));
+        }
+        return arr;
+    }
+
+    // Колоночный вид: {"layout":"columnar","fields":[...],"types":[...],"rows":N,"columns":[[...],...]}.
+    // Имена полей не повторяются в каждой строке; значения читаются из результата
+    // колонка за колонкой, без промежуточных моделей и объектов на строку.
+    template <MappedModel Model>
+    static boost::json::object toJsonColumns(const pqxx::result& result, boost::json::storage_ptr sp = {}) {
+        constexpr size_t kColumns = modelColumnCount<Model>();
+        const auto rows = static_cast<size_t>(result.size());
+
+        boost::json::array fields(sp);
+        boost::json::array types(sp);
+        boost::json::array columns(sp);
+        fields.reserve(kColumns);
+        types.reserve(kColumns);
+        columns.reserve(kColumns);
+
+        std::optional<RowDecoder<Model>> decoder;
+        if (rows > 0) decoder.emplace(result);
+
+        size_t c = 0;
+        forEachColumn<Model>([&](const auto& binding) {
+            using T = typename std::decay_t<decltype(binding)>::value_type;
+            fields.emplace_back(binding.json);
+            types.emplace_back(columnTypeName<T>());
+
+            boost::json::array column(sp);
+            column.reserve(rows);
+            if (decoder) {
+                const auto index = decoder->index(c);
+                T value{};
+                for (const auto& row : result) {
+                    readField(row[index], value);
+                    column.emplace_back(value);
+                }
+            }
+            columns.emplace_back(std::move(column));
+            ++c;
+        });
+
+        boost::json::object out(sp);
+        out.reserve(5);
+        out["layout"] = "columnar";
+        out["fields"] = std::move(fields);
+        out["types"] = std::move(types);
+        out["rows"] = rows;
+        out["columns"] = std::move(columns);
+        return out;
+    }
+
+    template <MappedModel Model>
+    static std::optional<Model> mapOne(const pqxx::result& result) {
+        if (result.empty()) return std::nullopt;
+        return RowDecoder<Model>(result).decode(result[0]);
+    }
+
+    template <MappedModel Model>
+    std::vector<Model> query(pqxx::zview sql, const pqxx::params& params = {}) {
+        return map<Model>(exec(sql, params));
+    }
+
+    template <MappedModel Model>
+    boost::json::object queryJsonColumns(pqxx::zview sql, const pqxx::params& params = {}, boost::json::storage_ptr sp = {}) {
+        auto result = exec(sql, params);
+        DbObserver::Scope decode("db.decode");
+        return toJsonColumns<Model>(result, std::move(sp));
+    }
+
+    template <MappedModel Model>
+    boost::json::array queryJson(pqxx::zview sql, const pqxx::params& params = {}, boost::json::storage_ptr sp = {}) {
+        auto result = exec(sql, params);
+        DbObserver::Scope decode("db.decode");
+        return toJsonArray<Model>(result, std::move(sp));
+    }
+
+    // Для INSERT/UPDATE ... RETURNING: nullopt, если строка не затронута
+    template <MappedModel Model>
+    std::optional<Model> queryOne(pqxx::zview sql, const pqxx::params& params = {}) {
+        return mapOne<Model>(exec(sql, params));
+    }
+
+    // Список колонок модели для SELECT: "id, fullname, ..."
+    template <MappedModel Model>
+    static const std::string& selectList() {
+        static const std::string list = [] {
+            std::string s;
+            forEachColumn<Model>([&s](const auto& binding) {
+                if (!s.empty()) s += ", ";
+                s += binding.column;
+            });
+            return s;
+        }();
+        return list;
+    }
+
+private:
+    pqxx::transaction_base& txn_;
+
+    // NULL даёт значение по умолчанию (пустая строка, 0)
+    template <class T>
+    static void readField(const pqxx::field& field, T& out) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            if (field.is_null()) out.clear();
+            else out.assign(field.c_str(), field.size());
+        }
+        else {
+            out = field.is_null() ? T{} : field.as<T>();
+        }
+    }
+};
@@ -1,4 +1,5 @@
 ﻿#include "DatabaseModule.h"
+#include "Migrations.h"
 
 DatabaseModule::DatabaseModule(boost::asio::io_context& ioc, const std::string& conn_str)
     : BaseModule("DatabaseModule", -1)
@@ -26,9 +27,7 @@ void DatabaseModule::asyncInitializeDatabase() {
                 throw std::runtime_error("DB connection failded!");
             }
 
-            pqxx::work txn(*conn_);// FIXME: Будет ли оно постоянно перезаписывать базу данных? Для презентации пока сгодится
-            txn.exec(init_schema_sql_);
-            txn.commit();
+            applyMigrations(*conn_);
 
             db_ready_.store(true);
             std::cout << "[DatabaseModule] DataBase ready!\n";
@@ -40,6 +39,44 @@ void DatabaseModule::asyncInitializeDatabase() {
         });
 }   
 
+void DatabaseModule::applyMigrations(pqxx::connection& conn) {
+    int applied = 0;
+    {
+        pqxx::work txn(conn);
+        txn.exec(pqxx::zview(
+            "CREATE TABLE IF NOT EXISTS schema_version ("
+            "version INTEGER PRIMARY KEY, "
+            "description TEXT NOT NULL, "
+            "applied_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP)"));
+        applied = txn.query_value<int>(pqxx::zview("SELECT COALESCE(MAX(version), 0) FROM schema_version"));
+        txn.commit();
+    }
+
+    // Обычный рестарт: схема актуальна, дальше ничего не выполняется и не блокируется
+    for (const auto& migration : schemaMigrations()) {
+        if (migration.version <= applied) {
+            continue;
+        }
+
+        pqxx::work txn(conn);
+        // Advisory-лок на время транзакции: два процесса не применят один шаг дважды
+        txn.exec(pqxx::zview("SELECT pg_advisory_xact_lock(hashtext('schema_version'))"));
+
+        int current = txn.query_value<int>(pqxx::zview("SELECT COALESCE(MAX(version), 0) FROM schema_version"));
+        if (migration.version <= current) {
+            continue;  // Параллельный старт успел раньше — транзакция откатится без изменений
+        }
+
+        txn.exec(pqxx::zview(migration.sql));
+        txn.exec(pqxx::zview("INSERT INTO schema_version (version, description) VALUES ($1, $2)"),
+            pqxx::params{ migration.version, migration.description });
+        txn.commit();
+
+        std::cout << "[DatabaseModule] Applied migration " << migration.version
+            << ": " << migration.description << "\n";
+    }
+}
+
 void DatabaseModule::onShutdown() {
     std::cout << "[DatabaseModule] Shutdowning Databese module...\n";
 
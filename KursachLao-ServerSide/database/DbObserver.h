@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace pqxx {
+    class params;
+}
+
+// Наблюдатели операций с БД: трейсинг (Tracer), журнал медленных операторов (SlowLog).
+// Слой БД о них не знает — DatabaseMapper и потоковые списки открывают DbObserver::Scope,
+// а модули сами добавляют себя в onInitialize и снимаются в onShutdown (до и после работы io_context).
+// Список — фиксированный массив атомарных указателей: область не берёт блокировок,
+// а без наблюдателей не читает даже часы.
+class DbObserver {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Operation {
+        const char* name;                       // Имя спана: "db.query", "db.stream", "db.decode"
+        std::string_view sql;                   // Текст оператора; пусто — не оператор (разбор результата)
+        const pqxx::params* params = nullptr;   // Параметры оператора, если есть
+    };
+
+    static constexpr std::size_t kMaxObservers = 4;
+
+    virtual ~DbObserver() = default;
+
+    // Начало операции, на её потоке. Возвращённое значение придёт в onEnd той же операции
+    virtual std::uint64_t onBegin(const Operation&) { return 0; }
+    virtual void onEnd(const Operation& op, std::uint64_t token, Clock::duration elapsed) = 0;
+
+    // false — все места заняты
+    static bool add(DbObserver* observer) {
+        for (auto& slot : slots()) {
+            DbObserver* expected = nullptr;
+            if (slot.compare_exchange_strong(expected, observer, std::memory_order_acq_rel)) return true;
+        }
+        return false;
+    }
+
+    static void remove(DbObserver* observer) {
+        for (auto& slot : slots()) {
+            DbObserver* expected = observer;
+            slot.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+        }
+    }
+
+    // Одна операция: onBegin у наблюдателей в начале области, onEnd в обратном порядке в конце.
+    // sql и params должны жить до конца области
+    class Scope {
+    public:
+        explicit Scope(const char* name, std::string_view sql = {}, const pqxx::params* params = nullptr)
+            : op_{ name, sql, params } {
+            auto& observers = slots();
+            for (std::size_t i = 0; i < kMaxObservers; ++i) {
+                observers_[i] = observers[i].load(std::memory_order_acquire);
+                if (!observers_[i]) continue;
+                tokens_[i] = observers_[i]->onBegin(op_);
+                any_ = true;
+            }
+            if (any_) start_ = Clock::now();
+        }
+
+        ~Scope() {
+            if (!any_) return;
+            const auto elapsed = Clock::now() - start_;
+            for (std::size_t i = kMaxObservers; i-- > 0;) {
+                if (observers_[i]) observers_[i]->onEnd(op_, tokens_[i], elapsed);
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Operation op_;
+        std::array<DbObserver*, kMaxObservers> observers_{};    // Снимок: onEnd получат те же, что onBegin
+        std::array<std::uint64_t, kMaxObservers> tokens_{};
+        bool any_ = false;
+        Clock::time_point start_{};
+    };
+
+private:
+    static std::array<std::atomic<DbObserver*>, kMaxObservers>& slots() {
+        static std::array<std::atomic<DbObserver*>, kMaxObservers> observers{};
+        return observers;
+    }
+};
@@ -0,0 +1,266 @@
+﻿#pragma once
+
+#include <vector>
+
+// Версионированные миграции схемы.
+// DatabaseModule::applyMigrations применяет шаги с version > MAX(schema_version.version),
+// каждый в отдельной транзакции. Уже выпущенные шаги не меняем — только добавляем новые в конец.
+struct Migration {
+    int version;
+    const char* description;
+    const char* sql;
+};
+
+inline const std::vector<Migration>& schemaMigrations() {
+    static const std::vector<Migration> migrations = {
+        { 1, "baseline schema: tables, counter triggers", R"(
+            CREATE TABLE IF NOT EXISTS employees (
+                id SERIAL PRIMARY KEY,
+                fullname TEXT NOT NULL,
+                status TEXT NOT NULL CHECK (status IN ('hired', 'fired', 'interview')),
+                salary NUMERIC(12,2) NOT NULL DEFAULT 0,
+                penalties_count INTEGER DEFAULT 0,
+                bonuses_count INTEGER DEFAULT 0,
+                total_penalties NUMERIC(12,2) DEFAULT 0,
+                total_bonuses NUMERIC(12,2) DEFAULT 0,
+                created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+                updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+            );
+
+            CREATE TABLE IF NOT EXISTS work_hours (
+                employee_id INTEGER PRIMARY KEY REFERENCES employees(id) ON DELETE CASCADE,
+                regular_hours NUMERIC(8,2) DEFAULT 0,
+                overtime NUMERIC(8,2) DEFAULT 0,
+                undertime NUMERIC(8,2) DEFAULT 0,
+                updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+            );
+
+            CREATE TABLE IF NOT EXISTS penalties (
+                id SERIAL PRIMARY KEY,
+                employee_id INTEGER REFERENCES employees(id) ON DELETE CASCADE,
+                reason TEXT NOT NULL,
+                amount NUMERIC(12,2) NOT NULL,
+                created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+            );
+
+            CREATE TABLE IF NOT EXISTS bonuses (
+                id SERIAL PRIMARY KEY,
+                employee_id INTEGER REFERENCES employees(id) ON DELETE CASCADE,
+                note TEXT NOT NULL,
+                amount NUMERIC(12,2) NOT NULL,
+                created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+            );
+
+            -- Триггеры для автоматического обновления счётчиков.
+            -- Уровня оператора с transition-таблицей: пакетная вставка обновляет
+            -- каждого сотрудника один раз, а не по разу на строку.
+            CREATE OR REPLACE FUNCTION update_employee_penalties() RETURNS TRIGGER AS $$
+            BEGIN
+                UPDATE employees e
+                SET penalties_count = e.penalties_count + d.cnt,
+                    total_penalties = e.total_penalties + d.total,
+                    updated_at = CURRENT_TIMESTAMP
+                FROM (SELECT employee_id, COUNT(*) AS cnt, SUM(amount) AS total
+                      FROM new_rows GROUP BY employee_id) d
+                WHERE e.id = d.employee_id;
+                RETURN NULL;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            DROP TRIGGER IF EXISTS trg_penalty_insert ON penalties;
+            CREATE TRIGGER trg_penalty_insert
+                AFTER INSERT ON penalties
+                REFERENCING NEW TABLE AS new_rows
+                FOR EACH STATEMENT
+                EXECUTE FUNCTION update_employee_penalties();
+
+            CREATE OR REPLACE FUNCTION update_employee_bonuses() RETURNS TRIGGER AS $$
+            BEGIN
+                UPDATE employees e
+                SET bonuses_count = e.bonuses_count + d.cnt,
+                    total_bonuses = e.total_bonuses + d.total,
+                    updated_at = CURRENT_TIMESTAMP
+                FROM (SELECT employee_id, COUNT(*) AS cnt, SUM(amount) AS total
+                      FROM new_rows GROUP BY employee_id) d
+                WHERE e.id = d.employee_id;
+                RETURN NULL;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            DROP TRIGGER IF EXISTS trg_bonus_insert ON bonuses;
+            CREATE TRIGGER trg_bonus_insert
+                AFTER INSERT ON bonuses
+                REFERENCING NEW TABLE AS new_rows
+                FOR EACH STATEMENT
+                EXECUTE FUNCTION update_employee_bonuses();
+
+            -- Автоматическое обновление updated_at в work_hours
+            CREATE OR REPLACE FUNCTION update_hours_timestamp() RETURNS TRIGGER AS $$
+            BEGIN
+                NEW.updated_at = CURRENT_TIMESTAMP;
+                RETURN NEW;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            DROP TRIGGER IF EXISTS trg_hours_update ON work_hours;
+            CREATE TRIGGER trg_hours_update
+                BEFORE UPDATE ON work_hours
+                FOR EACH ROW
+                EXECUTE FUNCTION update_hours_timestamp();
+        )" },
+
+        // Индексы под горячие запросы: фильтры ?since= в /api/all-data,
+        // MAX(updated_at/created_at) для lastUpdated и выборки по сотруднику
+        { 2, "indexes for since filters and employee lookups", R"(
+            CREATE INDEX IF NOT EXISTS idx_penalties_employee_id ON penalties (employee_id);
+            CREATE INDEX IF NOT EXISTS idx_bonuses_employee_id ON bonuses (employee_id);
+            CREATE INDEX IF NOT EXISTS idx_employees_updated_at ON employees (updated_at);
+            CREATE INDEX IF NOT EXISTS idx_work_hours_updated_at ON work_hours (updated_at);
+            CREATE INDEX IF NOT EXISTS idx_penalties_created_at ON penalties (created_at);
+            CREATE INDEX IF NOT EXISTS idx_bonuses_created_at ON bonuses (created_at);
+        )" },
+
+        // Сводка для дашборда (одна строка) вместо SUM по всем сотрудникам на каждый запрос.
+        // Поддерживается цепочкой триггеров: триггеры штрафов/бонусов обновляют счётчики
+        // в employees, а триггер на employees переносит разницу в сводку. Смена статуса
+        // и часы учитываются так же — по разнице до/после оператора.
+        { 3, "dashboard_summary maintained by triggers", R"(
+            CREATE TABLE IF NOT EXISTS dashboard_summary (
+                id SMALLINT PRIMARY KEY DEFAULT 1 CHECK (id = 1),
+                penalties BIGINT NOT NULL DEFAULT 0,
+                bonuses BIGINT NOT NULL DEFAULT 0,
+                undertime NUMERIC(14,2) NOT NULL DEFAULT 0
+            );
+
+            INSERT INTO dashboard_summary (id, penalties, bonuses, undertime)
+            SELECT 1,
+                COALESCE((SELECT SUM(penalties_count) FROM employees WHERE status = 'hired'), 0),
+                COALESCE((SELECT SUM(bonuses_count) FROM employees WHERE status = 'hired'), 0),
+                COALESCE((SELECT SUM(wh.undertime) FROM work_hours wh
+                          JOIN employees e ON e.id = wh.employee_id
+                          WHERE e.status = 'hired'), 0)
+            ON CONFLICT (id) DO NOTHING;
+
+            CREATE OR REPLACE FUNCTION dashboard_employees_changed() RETURNS TRIGGER AS $$
+            BEGIN
+                IF TG_OP = 'INSERT' THEN
+                    UPDATE dashboard_summary s
+                    SET penalties = s.penalties + d.penalties,
+                        bonuses = s.bonuses + d.bonuses
+                    FROM (SELECT COALESCE(SUM(penalties_count), 0) AS penalties,
+                                 COALESCE(SUM(bonuses_count), 0) AS bonuses
+                          FROM new_rows WHERE status = 'hired') d
+                    WHERE s.id = 1 AND (d.penalties <> 0 OR d.bonuses <> 0);
+                ELSE
+                    UPDATE dashboard_summary s
+                    SET penalties = s.penalties + d.penalties,
+                        bonuses = s.bonuses + d.bonuses,
+                        undertime = s.undertime + d.undertime
+                    FROM (SELECT
+                            COALESCE(SUM(CASE WHEN n.status = 'hired' THEN n.penalties_count ELSE 0 END
+                                       - CASE WHEN o.status = 'hired' THEN o.penalties_count ELSE 0 END), 0) AS penalties,
+                            COALESCE(SUM(CASE WHEN n.status = 'hired' THEN n.bonuses_count ELSE 0 END
+                                       - CASE WHEN o.status = 'hired' THEN o.bonuses_count ELSE 0 END), 0) AS bonuses,
+                            COALESCE(SUM(CASE
+                                WHEN n.status = 'hired' AND o.status <> 'hired' THEN COALESCE(wh.undertime, 0)
+                                WHEN n.status <> 'hired' AND o.status = 'hired' THEN -COALESCE(wh.undertime, 0)
+                                ELSE 0 END), 0) AS undertime
+                          FROM new_rows n
+                          JOIN old_rows o ON o.id = n.id
+                          LEFT JOIN work_hours wh ON wh.employee_id = n.id) d
+                    WHERE s.id = 1 AND (d.penalties <> 0 OR d.bonuses <> 0 OR d.undertime <> 0);
+                END IF;
+                RETURN NULL;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            DROP TRIGGER IF EXISTS trg_dashboard_employees_insert ON employees;
+            CREATE TRIGGER trg_dashboard_employees_insert
+                AFTER INSERT ON employees
+                REFERENCING NEW TABLE AS new_rows
+                FOR EACH STATEMENT
+                EXECUTE FUNCTION dashboard_employees_changed();
+
+            DROP TRIGGER IF EXISTS trg_dashboard_employees_update ON employees;
+            CREATE TRIGGER trg_dashboard_employees_update
+                AFTER UPDATE ON employees
+                REFERENCING OLD TABLE AS old_rows NEW TABLE AS new_rows
+                FOR EACH STATEMENT
+                EXECUTE FUNCTION dashboard_employees_changed();
+
+            -- Удаление: BEFORE ROW, пока строка work_hours ещё не удалена каскадом
+            CREATE OR REPLACE FUNCTION dashboard_employee_deleted() RETURNS TRIGGER AS $$
+            BEGIN
+                IF OLD.status = 'hired' THEN
+                    UPDATE dashboard_summary
+                    SET penalties = penalties - OLD.penalties_count,
+                        bonuses = bonuses - OLD.bonuses_count,
+                        undertime = undertime - COALESCE(
+                            (SELECT undertime FROM work_hours WHERE employee_id = OLD.id), 0)
+                    WHERE id = 1;
+                END IF;
+                RETURN OLD;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            DROP TRIGGER IF EXISTS trg_dashboard_employee_delete ON employees;
+            CREATE TRIGGER trg_dashboard_employee_delete
+                BEFORE DELETE ON employees
+                FOR EACH ROW
+                EXECUTE FUNCTION dashboard_employee_deleted();
+
+            CREATE OR REPLACE FUNCTION dashboard_hours_changed() RETURNS TRIGGER AS $$
+            BEGIN
+                IF TG_OP = 'INSERT' THEN
+                    UPDATE dashboard_summary s
+                    SET undertime = s.undertime + d.delta
+                    FROM (SELECT COALESCE(SUM(n.undertime), 0) AS delta
+                          FROM new_rows n JOIN employees e ON e.id = n.employee_id
+                          WHERE e.status = 'hired') d
+                    WHERE s.id = 1 AND d.delta <> 0;
+                ELSIF TG_OP = 'UPDATE' THEN
+                    UPDATE dashboard_summary s
+                    SET undertime = s.undertime + d.delta
+                    FROM (SELECT COALESCE(SUM(n.undertime - o.undertime), 0) AS delta
+                          FROM new_rows n
+                          JOIN old_rows o ON o.employee_id = n.employee_id
+                          JOIN employees e ON e.id = n.employee_id
+                          WHERE e.status = 'hired') d
+                    WHERE s.id = 1 AND d.delta <> 0;
+                ELSE
+                    -- При каскадном удалении сотрудника его уже нет — вклад снят в dashboard_employee_deleted
+                    UPDATE dashboard_summary s
+                    SET undertime = s.undertime - d.delta
+                    FROM (SELECT COALESCE(SUM(o.undertime), 0) AS delta
+                          FROM old_rows o JOIN employees e ON e.id = o.employee_id
+                          WHERE e.status = 'hired') d
+                    WHERE s.id = 1 AND d.delta <> 0;
+                END IF;
+                RETURN NULL;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            DROP TRIGGER IF EXISTS trg_dashboard_hours_insert ON work_hours;
+            CREATE TRIGGER trg_dashboard_hours_insert
+                AFTER INSERT ON work_hours
+                REFERENCING NEW TABLE AS new_rows
+                FOR EACH STATEMENT
+                EXECUTE FUNCTION dashboard_hours_changed();
+
+            DROP TRIGGER IF EXISTS trg_dashboard_hours_update ON work_hours;
+            CREATE TRIGGER trg_dashboard_hours_update
+                AFTER UPDATE ON work_hours
+                REFERENCING OLD TABLE AS old_rows NEW TABLE AS new_rows
+                FOR EACH STATEMENT
+                EXECUTE FUNCTION dashboard_hours_changed();
+
+            DROP TRIGGER IF EXISTS trg_dashboard_hours_delete ON work_hours;
+            CREATE TRIGGER trg_dashboard_hours_delete
+                AFTER DELETE ON work_hours
+                REFERENCING OLD TABLE AS old_rows
+                FOR EACH STATEMENT
+                EXECUTE FUNCTION dashboard_hours_changed();
+        )" },
+    };
+    return migrations;
+}
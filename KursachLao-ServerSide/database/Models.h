@@ -0,0 +1,168 @@
+﻿#pragma once
+
+#include <boost/json.hpp>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+// Модели строк БД. Привязка колонок описана на этапе компиляции:
+// имя поля в JSON, колонка в БД и указатель на член структуры.
+// По этому описанию DatabaseMapper декодирует pqxx::result, а tag_invoke ниже
+// собирает JSON — без поиска колонок по имени в каждой строке.
+
+template <class Model, class T>
+struct ColumnBinding {
+    using model_type = Model;
+    using value_type = T;
+
+    const char* json;    // имя поля в ответе API
+    const char* column;  // колонка в БД
+    T Model::* member;
+};
+
+template <class Model, class T>
+constexpr ColumnBinding<Model, T> bindColumn(const char* json, const char* column, T Model::* member) {
+    return { json, column, member };
+}
+
+// Специализируется для каждой модели: table и columns (tuple из ColumnBinding)
+template <class Model>
+struct ModelTraits;
+
+template <class Model>
+concept MappedModel = requires { ModelTraits<Model>::columns; };
+
+template <class Model>
+constexpr size_t modelColumnCount() {
+    return std::tuple_size_v<std::remove_const_t<decltype(ModelTraits<Model>::columns)>>;
+}
+
+struct Employee {
+    int id = 0;
+    std::string fullname;
+    std::string status;
+    double salary = 0;
+    int penalties = 0;
+    int bonuses = 0;
+    double total_penalties = 0;
+    double total_bonuses = 0;
+};
+
+template <>
+struct ModelTraits<Employee> {
+    static constexpr const char* table = "employees";
+    static constexpr auto columns = std::make_tuple(
+        bindColumn("id", "id", &Employee::id),
+        bindColumn("fullname", "fullname", &Employee::fullname),
+        bindColumn("status", "status", &Employee::status),
+        bindColumn("salary", "salary", &Employee::salary),
+        bindColumn("penalties", "penalties_count", &Employee::penalties),
+        bindColumn("bonuses", "bonuses_count", &Employee::bonuses),
+        bindColumn("totalPenalties", "total_penalties", &Employee::total_penalties),
+        bindColumn("totalBonuses", "total_bonuses", &Employee::total_bonuses));
+};
+
+struct Hours {
+    int employee_id = 0;
+    double regular_hours = 0;
+    double overtime = 0;
+    double undertime = 0;
+};
+
+template <>
+struct ModelTraits<Hours> {
+    static constexpr const char* table = "work_hours";
+    static constexpr auto columns = std::make_tuple(
+        bindColumn("employeeId", "employee_id", &Hours::employee_id),
+        bindColumn("regularHours", "regular_hours", &Hours::regular_hours),
+        bindColumn("overtime", "overtime", &Hours::overtime),
+        bindColumn("undertime", "undertime", &Hours::undertime));
+};
+
+struct Penalty {
+    int id = 0;
+    int employee_id = 0;
+    std::string reason;
+    double amount = 0;
+    std::string date;  // created_at в текстовом виде PostgreSQL
+};
+
+template <>
+struct ModelTraits<Penalty> {
+    static constexpr const char* table = "penalties";
+    static constexpr auto columns = std::make_tuple(
+        bindColumn("id", "id", &Penalty::id),
+        bindColumn("employeeId", "employee_id", &Penalty::employee_id),
+        bindColumn("reason", "reason", &Penalty::reason),
+        bindColumn("amount", "amount", &Penalty::amount),
+        bindColumn("date", "created_at", &Penalty::date));
+};
+
+struct Bonus {
+    int id = 0;
+    int employee_id = 0;
+    std::string note;
+    double amount = 0;
+    std::string date;
+};
+
+template <>
+struct ModelTraits<Bonus> {
+    static constexpr const char* table = "bonuses";
+    static constexpr auto columns = std::make_tuple(
+        bindColumn("id", "id", &Bonus::id),
+        bindColumn("employeeId", "employee_id", &Bonus::employee_id),
+        bindColumn("note", "note", &Bonus::note),
+        bindColumn("amount", "amount", &Bonus::amount),
+        bindColumn("date", "created_at", &Bonus::date));
+};
+
+// Строка dashboard_summary (миграция 3)
+struct Dashboard {
+    long long penalties = 0;
+    long long bonuses = 0;
+    double undertime = 0;
+};
+
+template <>
+struct ModelTraits<Dashboard> {
+    static constexpr const char* table = "dashboard_summary";
+    static constexpr auto columns = std::make_tuple(
+        bindColumn("penalties", "penalties", &Dashboard::penalties),
+        bindColumn("bonuses", "bonuses", &Dashboard::bonuses),
+        bindColumn("undertime", "undertime", &Dashboard::undertime));
+};
+
+// Обход привязок модели: f(binding) для каждой колонки по порядку
+template <MappedModel Model, class F>
+constexpr void forEachColumn(F&& f) {
+    std::apply([&f](const auto&... binding) { (f(binding), ...); }, ModelTraits<Model>::columns);
+}
+
+// Имена типов колонок в ответе ?layout=columnar ("types"). Одни и те же
+// для DatabaseMapper::toJsonColumns и потокового списка в ApiProcessor
+namespace column_type {
+    inline constexpr const char* kInt = "int";
+    inline constexpr const char* kNumber = "number";
+    inline constexpr const char* kString = "string";
+}
+
+template <class T>
+constexpr const char* columnTypeName() {
+    if constexpr (std::is_same_v<T, std::string>) return column_type::kString;
+    else if constexpr (std::is_integral_v<T>) return column_type::kInt;
+    else {
+        static_assert(std::is_arithmetic_v<T>, "unsupported column type");
+        return column_type::kNumber;
+    }
+}
+
+// boost::json::value_from(model) и value_from(std::vector<Model>) — находится через ADL
+template <MappedModel Model>
+void tag_invoke(const boost::json::value_from_tag&, boost::json::value& jv, const Model& model) {
+    boost::json::object& obj = jv.emplace_object();
+    obj.reserve(modelColumnCount<Model>());
+    forEachColumn<Model>([&](const auto& binding) {
+        obj.emplace(binding.json, model.*binding.member);
+    });
+}
@@ -0,0 +1,324 @@
+﻿#include "SlowLog.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+
+namespace bj = boost::json;
+
+namespace {
+    Counter& slowRequests() {
+        static Counter& c = MetricsRegistry::instance().counter("slow_requests_total",
+            "Requests slower than the slow request threshold");
+        return c;
+    }
+
+    Counter& slowQueries() {
+        static Counter& c = MetricsRegistry::instance().counter("slow_queries_total",
+            "SQL statements slower than the slow query threshold");
+        return c;
+    }
+
+    std::string isoTime(std::chrono::system_clock::time_point time) {
+        const auto t = std::chrono::system_clock::to_time_t(time);
+        std::tm tm{};
+#ifdef _WIN32
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "%04d-%02d-%02dT%02d:%02d:%02dZ",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        return buf;
+    }
+
+    double millis(SlowLog::Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    const char* planStateName(SlowLog::PlanState state) {
+        switch (state) {
+        case SlowLog::PlanState::Pending: return "pending";
+        case SlowLog::PlanState::Done: return "done";
+        case SlowLog::PlanState::Failed: return "failed";
+        case SlowLog::PlanState::RateLimited: return "rate_limited";
+        case SlowLog::PlanState::Disabled: return "disabled";
+        default: return "none";
+        }
+    }
+
+    // Только SELECT выполняется повторно под ANALYZE; WITH может содержать INSERT/UPDATE
+    bool isSelect(std::string_view sql) {
+        size_t i = 0;
+        while (i < sql.size() && std::isspace(static_cast<unsigned char>(sql[i]))) ++i;
+        constexpr std::string_view kw = "select";
+        if (sql.size() - i < kw.size()) return false;
+        for (size_t k = 0; k < kw.size(); ++k) {
+            if (std::tolower(static_cast<unsigned char>(sql[i + k])) != kw[k]) return false;
+        }
+        return sql.size() - i == kw.size() || !std::isalnum(static_cast<unsigned char>(sql[i + kw.size()]));
+    }
+
+    // Ключи, значения которых не содержат персональных данных
+    bool keepValue(std::string_view key) {
+        return key == "after_id" || key == "limit" || key == "fields" || key == "layout" || key == "since";
+    }
+
+    constexpr size_t kMaxStatement = 4096;
+}
+
+SlowLog::SlowLog(Options options, const std::string& name, const int& id)
+    : BaseModule(name, id), options_(std::move(options)) {
+}
+
+SlowLog::~SlowLog() {
+    shutdown();
+}
+
+bool SlowLog::onInitialize() {
+    if (options_.capacity == 0) {
+        return true;  // Выключен
+    }
+    slowRequests();
+    slowQueries();
+    if (!options_.connection_string.empty() && !options_.explain_rate.unlimited()) {
+        stopping_ = false;
+        worker_ = std::thread(&SlowLog::run, this);
+    }
+    if (options_.query_threshold.count() > 0) DbObserver::add(this);
+    LOG_INFO("SlowLog: requests over " << millis(options_.request_threshold) << " ms, statements over "
+        << millis(options_.query_threshold) << " ms"
+        << (worker_.joinable() ? "" : " (no EXPLAIN)"));
+    return true;
+}
+
+void SlowLog::onShutdown() {
+    DbObserver::remove(this);
+    if (!worker_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void SlowLog::onEnd(const Operation& op, std::uint64_t, Clock::duration elapsed) {
+    if (op.sql.empty() || elapsed < options_.query_threshold) return;
+    recordQuery(op.sql, op.params, elapsed);
+}
+
+SlowLog::Entry& SlowLog::push(Entry&& entry) {
+    entry.id = next_id_++;
+    entry.time = std::chrono::system_clock::now();
+    const Tracer::Active& trace = Tracer::current();
+    if (trace.tracer) {
+        // traceparent: "00-<trace-id>-..."
+        entry.trace_id = trace.context.traceparent().substr(3, 32);
+    }
+    if (entries_.size() >= options_.capacity) entries_.pop_front();
+    entries_.push_back(std::move(entry));
+    return entries_.back();
+}
+
+void SlowLog::recordRequest(std::string_view method, std::string_view route, std::string_view target,
+    unsigned status, Clock::duration total, Clock::duration db_time) {
+    if (options_.capacity == 0 || options_.request_threshold.count() == 0) return;
+    slowRequests().inc();
+
+    Entry entry;
+    entry.method = method;
+    entry.route = route;
+    entry.params = redactQuery(target);
+    entry.status = status;
+    entry.total = total;
+    entry.db_time = db_time;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    push(std::move(entry));
+}
+
+void SlowLog::recordQuery(std::string_view sql, const pqxx::params* params, Clock::duration elapsed) {
+    slowQueries().inc();
+
+    Entry entry;
+    entry.query = true;
+    entry.statement = redactLiterals(sql.substr(0, kMaxStatement));
+    entry.param_count = params ? static_cast<size_t>(params->size()) : 0;
+    entry.total = elapsed;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& stored = push(std::move(entry));
+    if (!worker_.joinable()) {
+        stored.plan_state = PlanState::Disabled;
+    }
+    else if (jobs_.size() >= kMaxPendingPlans || !explain_bucket_.take(options_.explain_rate, Clock::now())) {
+        stored.plan_state = PlanState::RateLimited;
+    }
+    else {
+        stored.plan_state = PlanState::Pending;
+        Job job;
+        job.entry_id = stored.id;
+        job.sql = std::string(sql);
+        if (params) job.params = *params;
+        jobs_.push_back(std::move(job));
+        wake_.notify_one();
+    }
+}
+
+void SlowLog::setPlan(std::uint64_t id, PlanState state, std::string plan) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Запись могла уже вытесниться из кольца
+    auto it = std::find_if(entries_.begin(), entries_.end(), [id](const Entry& e) { return e.id == id; });
+    if (it == entries_.end()) return;
+    it->plan_state = state;
+    it->plan = std::move(plan);
+}
+
+void SlowLog::run() {
+    // Отдельное соединение: основное принадлежит потоку io_context, и план не должен его занимать
+    std::unique_ptr<pqxx::connection> conn;
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) break;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        try {
+            if (!conn || !conn->is_open()) {
+                conn = std::make_unique<pqxx::connection>(options_.connection_string);
+            }
+            setPlan(job.entry_id, PlanState::Done, redactLiterals(explain(*conn, job)));
+        }
+        catch (const pqxx::broken_connection& e) {
+            conn.reset();
+            setPlan(job.entry_id, PlanState::Failed, e.what());
+        }
+        catch (const std::exception& e) {
+            // Например, оператор над временной таблицей другого соединения
+            setPlan(job.entry_id, PlanState::Failed, redactLiterals(e.what()));
+        }
+    }
+}
+
+std::string SlowLog::explain(pqxx::connection& conn, const Job& job) {
+    const bool analyze = isSelect(job.sql);
+    const std::string sql = (analyze ? "EXPLAIN (ANALYZE, BUFFERS) " : "EXPLAIN ") + job.sql;
+
+    pqxx::result result;
+    if (analyze) {
+        pqxx::read_transaction txn(conn);
+        txn.exec(pqxx::zview("SET LOCAL statement_timeout = '30s'"));
+        result = txn.exec(pqxx::zview(sql), job.params);
+    }
+    else {
+        // Без commit: транзакция откатывается в деструкторе
+        pqxx::work txn(conn);
+        result = txn.exec(pqxx::zview(sql), job.params);
+    }
+
+    std::string plan;
+    for (const auto& row : result) {
+        if (!plan.empty()) plan += '\n';
+        plan += row[0].c_str();
+    }
+    return plan;
+}
+
+std::string SlowLog::redactLiterals(std::string_view sql) {
+    std::string out;
+    out.reserve(sql.size());
+    for (size_t i = 0; i < sql.size(); ++i) {
+        if (sql[i] != '\'') {
+            out += sql[i];
+            continue;
+        }
+        // '' внутри литерала — экранированная кавычка
+        size_t j = i + 1;
+        while (j < sql.size()) {
+            if (sql[j] == '\'') {
+                if (j + 1 < sql.size() && sql[j + 1] == '\'') j += 2;
+                else break;
+            }
+            else {
+                ++j;
+            }
+        }
+        out += "'?'";
+        i = j;
+    }
+    return out;
+}
+
+std::string SlowLog::redactQuery(std::string_view target) {
+    const auto pos = target.find('?');
+    if (pos == std::string_view::npos) return {};
+
+    std::string out;
+    std::string_view query = target.substr(pos + 1);
+    while (!query.empty()) {
+        const auto amp = query.find('&');
+        const std::string_view pair = query.substr(0, amp);
+        query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+        if (pair.empty()) continue;
+
+        const auto eq = pair.find('=');
+        const std::string_view key = pair.substr(0, eq);
+        if (!out.empty()) out += '&';
+        out += key;
+        if (eq != std::string_view::npos) {
+            out += '=';
+            if (keepValue(key)) out += pair.substr(eq + 1);
+            else out += '?';
+        }
+    }
+    return out;
+}
+
+bj::object SlowLog::report() const {
+    bj::object out;
+    out["requestThresholdMs"] = millis(options_.request_threshold);
+    out["queryThresholdMs"] = millis(options_.query_threshold);
+
+    bj::array list;
+    std::lock_guard<std::mutex> lock(mutex_);
+    list.reserve(entries_.size());
+    for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+        const Entry& e = *it;
+        bj::object item;
+        item["id"] = e.id;
+        item["time"] = isoTime(e.time);
+        item["kind"] = e.query ? "query" : "request";
+        if (e.query) {
+            item["statement"] = e.statement;
+            item["params"] = e.param_count;
+            item["durationMs"] = millis(e.total);
+            bj::object plan;
+            plan["state"] = planStateName(e.plan_state);
+            plan["text"] = e.plan;
+            item["plan"] = std::move(plan);
+        }
+        else {
+            item["method"] = e.method;
+            item["route"] = e.route;
+            item["query"] = e.params;
+            item["status"] = e.status;
+            item["durationMs"] = millis(e.total);
+            item["dbMs"] = millis(e.db_time);
+        }
+        if (!e.trace_id.empty()) item["traceId"] = e.trace_id;
+        list.push_back(std::move(item));
+    }
+    out["entries"] = std::move(list);
+    return out;
+}
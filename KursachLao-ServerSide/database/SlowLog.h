@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+#include "DbObserver.h"
+#include "RateLimit.h"
+
+#include <boost/json.hpp>
+#include <pqxx/pqxx>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Медленные запросы и SQL-операторы (/admin/slow).
+// Запрос дольше request_threshold или оператор дольше query_threshold попадает в кольцо последних
+// capacity записей: маршрут или текст оператора, параметры (значения скрыты), времена, id трейса.
+// Для оператора фоновый поток снимает план на своём соединении — не чаще explain_rate,
+// чтобы разбор медленных запросов сам не стал нагрузкой на базу.
+// EXPLAIN ANALYZE выполняет оператор ещё раз, поэтому (ANALYZE, BUFFERS) — только для SELECT
+// в READ ONLY транзакции; для изменений — план без выполнения. Литералы в тексте и плане
+// заменяются на '?': в журнал не попадают ФИО, причины штрафов и т.п.
+// Операторы приходят через DbObserver (DatabaseMapper::execute, потоковые списки).
+class SlowLog : public BaseModule, private DbObserver {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::string connection_string;                                      // Для EXPLAIN; пусто — без планов
+        Clock::duration request_threshold = std::chrono::milliseconds(500); // 0 — не отслеживать
+        Clock::duration query_threshold = std::chrono::milliseconds(100);   // 0 — не отслеживать
+        RateLimit explain_rate{ 0.1, 3 };                                   // Планов в секунду:запас
+        size_t capacity = 64;
+    };
+
+    enum class PlanState { None, Pending, Done, Failed, RateLimited, Disabled };
+
+    struct Entry {
+        std::uint64_t id = 0;
+        std::chrono::system_clock::time_point time{};
+        bool query = false;             // Оператор SQL или запрос целиком
+        std::string method;             // Только запрос
+        std::string route;              // Шаблон маршрута
+        std::string params;             // Запрос: query-строка со скрытыми значениями
+        std::string statement;          // Оператор: текст без литералов
+        size_t param_count = 0;         // Оператор: число $N, значения не хранятся
+        unsigned status = 0;
+        Clock::duration total{};
+        Clock::duration db_time{};
+        std::string trace_id;           // Если запрос попал в выборку Tracer
+        PlanState plan_state = PlanState::None;
+        std::string plan;
+    };
+
+    explicit SlowLog(Options options, const std::string& name = "SlowLog", const int& id = -1);
+    ~SlowLog() override;
+
+    SlowLog(const SlowLog&) = delete;
+    SlowLog& operator=(const SlowLog&) = delete;
+
+    Clock::duration requestThreshold() const { return options_.request_threshold; }
+
+    // Из RequestHandler при отправке ответа, если total >= requestThreshold()
+    void recordRequest(std::string_view method, std::string_view route, std::string_view target,
+        unsigned status, Clock::duration total, Clock::duration db_time);
+
+    void recordQuery(std::string_view sql, const pqxx::params* params, Clock::duration elapsed);
+
+    // Содержимое кольца, новые записи первыми
+    boost::json::object report() const;
+
+    // 'ФИО' -> '?'; E'' и $$-строки не встречаются в наших запросах
+    static std::string redactLiterals(std::string_view sql);
+    // ?after_id=10&status=hired -> after_id=10&status=?  (значения пагинации и проекции оставляем)
+    static std::string redactQuery(std::string_view target);
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    struct Job {
+        std::uint64_t entry_id = 0;
+        std::string sql;
+        pqxx::params params;    // Копия: наши параметры владеют значениями (string, числа), не zview
+    };
+
+    const Options options_;
+
+    mutable std::mutex mutex_;      // Кольцо, очередь планов, лимит
+    std::deque<Entry> entries_;
+    std::uint64_t next_id_ = 1;
+    TokenBucket explain_bucket_;
+    std::deque<Job> jobs_;
+    static constexpr size_t kMaxPendingPlans = 8;
+
+    std::thread worker_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    // Оператор дольше query_threshold — в журнал; разбор результата (пустой sql) не считаем
+    void onEnd(const Operation& op, std::uint64_t token, Clock::duration elapsed) override;
+
+    Entry& push(Entry&& entry);
+    void setPlan(std::uint64_t id, PlanState state, std::string plan);
+    void run();
+    static std::string explain(pqxx::connection& conn, const Job& job);
+};
@@ -0,0 +1,138 @@
+﻿#include "WriteBatcher.h"
+#include "DbTime.h"
+#include "Tracer.h"
+#include "StallWatchdog.h"
+
+#include <boost/json.hpp>
+#include <iostream>
+
+namespace bj = boost::json;
+
+namespace {
+    void setJsonError(http::response<http::string_body>& res, http::status status, const std::string& message) {
+        bj::object err;
+        err["error"] = message;
+        res.result(status);
+        res.set(http::field::content_type, "application/json");
+        res.body() = bj::serialize(err);
+    }
+}
+
+WriteBatcher::WriteBatcher(boost::asio::io_context& ioc,
+    DatabaseModule* db_module,
+    std::chrono::microseconds window,
+    size_t max_items)
+    : BaseModule("WriteBatcher")
+    , db_module_(db_module)
+    , timer_(ioc)
+    , window_(window)
+    , max_items_(max_items > 0 ? max_items : 1)
+    , queue_wait_(MetricsRegistry::instance().histogram("db_batch_queue_wait_seconds",
+        "Time a write waits in the group-commit queue before its transaction starts"))
+    , batch_time_(MetricsRegistry::instance().histogram("db_batch_duration_seconds",
+        "Group-commit transaction time, BEGIN to COMMIT"))
+    , batches_(MetricsRegistry::instance().counter("db_batches_total", "Group-commit transactions"))
+    , batched_writes_(MetricsRegistry::instance().counter("db_batched_writes_total", "Writes executed through group commit"))
+{}
+
+WriteBatcher::~WriteBatcher() {
+    shutdown();
+}
+
+bool WriteBatcher::onInitialize() {
+    if (window_.count() > 0) {
+        std::cout << "[WriteBatcher] Group commit enabled: window " << window_.count()
+            << " us, up to " << max_items_ << " operations per transaction\n";
+    }
+    pending_.reserve(max_items_);
+    return true;
+}
+
+void WriteBatcher::onShutdown() {
+    timer_.cancel();
+    flush();  // Не теряем уже принятые операции
+}
+
+void WriteBatcher::submit(http::response<http::string_body>&& res, Apply apply, Done done) {
+    pending_.push_back({ std::move(res), std::move(apply), std::move(done), {}, std::chrono::steady_clock::now(), Tracer::current() });
+
+    if (pending_.size() >= max_items_) {
+        timer_.cancel();
+        flush();
+        return;
+    }
+
+    // Первая операция в пакете запускает окно ожидания
+    if (pending_.size() == 1) {
+        timer_.expires_after(window_);
+        timer_.async_wait([this](const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::operation_aborted) {
+                return;
+            }
+            flush();
+            });
+    }
+}
+
+void WriteBatcher::flush() {
+    if (pending_.empty()) {
+        return;
+    }
+
+    StallWatchdog::Activity activity("WriteBatcher::flush");
+    std::vector<Pending> batch;
+    batch.swap(pending_);
+    pending_.reserve(max_items_);
+
+    const auto started = std::chrono::steady_clock::now();
+    for (const auto& item : batch) queue_wait_.record(started - item.queued);
+    batches_.inc();
+    batched_writes_.inc(batch.size());
+
+    pqxx::connection* conn = db_module_ ? db_module_->getConnection() : nullptr;
+    if (!conn) {
+        for (auto& item : batch) {
+            setJsonError(item.res, http::status::service_unavailable, "Database not ready");
+        }
+    }
+    else {
+        DbTime::Scope shared_time;  // BEGIN + COMMIT — делится поровну между операциями
+        try {
+            pqxx::work txn(*conn);
+            for (auto& item : batch) {
+                DbTime::Scope item_time;
+                Tracer::Activation trace(item.trace);
+                Tracer::Span span("db.batch.apply");
+                // Точка сохранения: ошибка одной операции не откатывает остальные
+                try {
+                    pqxx::subtransaction sub(txn);
+                    item.apply(sub, item.res);
+                    sub.commit();
+                }
+                catch (const std::exception& e) {
+                    setJsonError(item.res, http::status::internal_server_error, e.what());
+                }
+                item.db_time = item_time.elapsed();
+            }
+            txn.commit();
+        }
+        catch (const std::exception& e) {
+            // Общий коммит не прошёл — не сохранилась ни одна операция пакета
+            for (auto& item : batch) {
+                setJsonError(item.res, http::status::internal_server_error,
+                    std::string("Batch commit failed: ") + e.what());
+            }
+        }
+
+        auto own_time = std::chrono::steady_clock::duration::zero();
+        for (const auto& item : batch) own_time += item.db_time;
+        batch_time_.record(shared_time.elapsed());
+        const auto shared = (shared_time.elapsed() - own_time) / static_cast<long>(batch.size());
+        for (auto& item : batch) item.db_time += shared;
+    }
+
+    for (auto& item : batch) {
+        DbTime::current() = item.db_time;  // Журнал доступа прочитает при отправке ответа
+        item.done(std::move(item.res));
+    }
+}
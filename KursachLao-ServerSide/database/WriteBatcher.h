@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+#include "DatabaseModule.h"
+#include "Metrics.h"
+#include "Tracer.h"
+
+#include <boost/asio.hpp>
+#include <boost/beast/http.hpp>
+#include <pqxx/pqxx>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace http = boost::beast::http;
+
+// Групповой коммит для мелких изменений (штрафы, бонусы, часы, сотрудники).
+// Операции, пришедшие в течение окна (window) или до набора max_items, выполняются
+// в одной транзакции: каждая в своей точке сохранения, коммит (и fsync) — один на пакет.
+// Каждый HTTP-запрос получает свой собственный ответ или ошибку.
+// Окно 0 — батчинг выключен, ApiProcessor выполняет операции сразу.
+class WriteBatcher : public BaseModule {
+public:
+    // Операция записи: работает в переданной транзакции и заполняет ответ
+    using Apply = std::function<void(pqxx::transaction_base&, http::response<http::string_body>&)>;
+    // Отправка ответа клиенту (совпадает с RequestHandler::Responder)
+    using Done = std::function<void(http::response<http::string_body>&&)>;
+
+    WriteBatcher(boost::asio::io_context& ioc,
+        DatabaseModule* db_module,
+        std::chrono::microseconds window = std::chrono::microseconds(0),
+        size_t max_items = 64);
+
+    ~WriteBatcher() override;
+
+    WriteBatcher(const WriteBatcher&) = delete;
+    WriteBatcher& operator=(const WriteBatcher&) = delete;
+
+    // true — submit() поставит операцию в очередь, а не выполнит её сразу
+    bool isActive() const { return isInitialized() && isEnabled() && window_.count() > 0; }
+
+    void submit(http::response<http::string_body>&& res, Apply apply, Done done);
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    struct Pending {
+        http::response<http::string_body> res;
+        Apply apply;
+        Done done;
+        std::chrono::steady_clock::duration db_time{};  // Своя точка сохранения + доля общего коммита
+        std::chrono::steady_clock::time_point queued{};
+        Tracer::Active trace;   // Трейс запроса: операция пакета — его спан
+    };
+
+    DatabaseModule* db_module_;
+    boost::asio::steady_timer timer_;
+    std::chrono::microseconds window_;
+    size_t max_items_;
+
+    std::vector<Pending> pending_;
+
+    // Отдельного пула соединений нет: ожидание БД для записи — это время в очереди пакета
+    LatencyHistogram& queue_wait_;
+    LatencyHistogram& batch_time_;
+    Counter& batches_;
+    Counter& batched_writes_;
+
+    void flush();
+};
@@ -6,138 +6,129 @@
 #include <string>
 #include <optional>
 
+// Типизированные запросы к БД поверх DatabaseMapper. Работает в транзакции маппера:
+// BEGIN/COMMIT — забота вызывающего (ApiProcessor или WriteBatcher).
 class HRDatabaseHandlers {
 public:
     explicit HRDatabaseHandlers(DatabaseMapper& mapper) : mapper_(mapper) {}
 
-    // GET /api/all-data?since=2025-01-01T00:00:00Z
-    boost::json::object getAllData(const std::optional<std::string>& since) {
+    // GET /api/all-data?since=2025-01-01T00:00:00Z[&layout=columnar]
+    // sp — память для JSON-дерева ответа (арена запроса); по умолчанию — куча.
+    // columnar — коллекции в колоночном виде (см. DatabaseMapper::toJsonColumns)
+    boost::json::object getAllData(const std::optional<std::string>& since,
+        boost::json::storage_ptr sp = {},
+        bool columnar = false) {
+        // У штрафов и бонусов нет updated_at — они только добавляются, фильтруем по created_at
         std::string since_filter;
+        std::string since_created_filter;
+        pqxx::params params;
         if (since) {
-            since_filter = " WHERE last_updated > " + mapper_.db_.quote(*since);
+            since_filter = " WHERE updated_at > $1";
+            since_created_filter = " WHERE created_at > $1";
+            params.append(*since);
         }
 
-        // Employees
-        auto employees = mapper_.query<Employee>(
-            "SELECT id, fullname, status, salary, penalties, bonuses, total_penalties, total_bonuses, last_updated "
-            "FROM employees" + since_filter + " ORDER BY id");
-
-        // Hours (upsert логика на фронте, но храним одну запись на сотрудника)
-        auto hours = mapper_.query<Hours>(
-            "SELECT employee_id, regular_hours, overtime, undertime, last_updated "
-            "FROM hours" + since_filter + " ORDER BY employee_id");
-
-        // Penalties & Bonuses
-        auto penalties = mapper_.query<Penalty>(
-            "SELECT id, employee_id, reason, amount, date "
-            "FROM penalties" + since_filter + " ORDER BY date DESC");
-
-        auto bonuses = mapper_.query<Bonus>(
-            "SELECT id, employee_id, note, amount, date "
-            "FROM bonuses" + since_filter + " ORDER BY date DESC");
-
-        // Dashboard aggregates (только для hired)
-        Dashboard dash{};
-        auto res = mapper_.db_.query(
-            R"(SELECT 
-                COALESCE(SUM(penalties), 0) AS penalties,
-                COALESCE(SUM(bonuses), 0) AS bonuses,
-                COALESCE(SUM(undertime), 0) AS undertime
-               FROM employees e
-               LEFT JOIN hours h ON h.employee_id = e.id
-               WHERE e.status = 'hired')");
-        if (!res.size().empty()) {
-            dash.penalties = res.get<int>(0, "penalties");
-            dash.bonuses = res.get<int>(0, "bonuses");
-            dash.undertime = res.get<double>(0, "undertime");
-        }
-
-        // Последнее обновление
-        std::string current_ts = getCurrentTimestamp();
+        boost::json::object response(sp);
+        response.reserve(6);
+        response["dashboard"] = boost::json::value_from(getDashboard(), sp);
+        response["employees"] = collection<Employee>("employees", since_filter, params, sp, columnar);
+        // Часы: одна запись на сотрудника
+        response["hours"] = collection<Hours>("work_hours", since_filter, params, sp, columnar);
+        response["penalties"] = collection<Penalty>("penalties", since_created_filter, params, sp, columnar);
+        response["bonuses"] = collection<Bonus>("bonuses", since_created_filter, params, sp, columnar);
 
-        boost::json::object response;
-        response["dashboard"] = boost::json::value_from(dash);
-        response["employees"] = boost::json::value_from(employees);
-        response["hours"] = boost::json::value_from(hours);
-        response["penalties"] = boost::json::value_from(penalties);
-        response["bonuses"] = boost::json::value_from(bonuses);
-        response["lastUpdated"] = current_ts;
+        response["lastUpdated"] = getLastUpdated();
 
         return response;
     }
 
-    // POST /api/employees
-    Employee createEmployee(const Employee& input) {
-        return mapper_.insert<Employee>(
-            R"(INSERT INTO employees (fullname, status, salary, penalties, bonuses, total_penalties, total_bonuses)
-               VALUES ($1, $2, $3, 0, 0, 0.0, 0.0)
-               RETURNING id, fullname, status, salary, penalties, bonuses, total_penalties, total_bonuses, last_updated)",
-            input.fullname, input.status, input.salary);
-    }
-
-    // POST /api/hours/:employeeId (upsert)
-    Hours upsertHours(int employee_id, const Hours& input) {
-        return mapper_.insert<Hours>(
-            R"(INSERT INTO hours (employee_id, regular_hours, overtime, undertime)
-               VALUES ($1, $2, $3, $4)
-               ON CONFLICT (employee_id) DO UPDATE
-               SET regular_hours = EXCLUDED.regular_hours,
-                   overtime = EXCLUDED.overtime,
-                   undertime = EXCLUDED.undertime
-               RETURNING employee_id, regular_hours, overtime, undertime, last_updated)",
-            employee_id, input.regular_hours, input.overtime, input.undertime);
+    // Сводка дашборда (только для hired) — строка dashboard_summary, её ведут триггеры
+    Dashboard getDashboard() {
+        auto dash = mapper_.queryOne<Dashboard>(
+            "SELECT " + DatabaseMapper::selectList<Dashboard>() + " FROM dashboard_summary WHERE id = 1");
+        return dash.value_or(Dashboard{});
     }
 
-    // POST /api/employees/:employeeId/penalties
-    Penalty createPenalty(int employee_id, const Penalty& input) {
-        // Транзакция: штраф + обновление счётчиков сотрудника
-        mapper_.execute("BEGIN");
-
-        auto penalty = mapper_.insert<Penalty>(
-            R"(INSERT INTO penalties (employee_id, reason, amount, date)
-               VALUES ($1, $2, $3, NOW())
-               RETURNING id, employee_id, reason, amount, date)",
-            employee_id, input.reason, input.amount);
+    // POST /api/employees — вместе с пустой записью часов
+    Employee createEmployee(const std::string& fullname, const std::string& status, double salary) {
+        auto employee = mapper_.queryOne<Employee>(
+            "INSERT INTO employees (fullname, status, salary) VALUES ($1, $2, $3) "
+            "RETURNING " + DatabaseMapper::selectList<Employee>(),
+            pqxx::params{ fullname, status, salary });
 
-        mapper_.execute(
-            R"(UPDATE employees
-               SET penalties = penalties + 1,
-                   total_penalties = total_penalties + $1
-               WHERE id = $2)",
-            input.amount, employee_id);
+        mapper_.exec(pqxx::zview("INSERT INTO work_hours (employee_id) VALUES ($1)"),
+            pqxx::params{ employee->id });
 
-        mapper_.execute("COMMIT");
-
-        return penalty;
+        return *employee;
     }
 
-    // POST /api/employees/:employeeId/bonuses
-    Bonus createBonus(int employee_id, const Bonus& input) {
-        mapper_.execute("BEGIN");
+    // PUT /api/employees/:id. set_clause — "col = $1, ...", id передаётся последним параметром
+    std::optional<Employee> updateEmployee(const std::string& set_clause, const pqxx::params& params) {
+        return mapper_.queryOne<Employee>(
+            "UPDATE employees SET " + set_clause +
+            " WHERE id = $" + std::to_string(params.size()) +
+            " RETURNING " + DatabaseMapper::selectList<Employee>(),
+            params);
+    }
 
-        auto bonus = mapper_.insert<Bonus>(
-            R"(INSERT INTO bonuses (employee_id, note, amount, date)
-               VALUES ($1, $2, $3, NOW())
-               RETURNING id, employee_id, note, amount, date)",
-            employee_id, input.note, input.amount);
+    // POST /api/hours/:employeeId (upsert)
+    Hours upsertHours(int employee_id, double regular_hours, double overtime, double undertime) {
+        auto hours = mapper_.queryOne<Hours>(
+            "INSERT INTO work_hours (employee_id, regular_hours, overtime, undertime) "
+            "VALUES ($1, $2, $3, $4) "
+            "ON CONFLICT (employee_id) DO UPDATE SET "
+            "regular_hours = EXCLUDED.regular_hours, "
+            "overtime = EXCLUDED.overtime, "
+            "undertime = EXCLUDED.undertime "
+            "RETURNING " + DatabaseMapper::selectList<Hours>(),
+            pqxx::params{ employee_id, regular_hours, overtime, undertime });
+        return *hours;
+    }
 
-        mapper_.execute(
-            R"(UPDATE employees
-               SET bonuses = bonuses + 1,
-                   total_bonuses = total_bonuses + $1
-               WHERE id = $2)",
-            input.amount, employee_id);
+    bool isHired(int employee_id) {
+        auto r = mapper_.exec(
+            pqxx::zview("SELECT 1 FROM employees WHERE id = $1 AND status = 'hired'"),
+            pqxx::params{ employee_id });
+        return !r.empty();
+    }
 
-        mapper_.execute("COMMIT");
+    // POST /api/employees/:employeeId/penalties. Счётчики сотрудника обновляет триггер
+    Penalty createPenalty(int employee_id, const std::string& reason, double amount) {
+        auto penalty = mapper_.queryOne<Penalty>(
+            "INSERT INTO penalties (employee_id, reason, amount) VALUES ($1, $2, $3) "
+            "RETURNING " + DatabaseMapper::selectList<Penalty>(),
+            pqxx::params{ employee_id, reason, amount });
+        return *penalty;
+    }
 
-        return bonus;
+    // POST /api/employees/:employeeId/bonuses
+    Bonus createBonus(int employee_id, const std::string& note, double amount) {
+        auto bonus = mapper_.queryOne<Bonus>(
+            "INSERT INTO bonuses (employee_id, note, amount) VALUES ($1, $2, $3) "
+            "RETURNING " + DatabaseMapper::selectList<Bonus>(),
+            pqxx::params{ employee_id, note, amount });
+        return *bonus;
     }
 
 private:
     DatabaseMapper& mapper_;
 
-    std::string getCurrentTimestamp() {
-        auto res = mapper_.db_.query("SELECT NOW()::text");
-        return res.get<std::string>(0, "now");
+    template <MappedModel Model>
+    boost::json::value collection(const char* table, const std::string& filter,
+        const pqxx::params& params, const boost::json::storage_ptr& sp, bool columnar) {
+        std::string sql = "SELECT " + DatabaseMapper::selectList<Model>() + " FROM " + table + filter;
+        if (columnar) return mapper_.queryJsonColumns<Model>(sql, params, sp);
+        return mapper_.queryJson<Model>(sql, params, sp);
+    }
+
+    std::string getLastUpdated() {
+        return mapper_.exec(R"(
+            SELECT GREATEST(
+                COALESCE((SELECT MAX(updated_at) FROM employees),  '1970-01-01'::timestamp),
+                COALESCE((SELECT MAX(updated_at) FROM work_hours),  '1970-01-01'::timestamp),
+                COALESCE((SELECT MAX(created_at) FROM penalties), '1970-01-01'::timestamp),
+                COALESCE((SELECT MAX(created_at) FROM bonuses),   '1970-01-01'::timestamp)
+            )::text
+        )")[0][0].as<std::string>();
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,100 @@
+﻿#include "AccessLog.h"
+#include "JsonEscape.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+#include <boost/beast/http/verb.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace {
+    std::tm utcTime(std::time_t t) {
+        std::tm tm{};
+#ifdef _WIN32
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        return tm;
+    }
+}
+
+AccessLog::AccessLog(Options options, const std::string& name, const int& id)
+    : BaseModule(name, id), writer_(std::move(options), std::chrono::milliseconds(200)) {
+}
+
+AccessLog::~AccessLog() {
+    shutdown();
+}
+
+bool AccessLog::onInitialize() {
+    if (writer_.options().path.empty()) {
+        return true;  // Журнал выключен — record() ничего не делает
+    }
+    // Строка на запись, без обрамления пачки
+    BatchFileWriter<Entry, 16384>::Format format;
+    format.append = &AccessLog::appendEntry;
+    format.max_batch = 4096;
+    if (!writer_.start(std::move(format))) {
+        LOG_ERROR("AccessLog: cannot open " << writer_.options().path.string());
+        return false;
+    }
+    MetricsRegistry::instance().addCallback(MetricsRegistry::Type::Counter, "access_log_dropped_total",
+        "Access log entries lost because the queue was full", {}, [this] { return static_cast<double>(dropped()); });
+    LOG_INFO("AccessLog: writing to " << writer_.options().path.string());
+    return true;
+}
+
+void AccessLog::onShutdown() {
+    writer_.stop();
+}
+
+void AccessLog::record(const ClientKey& client, boost::beast::http::verb method, std::string_view route,
+    unsigned status, std::uint64_t bytes, Clock::duration db_time, Clock::duration total_time) {
+    if (!active()) return;
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    writer_.push([&](Entry& e) {
+        e.time = std::chrono::system_clock::now();
+        e.client = client;
+        e.method = method;
+        e.status = status;
+        e.bytes = bytes;
+        e.db_us = duration_cast<microseconds>(db_time).count();
+        e.total_us = duration_cast<microseconds>(total_time).count();
+        e.route_size = static_cast<std::uint8_t>(std::min(route.size(), sizeof e.route));
+        std::memcpy(e.route, route.data(), e.route_size);
+    });
+}
+
+void AccessLog::appendEntry(std::string& out, const Entry& e) {
+    const auto t = std::chrono::system_clock::to_time_t(e.time);
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(e.time.time_since_epoch()).count() % 1000;
+    const std::tm tm = utcTime(t);
+    char ts[32];
+    std::snprintf(ts, sizeof ts, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+        tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>(ms));
+
+    out += R"({"ts":")";
+    out += ts;
+    out += R"(","client":")";
+    out += e.client.toAddress().to_string();
+    out += R"(","method":")";
+    const auto method = boost::beast::http::to_string(e.method);
+    out.append(method.data(), method.size());
+    out += R"(","route":")";
+    appendJsonEscaped(out, std::string_view(e.route, e.route_size));
+    out += R"(","status":)";
+    out += std::to_string(e.status);
+    out += R"(,"bytes":)";
+    out += std::to_string(e.bytes);
+    out += R"(,"dbUs":)";
+    out += std::to_string(e.db_us);
+    out += R"(,"totalUs":)";
+    out += std::to_string(e.total_us);
+    out += "}\n";
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+#include "AddressTable.h"
+#include "BatchFileWriter.h"
+
+#include <boost/beast/http/verb.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Журнал доступа: одна JSON-строка на запрос
+//   {"ts":"2026-01-01T12:00:00.123Z","client":"10.0.0.5","method":"GET","route":"/api/employees/\\d+(?:/)?",
+//    "status":200,"bytes":512,"dbUs":840,"totalUs":1210}
+// route — шаблон маршрута (ключ или regex), а не сам путь: так строки группируются без разбора.
+// Поток запроса только копирует запись фиксированного размера в очередь BatchFileWriter; файл пишет
+// фоновый поток пачками, с ротацией по размеру и возрасту файла. Если очередь полна, запись
+// теряется и считается в dropped().
+class AccessLog : public BaseModule {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::chrono::system_clock::time_point time{};
+        ClientKey client;
+        boost::beast::http::verb method = boost::beast::http::verb::unknown;
+        unsigned status = 0;
+        std::uint64_t bytes = 0;
+        std::int64_t db_us = 0;
+        std::int64_t total_us = 0;
+        std::uint8_t route_size = 0;
+        char route[96];
+    };
+
+    using Options = RotatingFile::Options;    // Пустой path — журнал выключен
+
+    explicit AccessLog(Options options, const std::string& name = "AccessLog", const int& id = -1);
+    ~AccessLog() override;
+
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    bool active() const { return writer_.active(); }
+
+    // Вызывается из потока запроса; не блокируется и не выделяет память
+    void record(const ClientKey& client, boost::beast::http::verb method, std::string_view route,
+        unsigned status, std::uint64_t bytes, Clock::duration db_time, Clock::duration total_time);
+
+    unsigned long long dropped() const { return writer_.dropped(); }
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    BatchFileWriter<Entry, 16384> writer_;
+
+    static void appendEntry(std::string& out, const Entry& e);
+};
@@ -1,4 +1,6 @@
 ﻿#include "FileCache.h"
+#include "Logger.h"
+#include "Metrics.h"
 #include <iostream>
 #include <fstream>
 #include <algorithm>  // Для std::transform
@@ -41,7 +43,7 @@ namespace {
             }
         }
         catch (const std::exception& e) {
-            std::cerr << "Error reading file " << file_path << ": " << e.what() << std::endl;
+            LOG_ERROR("Error reading file " << file_path << ": " << e.what());
         }
         return std::nullopt;
     }
@@ -65,6 +67,20 @@ bool FileCache::onInitialize() {
         return false;
     }
     std::cout << "FileCache onInitialize: " << route_to_path_.size() << " routes ready." << std::endl;
+
+    // Для /metrics всё берётся из get_cache_info в момент выдачи
+    using Type = MetricsRegistry::Type;
+    auto& metrics = MetricsRegistry::instance();
+    metrics.addCallback(Type::Counter, "filecache_hits_total", "Static file requests served from memory", {},
+        [this] { return static_cast<double>(get_cache_info().hits); });
+    metrics.addCallback(Type::Counter, "filecache_misses_total", "Static file requests read from disk", {},
+        [this] { return static_cast<double>(get_cache_info().misses); });
+    metrics.addCallback(Type::Counter, "filecache_evictions_total", "Files evicted because the cache was full", {},
+        [this] { return static_cast<double>(get_cache_info().evictions); });
+    metrics.addCallback(Type::Gauge, "filecache_files", "Files currently cached", {},
+        [this] { return static_cast<double>(get_cache_info().cached_files_count); });
+    metrics.addCallback(Type::Gauge, "filecache_bytes", "Bytes currently cached", {},
+        [this] { return static_cast<double>(get_cache_info().total_cache_size_bytes); });
     return true;
 }
 
@@ -223,7 +239,7 @@ std::optional<FileCache::CachedFile> FileCache::load_file_from_disk(const fs::pa
         return cached_file;
     }
     catch (const std::exception& e) {
-        std::cerr << "Error creating cached file for " << file_path << ": " << e.what() << std::endl;
+        LOG_ERROR("Error creating cached file for " << file_path << ": " << e.what());
         return std::nullopt;
     }
 }
@@ -244,6 +260,7 @@ void FileCache::evict_if_needed() {
     if (oldest != file_cache_.end()) {
         total_cache_size_ -= oldest->second.size;
         file_cache_.erase(oldest);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
     }
 }
 
@@ -267,6 +284,7 @@ std::optional<FileCache::CachedFile> FileCache::get_file(const std::string& rout
     fs::path file_path = path_it->second;
     // Если кэш отключен, загружаем файл с диска каждый раз
     if (!cache_enabled_) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
         return load_file_from_disk(file_path);
     }
     // Проверяем, есть ли файл в кэше
@@ -274,9 +292,11 @@ std::optional<FileCache::CachedFile> FileCache::get_file(const std::string& rout
     if (cache_it != file_cache_.end()) {
         // Обновляем время доступа
         cache_it->second.last_accessed = std::chrono::system_clock::now();
+        hits_.fetch_add(1, std::memory_order_relaxed);
         return cache_it->second;
     }
     // Загружаем файл с диска
+    misses_.fetch_add(1, std::memory_order_relaxed);
     auto cached_file = load_file_from_disk(file_path);
     if (!cached_file) {
         return std::nullopt;
@@ -404,6 +424,9 @@ FileCache::CacheInfo FileCache::get_cache_info() const {
     info.total_cache_size_bytes = total_cache_size_;
     info.max_cache_size = max_cache_size_;
     info.cache_enabled = cache_enabled_;
+    info.hits = hits_.load(std::memory_order_relaxed);
+    info.misses = misses_.load(std::memory_order_relaxed);
+    info.evictions = evictions_.load(std::memory_order_relaxed);
     return info;
 }
 
@@ -464,7 +487,7 @@ bool FileCache::refresh_file(const std::string& route) {
         return true;
     }
     catch (const std::exception& e) {
-        std::cerr << "Error refreshing file " << route << ": " << e.what() << std::endl;
+        LOG_ERROR("Error refreshing file " << route << ": " << e.what());
         return false;
     }
 }
@@ -10,6 +10,7 @@
 #include <vector>
 #include <functional>
 #include <mutex>
+#include <atomic>
 
 namespace fs = std::filesystem;
 
@@ -32,9 +33,13 @@ private:
     size_t max_cache_size_;
     size_t total_cache_size_;
 
+    // Счётчики для get_cache_info и /metrics
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> misses_{ 0 };       // Файл читался с диска (в т.ч. при выключенном кэше)
+    std::atomic<uint64_t> evictions_{ 0 };    // Вытеснено при переполнении
+
     // Вспомогательные методы (без изменений)
     std::string get_mime_type(const std::string& extension) const;
-    std::string normalize_route(const fs::path& file_path) const;
     std::optional<CachedFile> load_file_from_disk(const fs::path& file_path) const;
     void evict_if_needed();
     void scan_directory(const fs::path& directory);
@@ -68,6 +73,8 @@ public:
     bool route_exists(const std::string& route) const;
     std::optional<std::string> get_mime_type_for_route(const std::string& route) const;
     bool refresh_file(const std::string& route);
+    // Маршрут файла: путь от base_directory_ без расширения, index — корень каталога
+    std::string normalize_route(const fs::path& file_path) const;
 
     // Структуры для статистики (без изменений)
     struct CacheInfo {
@@ -76,6 +83,9 @@ public:
         size_t total_cache_size_bytes;
         size_t max_cache_size;
         bool cache_enabled;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
     };
     struct CacheStats {
         struct FileStat {
@@ -50,14 +50,15 @@ public:
             http::async_write(
                 stream_,
                 *sp,
-                [this, sp, close_ptr = &close_](beast::error_code ec, std::size_t bytes) {  // NEW: Log bytes
-                    if (after_write_cb_) {
-                        after_write_cb_(ec);
-                    }
+                // Без this: отправитель может быть временным объектом, жизнь сессии держит колбек
+                [sp, cb = after_write_cb_, &stream = stream_, close_ptr = &close_](beast::error_code ec, std::size_t bytes) {  // NEW: Log bytes
                     if (!ec && *close_ptr) {
                         // FIXED: Half-close (shutdown_send) — client reads response, но no more writes
                         beast::error_code sec;
-                        beast::get_lowest_layer(stream_).shutdown(net::socket_base::shutdown_send, sec);
+                        beast::get_lowest_layer(stream).shutdown(net::socket_base::shutdown_send, sec);
+                    }
+                    if (cb) {
+                        cb(ec);
                     }
                     //std::cout << "Wrote " << bytes << " bytes, close=" << *close_ptr << std::endl;  // Debug log
                 });
@@ -0,0 +1,210 @@
+﻿#include "Profiler.h"
+#include "Logger.h"
+#include "StackTrace.h"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <execinfo.h>
+#include <fstream>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+namespace {
+    constexpr int kMaxDepth = 64;
+    constexpr int kSkipFrames = 2;     // Сам обработчик и трамплин sigreturn
+    constexpr size_t kMaxSamples = 1 << 16;
+
+    struct Sample {
+        pid_t tid;
+        int depth;
+        void* pcs[kMaxDepth];
+    };
+
+    // Общее с обработчиком сигнала. Буфер публикуется до включения таймера; после выключения
+    // поток профиля ждёт, пока in_handler не станет 0, и только потом читает выборки
+    std::atomic<Sample*> g_samples{ nullptr };
+    size_t g_capacity = 0;
+    std::atomic<size_t> g_next{ 0 };
+    std::atomic<int> g_in_handler{ 0 };
+
+    void onSigprof(int) {
+        const int saved_errno = errno;
+        g_in_handler.fetch_add(1);
+        if (Sample* samples = g_samples.load()) {
+            const size_t i = g_next.fetch_add(1, std::memory_order_relaxed);
+            if (i < g_capacity) {
+                Sample& s = samples[i];
+                s.tid = static_cast<pid_t>(::syscall(SYS_gettid));
+                s.depth = ::backtrace(s.pcs, kMaxDepth);
+            }
+        }
+        g_in_handler.fetch_sub(1);
+        errno = saved_errno;
+    }
+
+    bool installHandler() {
+        // backtrace() при первом вызове подгружает libgcc_s (malloc) — делаем это не в обработчике
+        void* warm[1];
+        ::backtrace(warm, 1);
+
+        struct sigaction action {};
+        action.sa_handler = onSigprof;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        // Обработчик не снимается: запоздавший SIGPROF с действием по умолчанию завершил бы процесс
+        return ::sigaction(SIGPROF, &action, nullptr) == 0;
+    }
+
+    bool setTimer(int hz) {
+        itimerval timer{};
+        if (hz > 0) {
+            timer.it_interval.tv_sec = 0;
+            timer.it_interval.tv_usec = 1000000 / hz;
+            timer.it_value = timer.it_interval;
+        }
+        return ::setitimer(ITIMER_PROF, &timer, nullptr) == 0;
+    }
+
+    // В collapsed-формате ';' разделяет кадры, а последний пробел отделяет число
+    void appendFrame(std::string& out, std::string_view frame) {
+        for (char ch : frame) {
+            out += (ch == ';' || ch == '\n') ? ':' : ch;
+        }
+    }
+
+    std::string threadName(pid_t tid) {
+        std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+        std::string name;
+        if (comm && std::getline(comm, name) && !name.empty()) return name;
+        return "thread-" + std::to_string(tid);   // Поток уже завершился
+    }
+
+    std::string collapse(const Sample* samples, size_t count) {
+        std::unordered_map<void*, std::string> symbols;
+        std::unordered_map<pid_t, std::string> threads;
+        std::map<std::string, size_t> stacks;   // Отсортированы — удобно сравнивать профили diff'ом
+
+        std::string stack;
+        for (size_t i = 0; i < count; ++i) {
+            const Sample& s = samples[i];
+            auto thread = threads.find(s.tid);
+            if (thread == threads.end()) thread = threads.emplace(s.tid, threadName(s.tid)).first;
+
+            stack.clear();
+            appendFrame(stack, thread->second);
+            // backtrace() — от листа к корню, collapsed — от корня к листу
+            for (int f = s.depth - 1; f >= kSkipFrames; --f) {
+                auto symbol = symbols.find(s.pcs[f]);
+                if (symbol == symbols.end()) {
+                    symbol = symbols.emplace(s.pcs[f], StackTrace::symbolize(s.pcs[f], f != kSkipFrames)).first;
+                }
+                stack += ';';
+                appendFrame(stack, symbol->second);
+            }
+            ++stacks[stack];
+        }
+
+        std::string out;
+        for (const auto& [frames, n] : stacks) {
+            out += frames;
+            out += ' ';
+            out += std::to_string(n);
+            out += '\n';
+        }
+        return out;
+    }
+}
+#endif
+
+Profiler::Profiler(boost::asio::io_context& ioc, const std::string& name, const int& id)
+    : BaseModule(name, id), ioc_(ioc) {
+}
+
+Profiler::~Profiler() {
+    shutdown();
+}
+
+bool Profiler::onInitialize() {
+#if defined(__linux__)
+    available_ = installHandler();
+    if (!available_) {
+        LOG_WARN("Profiler: cannot install SIGPROF handler, /admin/profile is disabled");
+    }
+#endif
+    return true;
+}
+
+void Profiler::onShutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (session_.joinable()) session_.join();
+}
+
+bool Profiler::start(std::chrono::seconds duration, int hz, Done done) {
+    if (!available_) return false;
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) return false;
+
+    // Предыдущий профиль уже отдал результат и завершается
+    if (session_.joinable()) session_.join();
+    duration = std::clamp(duration, std::chrono::seconds(1), std::chrono::seconds(kMaxSeconds));
+    hz = std::clamp(hz, 1, kMaxHz);
+    session_ = std::thread(&Profiler::run, this, duration, hz, std::move(done));
+    return true;
+}
+
+void Profiler::run(std::chrono::seconds duration, int hz, Done done) {
+    Result result;
+#if defined(__linux__)
+    // Запас на несколько одновременно занятых потоков (io_context, писатели журналов, БД)
+    const size_t capacity = std::min(kMaxSamples, static_cast<size_t>(hz) * static_cast<size_t>(duration.count()) * 4);
+    auto samples = std::make_unique<Sample[]>(capacity);
+    g_capacity = capacity;
+    g_next.store(0);
+    g_samples.store(samples.get());
+
+    if (!setTimer(hz)) {
+        result.error = "setitimer(ITIMER_PROF) failed";
+    }
+    else {
+        LOG_INFO("Profiler: sampling at " << hz << " Hz for " << duration.count() << " s");
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, duration, [this] { return stopping_; });
+    }
+    setTimer(0);
+    g_samples.store(nullptr);
+    while (g_in_handler.load() > 0) {
+        std::this_thread::yield();
+    }
+
+    const size_t taken = g_next.load();
+    result.samples = std::min(taken, capacity);
+    result.dropped = taken - result.samples;
+    if (result.error.empty()) {
+        result.collapsed = collapse(samples.get(), result.samples);
+    }
+#else
+    (void)duration;
+    (void)hz;
+    result.error = "profiling is only supported on Linux";
+#endif
+
+    running_.store(false, std::memory_order_release);
+    boost::asio::post(ioc_, [done = std::move(done), result = std::move(result)]() mutable {
+        done(std::move(result));
+    });
+}
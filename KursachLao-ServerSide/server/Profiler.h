@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+
+#include <boost/asio/io_context.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Выборочный CPU-профилировщик (/admin/profile?seconds=N&hz=H).
+// setitimer(ITIMER_PROF) шлёт SIGPROF по мере расхода процессорного времени процесса; обработчик
+// на прерванном потоке снимает стек backtrace() в заранее выделенный буфер — без блокировок и malloc.
+// По окончании отдельный поток символизирует адреса прямо в процессе (dladdr + деманглинг;
+// для имён функций самого сервера бинарник собирается с -rdynamic) и склеивает стеки
+// в collapsed-формат flamegraph.pl / speedscope: "поток;main;...;лист <число>".
+// Одновременно идёт только один профиль: таймер и обработчик сигнала общие для процесса.
+// Только Linux; на других платформах start() отказывает.
+class Profiler : public BaseModule {
+public:
+    struct Result {
+        std::string collapsed;      // Пусто, если error
+        size_t samples = 0;
+        size_t dropped = 0;         // Не поместились в буфер
+        std::string error;
+    };
+
+    using Done = std::function<void(Result&&)>;
+
+    static constexpr int kMaxSeconds = 60;
+    static constexpr int kMaxHz = 1000;
+
+    explicit Profiler(boost::asio::io_context& ioc, const std::string& name = "Profiler", const int& id = -1);
+    ~Profiler() override;
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // false — платформа не поддерживается или не удалось поставить обработчик SIGPROF
+    bool available() const { return available_; }
+    bool running() const { return running_.load(std::memory_order_acquire); }
+
+    // Профиль на duration с частотой hz; done вызывается на потоке io_context.
+    // false — профиль уже идёт или профилировщик недоступен, done не вызывается
+    bool start(std::chrono::seconds duration, int hz, Done done);
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    boost::asio::io_context& ioc_;
+    bool available_ = false;
+    std::atomic<bool> running_{ false };
+
+    std::thread session_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;     // Остановка модуля прерывает текущий профиль
+
+    void run(std::chrono::seconds duration, int hz, Done done);
+};
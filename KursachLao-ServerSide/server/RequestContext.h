@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "AddressTable.h"
+
+#include <boost/asio/ip/address.hpp>
+#include <chrono>
+
+// Данные о запросе, которых нет в самом HTTP-сообщении: кто прислал и когда.
+// Заполняет session (адрес — один раз на соединение), читает RequestHandler.
+struct RequestContext {
+    boost::asio::ip::address remote;
+    ClientKey client;
+    std::chrono::steady_clock::time_point accepted{};       // Соединение принято
+    std::chrono::steady_clock::time_point read_started{};   // Начато чтение этого запроса
+    std::chrono::steady_clock::time_point received{};       // Запрос прочитан целиком
+    unsigned long long sequence = 0;                        // Номер запроса в соединении, с 1
+};
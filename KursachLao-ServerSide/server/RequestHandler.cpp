@@ -1,15 +1,114 @@
 ﻿#include "RequestHandler.h"
 #include <iostream>
 
-RequestHandler::RequestHandler()
-    : BaseModule("HTTP Request Handler") {
+RequestHandler::RequestHandler(const std::string& name)
+    : BaseModule(name) {
+    rate_limited_metrics_ = routeMetrics("rate-limited");
+    shed_metrics_ = routeMetrics("shed");
+    static_metrics_ = routeMetrics("/*");
+    attention_metrics_ = routeMetrics("/attention");
+    not_found_metrics_ = routeMetrics("not-found");
+    unauthorized_metrics_ = routeMetrics("unauthorized");
+    db_time_ = &MetricsRegistry::instance().histogram("http_request_db_seconds",
+        "Time spent in database transactions per request (requests that used the database)");
+}
+
+RequestHandler::RouteMetrics* RequestHandler::routeMetrics(const std::string& route) {
+    auto [it, inserted] = route_metrics_.try_emplace(route);
+    if (inserted) {
+        static constexpr const char* kClasses[] = { "1xx", "2xx", "3xx", "4xx", "5xx" };
+        auto& registry = MetricsRegistry::instance();
+        const std::string label = MetricsRegistry::label("route", route);
+        RouteMetrics& m = it->second;
+        m.name = route;
+        m.latency = &registry.histogram("http_request_duration_seconds",
+            "Time from reading the request to sending the response", label);
+        for (size_t i = 0; i < m.responses.size(); ++i) {
+            m.responses[i] = &registry.counter("http_responses_total", "Responses by route and status class",
+                label + "," + MetricsRegistry::label("code", kClasses[i]));
+        }
+    }
+    return &it->second;
+}
+
+namespace {
+    // Синхронный обработчик -> асинхронный: ответ отправляется сразу после возврата
+    RequestHandler::AsyncHandler wrapSync(
+        std::function<void(const sRequest&, http::response<http::string_body>&)> handler) {
+        return [handler = std::move(handler)](const sRequest& req,
+            http::response<http::string_body>&& res, RequestHandler::Responder done) {
+            handler(req, res);
+            done(std::move(res));
+        };
+    }
+}
+
+void RequestHandler::sendTooManyRequests(http::response<http::string_body>& res, RouteClass route_class,
+    std::chrono::steady_clock::duration retry_after) {
+    // Retry-After — целые секунды, округляем вверх
+    auto seconds = std::chrono::ceil<std::chrono::seconds>(retry_after).count();
+    if (seconds < 1) seconds = 1;
+
+    res.result(http::status::too_many_requests);
+    res.set(http::field::retry_after, std::to_string(seconds));
+    res.set(http::field::cache_control, "no-store");
+    if (route_class == RouteClass::Static) {
+        res.set(http::field::content_type, "text/plain");
+        res.body() = "Too Many Requests";
+    }
+    else {
+        res.set(http::field::content_type, "application/json");
+        res.body() = R"({"error":"Too many requests","retryAfter":)" + std::to_string(seconds) + "}";
+    }
+}
+
+void RequestHandler::sendServiceOverloaded(http::response<http::string_body>& res, RouteClass route_class) {
+    res.result(http::status::service_unavailable);
+    res.set(http::field::retry_after, "1");
+    res.set(http::field::cache_control, "no-store");
+    if (route_class == RouteClass::Static) {
+        res.set(http::field::content_type, "text/plain");
+        res.body() = "Service Overloaded";
+    }
+    else {
+        res.set(http::field::content_type, "application/json");
+        res.body() = R"({"error":"Server overloaded, retry later","retryAfter":1})";
+    }
+}
+
+void RequestHandler::sendUnauthorized(http::response<http::string_body>& res) {
+    res.result(http::status::unauthorized);
+    res.set(http::field::www_authenticate, "Bearer");
+    res.set(http::field::cache_control, "no-store");
+    res.set(http::field::content_type, "application/json");
+    res.body() = R"({"error":"Missing or invalid token"})";
+}
+
+bool RequestHandler::authorize(std::string_view header, std::chrono::steady_clock::duration& retry_after) {
+    constexpr std::string_view kScheme = "Bearer ";
+    // Время сравнения не зависит от того, сколько символов токена совпало
+    unsigned char diff = header.size() == kScheme.size() + auth_token_.size() ? 0 : 1;
+    if (diff == 0) {
+        for (size_t i = 0; i < kScheme.size(); ++i) diff |= header[i] ^ kScheme[i];
+        for (size_t i = 0; i < auth_token_.size(); ++i) diff |= header[kScheme.size() + i] ^ auth_token_[i];
+    }
+    if (diff == 0) return true;
+
+    // Неудачные попытки — не больше 5 в секунду на весь слушатель
+    retry_after = {};
+    auth_failures_.take(RateLimit{ 5, 20 }, std::chrono::steady_clock::now(), retry_after);
+    return false;
 }
 
 void RequestHandler::addDynamicRouteHandler(const std::string& regexPattern,
-    std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)> handler) {
+    std::function<void(const sRequest&, http::response<http::string_body>&)> handler) {
+    addAsyncDynamicRouteHandler(regexPattern, wrapSync(std::move(handler)));
+}
+
+void RequestHandler::addAsyncDynamicRouteHandler(const std::string& regexPattern, AsyncHandler handler) {
     try {
         std::regex re(regexPattern);  // Компилируем regex заранее для эффективности
-        dynamicRouteHandlers_.emplace_back(re, handler);
+        dynamicRouteHandlers_.push_back({ std::move(re), std::move(handler), routeMetrics(regexPattern) });
     }
     catch (const std::regex_error& e) {
         std::cerr << "Invalid regex pattern: " << regexPattern << " - " << e.what() << std::endl;
@@ -32,21 +131,51 @@ void RequestHandler::onShutdown() {
 }
 
 void RequestHandler::addRouteHandler(const std::string& path,
-    std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)> handler) {
-    routeHandlers_[path] = handler;
+    std::function<void(const sRequest&, http::response<http::string_body>&)> handler) {
+    routeHandlers_[path] = { wrapSync(std::move(handler)), routeMetrics(path) };
+}
+
+void RequestHandler::addAsyncRouteHandler(const std::string& path, AsyncHandler handler) {
+    routeHandlers_[path] = { std::move(handler), routeMetrics(path) };
 }
 
 void RequestHandler::setupDefaultRoutes() { //Придумать какую-нибудь штуку для замены стандартного обработчика
     // Обработчик для корневого пути
-    /*addRouteHandler("/", [](const http::request<http::string_body>& req, http::response<http::string_body>& res) {
+    /*addRouteHandler("/", [](const sRequest& req, http::response<http::string_body>& res) {
         res.set(http::field::content_type, "text/plain");
         res.body() = "Hello from RequestHandler module!";
         });*/
     // Обработчик для /status
-    addRouteHandler("/status", [](const http::request<http::string_body>& req, http::response<http::string_body>& res) {
+    addRouteHandler("/status", [this](const sRequest& req, http::response<http::string_body>& res) {
         res.set(http::field::content_type, "application/json");
         res.result(http::status::ok);
         res.set(http::field::cache_control, "no-cache, must-revalidate");
-        res.body() = R"({"status": "ok", "service": "modular_http_server"})";
+        std::string body = R"({"status": "ok", "service": "modular_http_server")";
+        if (shedder_) {
+            // Решения LoadShedder: текущий уровень, минимумы последнего окна, счётчики отказов
+            using std::chrono::duration_cast;
+            using std::chrono::microseconds;
+            const auto& st = shedder_->stats();
+            body += R"(, "loadShedding": {"level": )" + std::to_string(st.level)
+                + R"(, "minLagUs": )" + std::to_string(duration_cast<microseconds>(st.last_min_lag).count())
+                + R"(, "minLatencyUs": )" + std::to_string(duration_cast<microseconds>(st.last_min_latency).count())
+                + R"(, "congestedIntervals": )" + std::to_string(st.congested_intervals)
+                + R"(, "shed": {"low": )" + std::to_string(st.shed[0])
+                + R"(, "normal": )" + std::to_string(st.shed[1])
+                + R"(, "high": )" + std::to_string(st.shed[2]) + "}}";
+        }
+        if (limiter_) {
+            body += R"(, "trackedClients": )" + std::to_string(limiter_->trackedClients());
+        }
+        body += "}";
+        res.body() = std::move(body);
+        });
+
+    // Метрики для Prometheus (text format 0.0.4)
+    addRouteHandler("/metrics", [](const sRequest& req, http::response<http::string_body>& res) {
+        res.set(http::field::content_type, "text/plain; version=0.0.4; charset=utf-8");
+        res.set(http::field::cache_control, "no-store");
+        res.result(http::status::ok);
+        res.body() = MetricsRegistry::instance().render();
         });
 }
\ No newline at end of file
@@ -1,19 +1,40 @@
 ﻿#pragma once
 #include "BaseModule.h"
 #include "FileCache.h"
+#include "DoSProtectionModule.h"
+#include "LoadShedder.h"
+#include "AccessLog.h"
+#include "Tracer.h"
+#include "SlowLog.h"
+#include "StallWatchdog.h"
+#include "DbTime.h"
+#include "Metrics.h"
+#include "RequestContext.h"
+#include "macros.h"
 
 #include <boost/beast/http.hpp>
 #include <sstream>
 #include <fstream>
 #include <regex>
 #include <vector>
+#include <array>
 #include <unordered_map>
+#include <functional>
+#include <string_view>
+#include <type_traits>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
 
 class RequestHandler : public BaseModule {
     FileCache* file_cache_ = nullptr;  // Указатель на кэш (инжектируется в main)
+    DoSProtectionModule* limiter_ = nullptr;  // Лимиты на запросы; nullptr — без ограничений
+    LoadShedder* shedder_ = nullptr;          // Сброс нагрузки (503); nullptr — выключен
+    AccessLog* access_log_ = nullptr;         // Журнал доступа; nullptr — выключен
+    Tracer* tracer_ = nullptr;                // Трейсинг; nullptr — выключен
+    SlowLog* slow_log_ = nullptr;             // Журнал медленных запросов; nullptr — выключен
+    std::string auth_token_;                  // Непустой — нужен заголовок "Authorization: Bearer <токен>"
+    TokenBucket auth_failures_;               // Неверные токены: перебор упирается в 429
 
 
     // Парсинг target на path и query (простой split по ?)
@@ -26,7 +47,13 @@ class RequestHandler : public BaseModule {
     }
 
 public:
-    RequestHandler();
+    // Отправка готового ответа. Асинхронный обработчик может вызвать её позже,
+    // уже после возврата из handleRequest (например, после группового коммита).
+    using Responder = std::function<void(http::response<http::string_body>&&)>;
+    using AsyncHandler = std::function<void(const sRequest&,
+        http::response<http::string_body>&&, Responder)>;
+
+    explicit RequestHandler(const std::string& name = "HTTP Request Handler");
     // Метод для инжекции кэша (только из main)
     void setFileCache(FileCache* cache) {
         file_cache_ = cache;
@@ -34,15 +61,50 @@ public:
 
     }
 
+    void setRateLimiter(DoSProtectionModule* limiter) {
+        limiter_ = limiter;
+    }
+
+    void setLoadShedder(LoadShedder* shedder) {
+        shedder_ = shedder;
+    }
+
+    void setAccessLog(AccessLog* access_log) {
+        access_log_ = access_log;
+    }
+
+    void setTracer(Tracer* tracer) {
+        tracer_ = tracer;
+    }
+
+    void setSlowLog(SlowLog* slow_log) {
+        slow_log_ = slow_log;
+    }
+
+    // Все маршруты обработчика — только с токеном (admin-слушатель)
+    void setAuthToken(std::string token) {
+        auth_token_ = std::move(token);
+    }
+
+    // Всё под /api/ — API (GET/HEAD — чтение, остальное — запись), прочее — статика
+    static RouteClass classifyRoute(std::string_view path, http::verb method) {
+        if (path.substr(0, 5) != "/api/") return RouteClass::Static;
+        return (method == http::verb::get || method == http::verb::head) ? RouteClass::ApiRead : RouteClass::ApiWrite;
+    }
+
     // Новый метод для динамических роутов (regex-паттерн)
     void addDynamicRouteHandler(const std::string& regexPattern,
-        std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)> handler);
+        std::function<void(const sRequest&, http::response<http::string_body>&)> handler);
 
     // Методы для регистрации обработчиков конкретных путей
-    void addRouteHandler(const std::string& path, std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)> handler);
+    void addRouteHandler(const std::string& path, std::function<void(const sRequest&, http::response<http::string_body>&)> handler);
+
+    // Асинхронные варианты: ответ уходит, когда обработчик вызовет Responder
+    void addAsyncRouteHandler(const std::string& path, AsyncHandler handler);
+    void addAsyncDynamicRouteHandler(const std::string& regexPattern, AsyncHandler handler);
 
     template<class Body, class Allocator, class Send>
-    void handleRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+    void handleRequest(http::request<Body, http::basic_fields<Allocator>>&& req, const RequestContext& ctx, Send&& send) {
         http::response<http::string_body> res{ http::status::not_found, req.version() };
         res.set(http::field::server, "ModularServer");
         res.keep_alive(req.keep_alive());
@@ -51,21 +113,106 @@ public:
             res.set(http::field::connection, "keep-alive");
         }
 
+        // Время в БД копится заново для каждого запроса (см. DbTime)
+        DbTime::reset();
+
+        // Трейс: решение о выборке одно на запрос; невыбранный дальше ничего не стоит
+        Tracer::RequestTrace trace = tracer_ ? beginTrace(req, ctx) : Tracer::RequestTrace{};
+        Tracer::Activation trace_scope(trace);
+
+        // Все ответы уходят через Responder: копия send (а не ссылка на неё) — он может быть вызван
+        // после выхода из handleRequest. route — метрики маршрута, его имя идёт в журнал (живёт дольше запроса).
+        // Время ответа обработчиков (measure_latency) — сигнал для LoadShedder
+        // Для выбранного трейса здесь же закрывается спан route (маршрут найден)
+        auto makeResponder = [&](RouteMetrics* route, bool measure_latency) -> Responder {
+            if (trace) {
+                tracer_->span(trace.context, "route", ctx.received, std::chrono::steady_clock::now());
+            }
+            // target — view в запрос: сессия держит его, пока ответ не записан
+            return [send = std::decay_t<Send>(send), shedder = measure_latency ? shedder_ : nullptr,
+                access_log = access_log_, db_histogram = db_time_, client = ctx.client, received = ctx.received,
+                slow_log = measure_latency ? slow_log_ : nullptr, target = std::string_view(req.target().data(), req.target().size()),
+                method = req.method(), route, trace](http::response<http::string_body>&& r) mutable {
+                const auto now = std::chrono::steady_clock::now();
+                const auto total = now - received;
+                const auto db_time = DbTime::current();
+                if (shedder) shedder->recordLatency(total);
+                r.prepare_payload();
+                route->record(r.result_int(), total);
+                if (db_time.count() > 0) db_histogram->record(db_time);
+                if (access_log) {
+                    access_log->record(client, method, route->name, r.result_int(), r.body().size(), db_time, total);
+                }
+                if (slow_log && slow_log->requestThreshold().count() > 0 && total >= slow_log->requestThreshold()) {
+                    const auto verb = http::to_string(method);
+                    slow_log->recordRequest(std::string_view(verb.data(), verb.size()), route->name, target,
+                        r.result_int(), total, db_time);
+                }
+                // Корневой спан заканчивается, когда ответ записан в сокет
+                if constexpr (requires { send.after_write_cb_; }) {
+                    if (trace) {
+                        r.set("traceparent", trace.context.traceparent());
+                        auto traced = send;
+                        traced.after_write_cb_ = [cb = std::move(traced.after_write_cb_), trace, method, route,
+                            status = r.result_int(), now](beast::error_code ec) {
+                            const auto verb = http::to_string(method);
+                            trace.tracer->finishRequest(trace, std::string_view(verb.data(), verb.size()), route->name, status, now);
+                            if (cb) cb(ec);
+                        };
+                        traced(std::move(r));
+                        return;
+                    }
+                }
+                send(std::move(r));
+            };
+        };
+
         std::string target = std::string(req.target());
         auto [path, query] = parseTarget(target);
+        const RouteClass route_class = classifyRoute(path, req.method());
+
+        if (!auth_token_.empty()) {
+            const auto header = req[http::field::authorization];
+            std::chrono::steady_clock::duration retry_after{};
+            if (!authorize(std::string_view(header.data(), header.size()), retry_after)) {
+                if (retry_after.count() > 0) sendTooManyRequests(res, RouteClass::ApiWrite, retry_after);
+                else sendUnauthorized(res);
+                makeResponder(unauthorized_metrics_, false)(std::move(res));
+                return;
+            }
+        }
+
+        // Лимит на запрос (не на соединение): keep-alive не обходит его, а превышение — 429, а не обрыв
+        if (limiter_) {
+            if (auto retry_after = limiter_->admitRequest(ctx.client, route_class)) {
+                sendTooManyRequests(res, route_class, *retry_after);
+                makeResponder(rate_limited_metrics_, false)(std::move(res));
+                return;
+            }
+        }
+
+        // При перегрузке сначала отсекаются наименее важные запросы
+        if (shedder_ && shedder_->shouldShed(shedder_->priorityOf(path, route_class))) {
+            sendServiceOverloaded(res, route_class);
+            makeResponder(shed_metrics_, false)(std::move(res));
+            return;
+        }
 
         // Проверяем wildcard /* для динамического поиска в кэше (только по path!)
         auto wildcard_it = routeHandlers_.find("/*"); //FIXME: Повышает время отклика
         if (wildcard_it != routeHandlers_.end() && file_cache_) {
-            file_cache_->refresh_file(path);
-            auto cached_file = file_cache_->get_file(path);  // Ищем по чистому path
+            auto cached_file = [&] {
+                Tracer::Span span("filecache", "http.target", path);
+                StallWatchdog::Activity activity("filecache");
+                file_cache_->refresh_file(path);
+                return file_cache_->get_file(path);  // Ищем по чистому path
+            }();
             if (cached_file) {
                 res.set(http::field::content_type, cached_file->mime_type.c_str());
                 res.set(http::field::cache_control, "public, max-age=300");
                 res.body() = std::move(cached_file->content);
                 res.result(http::status::ok);
-                res.prepare_payload();
-                send(std::move(res));
+                makeResponder(static_metrics_, false)(std::move(res));
                 return;
             }
         }
@@ -75,54 +222,49 @@ public:
         if (it != routeHandlers_.end()) {
             // Передаём query в handler (если lambda ожидает — расширь signature)
             // Для MVP: если handler статический, игнорируем query
-            it->second(req, res); 
-            res.prepare_payload();
-            send(std::move(res));
+            auto done = makeResponder(it->second.metrics, true);
+            Tracer::Span span("handler", "http.route", it->first);
+            StallWatchdog::Activity activity(it->second.metrics->name.c_str());
+            it->second.handler(req, std::move(res), std::move(done));
             return;
         }
-        else if (target.find("../") != std::string::npos) {
+        else if (file_cache_ && target.find("../") != std::string::npos) {
             res.set(http::field::content_type, "text/html");
             file_cache_->refresh_file("/attention");
             const auto& cached = file_cache_->get_file("/attention");
             res.set(http::field::cache_control, "public, max-age=300");
             res.body() = cached.value().content;
-            res.prepare_payload();
-            send(std::move(res));
+            makeResponder(attention_metrics_, false)(std::move(res));
             return;
 
         }
-        if (it == routeHandlers_.end() && !dynamicRouteHandlers_.empty()) { //FIXME: Съедает 404 страничку (Уже нет, но переработать стоит). Сделать нормальную валидацию
-            bool handled = false;
-            for (const auto& [re, handler] : dynamicRouteHandlers_) {
-                if (std::regex_match(path, re)) {  // Матчим весь path с regex
-                    handler(req, res);
-                    handled = true;
-                    break;  // Первый матч — обрабатываем (порядок в векторе важен: более конкретные выше)
-                }
-            }
-            if (handled) {
-                res.prepare_payload();
-                send(std::move(res));
+        //FIXME: Съедает 404 страничку (Уже нет, но переработать стоит). Сделать нормальную валидацию
+        for (const auto& route : dynamicRouteHandlers_) {
+            if (std::regex_match(path, route.re)) {  // Матчим весь path с regex
+                // Первый матч — обрабатываем (порядок в векторе важен: более конкретные выше)
+                auto done = makeResponder(route.metrics, true);
+                Tracer::Span span("handler", "http.route", route.metrics->name);
+                StallWatchdog::Activity activity(route.metrics->name.c_str());
+                route.handler(req, std::move(res), std::move(done));
                 return;
             }
-            else if (target.find("api/") != std::string::npos) {
-                res.set(http::field::content_type, "application/json");
-                res.result(http::status::not_found);
-                res.set(http::field::cache_control, "no-cache, must-revalidate");
-                res.body() = R"({"status": "not_found"})";
-                res.prepare_payload();
-                send(std::move(res));
-                return;
-            }
-            else {
-                res.set(http::field::content_type, "text/html");
-                file_cache_->refresh_file("/errorNotFound");
-                const auto& cached = file_cache_->get_file("/errorNotFound");
-                res.set(http::field::cache_control, "public, max-age=300");
-                res.body() = cached.value().content;
-                res.prepare_payload();
-                send(std::move(res));
-            }
+        }
+        // Без кэша (admin-слушатель) страницы 404 нет — всегда JSON
+        if (!file_cache_ || target.find("api/") != std::string::npos) {
+            res.set(http::field::content_type, "application/json");
+            res.result(http::status::not_found);
+            res.set(http::field::cache_control, "no-cache, must-revalidate");
+            res.body() = R"({"status": "not_found"})";
+            makeResponder(not_found_metrics_, false)(std::move(res));
+            return;
+        }
+        else {
+            res.set(http::field::content_type, "text/html");
+            file_cache_->refresh_file("/errorNotFound");
+            const auto& cached = file_cache_->get_file("/errorNotFound");
+            res.set(http::field::cache_control, "public, max-age=300");
+            res.body() = cached.value().content;
+            makeResponder(not_found_metrics_, false)(std::move(res));
         }
     }
 
@@ -131,14 +273,67 @@ protected:
     void onShutdown() override;
 
 private:
-    std::vector<std::pair<std::regex,
-        std::function
-        <void(const http::request<http::string_body>&, http::response<http::string_body>&)>
-    >> dynamicRouteHandlers_;
-
-    std::unordered_map<
-        std::string,
-        std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)>
-    > routeHandlers_;
+    static void sendTooManyRequests(http::response<http::string_body>& res, RouteClass route_class,
+        std::chrono::steady_clock::duration retry_after);
+    static void sendServiceOverloaded(http::response<http::string_body>& res, RouteClass route_class);
+    static void sendUnauthorized(http::response<http::string_body>& res);
+
+    // Сравнение токена за постоянное время; после серии неудач — retry_after > 0 (429)
+    bool authorize(std::string_view header, std::chrono::steady_clock::duration& retry_after);
+
+    // Выборка и спаны accept/read (только у первого запроса соединения — дальше это простой keep-alive)
+    template<class Request>
+    Tracer::RequestTrace beginTrace(const Request& req, const RequestContext& ctx) {
+        const bool first = ctx.sequence == 1;
+        const auto traceparent = req["traceparent"];
+        auto trace = tracer_->beginRequest(std::string_view(traceparent.data(), traceparent.size()),
+            first ? ctx.accepted : ctx.received);
+        if (trace && first) {
+            tracer_->span(trace.context, "accept", ctx.accepted, ctx.read_started);
+            tracer_->span(trace.context, "read", ctx.read_started, ctx.received);
+        }
+        return trace;
+    }
+
+    // Метрики одного маршрута: задержка и ответы по классам статуса (1xx..5xx).
+    // name — ключ или regex-шаблон маршрута, он же метка route и имя в журнале доступа
+    struct RouteMetrics {
+        std::string name;
+        LatencyHistogram* latency = nullptr;
+        std::array<Counter*, 5> responses{};
+
+        void record(unsigned status, std::chrono::steady_clock::duration total) {
+            const unsigned cls = status / 100;
+            responses[(cls >= 1 && cls <= 5 ? cls : 5) - 1]->inc();
+            latency->record(total);
+        }
+    };
+
+    struct Route {
+        AsyncHandler handler;
+        RouteMetrics* metrics = nullptr;
+    };
+
+    struct DynamicRoute {
+        std::regex re;
+        AsyncHandler handler;
+        RouteMetrics* metrics = nullptr;
+    };
+
+    // Синхронные обработчики хранятся обёрнутыми в AsyncHandler — путь диспетчеризации один
+    std::vector<DynamicRoute> dynamicRouteHandlers_;
+    std::unordered_map<std::string, Route> routeHandlers_;
+
+    // Узлы unordered_map не перемещаются — указатели в Route и Responder остаются валидными
+    std::unordered_map<std::string, RouteMetrics> route_metrics_;
+    RouteMetrics* rate_limited_metrics_ = nullptr;   // Ответы, не дошедшие до обработчика
+    RouteMetrics* shed_metrics_ = nullptr;
+    RouteMetrics* static_metrics_ = nullptr;         // Файлы из FileCache (/*)
+    RouteMetrics* attention_metrics_ = nullptr;
+    RouteMetrics* not_found_metrics_ = nullptr;
+    RouteMetrics* unauthorized_metrics_ = nullptr;
+    LatencyHistogram* db_time_ = nullptr;            // Время в БД на запрос (только запросы, ходившие в БД)
+
+    RouteMetrics* routeMetrics(const std::string& route);
     void setupDefaultRoutes();
 };
\ No newline at end of file
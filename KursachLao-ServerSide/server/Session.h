@@ -1,10 +1,18 @@
 ﻿#pragma once
 
 #include "RequestHandler.h"
+#include "RequestContext.h"
 #include "LambdaSenders.h"
+#include "RequestArena.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "macros.h"
 
 #include <boost/beast/core.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <cstdint>
+#include <optional>
+#include <tuple>
 
 namespace net = boost::asio;
 using tcp = boost::asio::ip::tcp;
@@ -15,26 +23,54 @@ namespace http = beast::http;
 // UPDATED: Session с shared_ptr для sender lifetime
 class session : public std::enable_shared_from_this<session> {
 public:
-    session(tcp::socket socket, RequestHandler* module)
-        : socket_(std::move(socket)), module_(module), close_(false) {
+    // lease — место в лимите соединений адреса, освобождается вместе с сессией
+    session(tcp::socket socket, RequestHandler* module, DoSProtectionModule::ConnectionLease lease = {})
+        : socket_(std::move(socket)), module_(module), lease_(std::move(lease)), close_(false) {
+        ctx_.accepted = std::chrono::steady_clock::now();
+        // Адрес клиента — один раз на соединение
+        beast::error_code ec;
+        auto remote = socket_.remote_endpoint(ec);
+        if (!ec) {
+            ctx_.remote = remote.address();
+            ctx_.client = ClientKey::from(ctx_.remote);
+        }
+        openSessions().add();
+    }
+
+    ~session() {
+        openSessions().sub();
     }
 
+    // Открытые соединения (клиентские и admin)
+    static std::int64_t openCount() { return openSessions().value(); }
+
     void run() {
         try {
             do_read();
         }
         catch (const std::exception& e) {
-            std::cerr << "Session run error: " << e.what() << std::endl;
+            LOG_ERROR("Session run error: " << e.what());
             beast::error_code ec;
             beast::get_lowest_layer(socket_).shutdown(net::socket_base::shutdown_both, ec);
         }
     }
 
 private:
+    static Gauge& openSessions() {
+        static Gauge& gauge = MetricsRegistry::instance().gauge("http_open_sessions", "Open client connections");
+        return gauge;
+    }
+
     void do_read() {
-        req_ = {};
+        // Сначала уничтожаем прошлый запрос, потом сбрасываем арену — и только потом новый запрос на ней
+        req_.reset();
+        arena_.reset();
+        req_.emplace(std::piecewise_construct,
+            std::make_tuple(ArenaAllocator<char>(&arena_)),
+            std::make_tuple(ArenaAllocator<char>(&arena_)));
         buffer_.consume(buffer_.size());
-        http::async_read(socket_, buffer_, req_,
+        ctx_.read_started = std::chrono::steady_clock::now();
+        http::async_read(socket_, buffer_, *req_,
             [self = shared_from_this()](beast::error_code ec, std::size_t bytes) {  // NEW: дебаг байты
                 if (!ec) {
                     //std::cout << "Read " << bytes << " bytes for next request" << std::endl;  // Debug: keep-alive reads
@@ -47,7 +83,7 @@ private:
                     self->socket_.shutdown(net::socket_base::shutdown_both, sec);
                 }
                 else {
-                    std::cerr << "Read error (" << bytes << " bytes): " << ec.message() << std::endl;
+                    LOG_WARN("Read error (" << bytes << " bytes): " << ec.message());
                     beast::error_code sec;
                     beast::get_lowest_layer(self->socket_).shutdown(net::socket_base::shutdown_both, sec);
                 }
@@ -55,34 +91,35 @@ private:
     }
 
     void on_read() {
-        // FIXED: make_shared без {} — используем default cb в ctor
-        auto sp_sender = std::make_shared<LambdaSenders::async_send_lambda<tcp::socket>>(socket_, close_);
-        auto sender_ref = std::ref(*sp_sender);  // Ref to deref sp_sender (valid)
-
-        // Лямбда для after_write — захват sp_sender (copy shared) + self (no dangling)
-        auto after_write = [self = shared_from_this(), sp_sender](beast::error_code ec) {
+        // Колбек держит только self: отправитель не ссылается сам на себя,
+        // и после последнего ответа сессия (с сокетом и арендой) уничтожается
+        auto after_write = [self = shared_from_this()](beast::error_code ec) {
             if (ec == http::error::end_of_stream) {  // NEW: Client closed — normal, no re-read
                 //std::cout << "Client closed connection gracefully" << std::endl;
                 return;
             }
-            if (!ec && !sp_sender->close_) {
+            if (!ec && !self->close_) {
                 self->do_read();  // Keep-alive
             }
             else if (ec) {
-                std::cerr << "Post-write error: " << ec.message() << std::endl;
+                LOG_WARN("Post-write error: " << ec.message());
             }
             };
 
-        // FIXED: Set cb ПОСЛЕ создания sp_sender, но ДО handleRequest
-        sp_sender->after_write_cb_ = after_write;
+        // Отправитель по значению: handleRequest копирует его в Responder для отложенных ответов
+        LambdaSenders::async_send_lambda<tcp::socket> sender(socket_, close_, std::move(after_write));
 
-        // Теперь handleRequest: sender живёт via sp, ref ok
-        module_->handleRequest(std::move(req_), sender_ref);
+        ctx_.received = std::chrono::steady_clock::now();
+        ++ctx_.sequence;
+        module_->handleRequest(std::move(*req_), ctx_, sender);
     }
 
     tcp::socket socket_;
     beast::flat_buffer buffer_;
-    http::request<http::string_body> req_;
+    RequestArena arena_;              // Объявлена раньше req_: разрушается после него
+    std::optional<sRequest> req_;
     RequestHandler* module_;
+    DoSProtectionModule::ConnectionLease lease_;
+    RequestContext ctx_;
     bool close_;  // Member ok
 };
\ No newline at end of file
@@ -0,0 +1,275 @@
+﻿#include "StallWatchdog.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "StackTrace.h"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+namespace bj = boost::json;
+
+#if defined(__linux__)
+namespace {
+    constexpr int kMaxDepth = 48;
+    constexpr int kSkipFrames = 2;     // Сам обработчик и трамплин sigreturn
+
+    // Один снимок за раз — запрашивает только поток сторожа. 0 — свободно, 1 — запрошен, 2 — готов
+    std::atomic<int> g_capture_state{ 0 };
+    std::atomic<bool> g_handler_installed{ false };   // Без обработчика сигнал завершил бы процесс
+    void* g_capture_pcs[kMaxDepth];
+    int g_capture_depth = 0;
+
+    // SIGPROF занят профилировщиком
+    int captureSignal() { return SIGRTMIN + 1; }
+
+    void onCapture(int) {
+        const int saved_errno = errno;
+        if (g_capture_state.load() == 1) {
+            g_capture_depth = ::backtrace(g_capture_pcs, kMaxDepth);
+            g_capture_state.store(2);
+        }
+        errno = saved_errno;
+    }
+
+    bool installHandler() {
+        void* warm[1];
+        ::backtrace(warm, 1);  // Подгрузка libgcc_s — не в обработчике сигнала
+
+        struct sigaction action {};
+        action.sa_handler = onCapture;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        g_handler_installed = ::sigaction(captureSignal(), &action, nullptr) == 0;
+        return g_handler_installed;
+    }
+}
+#endif
+
+namespace {
+    std::string isoTime(std::chrono::system_clock::time_point time) {
+        const auto t = std::chrono::system_clock::to_time_t(time);
+        std::tm tm{};
+#ifdef _WIN32
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "%04d-%02d-%02dT%02d:%02d:%02dZ",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        return buf;
+    }
+
+    double millis(StallWatchdog::Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+}
+
+struct StallWatchdog::Loop {
+    boost::asio::io_context& ioc;
+    std::string name;
+    LatencyHistogram& stall_seconds;
+    Counter& stalls;
+
+    // Под mutex_
+    bool armed = false;             // Первый пульс выполнился: известны поток и его Activity
+    bool pending = false;           // Пульс отправлен и ещё не выполнился
+    Clock::time_point posted{};
+    Clock::duration last_wait{};
+    std::uint64_t open_stall = 0;   // Запись о текущем зависании
+    std::atomic<const char*>* activity = nullptr;
+#if defined(__linux__)
+    pthread_t thread{};
+#endif
+};
+
+StallWatchdog::StallWatchdog(Options options, const std::string& name, const int& id)
+    : BaseModule(name, id)
+    , options_(options)
+    , interval_(std::max<Clock::duration>(options.threshold / 4, std::chrono::milliseconds(5))) {
+}
+
+StallWatchdog::~StallWatchdog() {
+    shutdown();
+}
+
+void StallWatchdog::watch(boost::asio::io_context& ioc, std::string name) {
+    auto& metrics = MetricsRegistry::instance();
+    const std::string labels = MetricsRegistry::label("loop", name);
+    loops_.push_back(std::unique_ptr<Loop>(new Loop{ ioc, std::move(name),
+        metrics.histogram("event_loop_stall_seconds", "How long the event loop did not run a heartbeat, stalls only", labels),
+        metrics.counter("event_loop_stalls_total", "Event loop stalls longer than the threshold", labels) }));
+}
+
+bool StallWatchdog::onInitialize() {
+    if (options_.threshold.count() == 0 || loops_.empty()) {
+        return true;  // Выключен
+    }
+#if defined(__linux__)
+    if (!installHandler()) {
+        LOG_WARN("StallWatchdog: cannot install signal handler, stalls are recorded without stacks");
+    }
+#endif
+    stopping_ = false;
+    worker_ = std::thread(&StallWatchdog::run, this);
+    LOG_INFO("StallWatchdog: reporting event loop stalls over " << millis(options_.threshold) << " ms");
+    return true;
+}
+
+void StallWatchdog::onShutdown() {
+    if (!worker_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void StallWatchdog::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        const auto now = Clock::now();
+        for (auto& loop : loops_) {
+            if (!loop->pending) {
+                loop->pending = true;
+                loop->posted = now;
+                boost::asio::post(loop->ioc, [this, l = loop.get()] { beat(*l); });
+            }
+            // До первого пульса цикл ещё не запущен; остановленный — не зависание
+            else if (loop->armed && loop->open_stall == 0 && now - loop->posted >= options_.threshold
+                && !loop->ioc.stopped()) {
+                const auto waited = now - loop->posted;
+                lock.unlock();
+                reportStall(*loop, waited);
+                lock.lock();
+            }
+        }
+        wake_.wait_for(lock, interval_, [this] { return stopping_; });
+    }
+}
+
+// На потоке цикла событий
+void StallWatchdog::beat(Loop& loop) {
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto waited = now - loop.posted;
+    if (!loop.armed) {
+        loop.armed = true;
+        loop.activity = &current();
+#if defined(__linux__)
+        loop.thread = ::pthread_self();
+#endif
+    }
+    loop.pending = false;
+    loop.last_wait = waited;
+    if (waited >= options_.threshold) {
+        loop.stall_seconds.record(waited);
+        loop.stalls.inc();
+    }
+    if (loop.open_stall != 0) {
+        auto it = std::find_if(stalls_.begin(), stalls_.end(), [&](const Stall& s) { return s.id == loop.open_stall; });
+        if (it != stalls_.end()) {
+            it->finished = true;
+            it->duration = waited;
+        }
+        loop.open_stall = 0;
+        LOG_WARN("StallWatchdog: loop '" << loop.name << "' was stalled for " << millis(waited) << " ms");
+    }
+}
+
+// На потоке сторожа, без mutex_: снимок стека ждёт обработчик сигнала на потоке цикла
+void StallWatchdog::reportStall(Loop& loop, Clock::duration waited) {
+    Stall stall;
+    stall.time = std::chrono::system_clock::now();
+    stall.loop = loop.name;
+    // activity и thread выставлены первым пульсом (armed) и больше не меняются
+    const char* activity = loop.activity ? loop.activity->load(std::memory_order_relaxed) : nullptr;
+    stall.activity = activity ? activity : "(idle or I/O)";
+    stall.stack = captureStack(loop);
+    stall.duration = waited;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (loop.pending) {
+        loop.open_stall = stall.id = next_id_++;
+    }
+    else {
+        // Цикл ожил, пока снимался стек
+        stall.id = next_id_++;
+        stall.finished = true;
+        stall.duration = loop.last_wait;
+    }
+    if (stalls_.size() >= options_.capacity) stalls_.pop_front();
+    stalls_.push_back(std::move(stall));
+}
+
+std::vector<std::string> StallWatchdog::captureStack(Loop& loop) {
+    std::vector<std::string> frames;
+#if defined(__linux__)
+    if (!g_handler_installed) return frames;
+    g_capture_state.store(1);
+    if (::pthread_kill(loop.thread, captureSignal()) != 0) {
+        g_capture_state.store(0);
+        return frames;
+    }
+    const auto deadline = Clock::now() + std::chrono::milliseconds(100);
+    while (g_capture_state.load() != 2 && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (g_capture_state.load() != 2) {
+        g_capture_state.store(0);
+        return frames;   // Поток не принял сигнал вовремя
+    }
+    // От листа к корню, как в обычном стеке
+    for (int f = kSkipFrames; f < g_capture_depth; ++f) {
+        frames.push_back(StackTrace::symbolize(g_capture_pcs[f], f != kSkipFrames));
+    }
+    g_capture_state.store(0);
+#else
+    (void)loop;
+#endif
+    return frames;
+}
+
+bj::object StallWatchdog::report() const {
+    bj::object out;
+    out["thresholdMs"] = millis(options_.threshold);
+
+    bj::array list;
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    list.reserve(stalls_.size());
+    for (auto it = stalls_.rbegin(); it != stalls_.rend(); ++it) {
+        const Stall& s = *it;
+        bj::object item;
+        item["id"] = s.id;
+        item["time"] = isoTime(s.time);
+        item["loop"] = s.loop;
+        item["activity"] = s.activity;
+        item["ongoing"] = !s.finished;
+        if (s.finished) {
+            item["durationMs"] = millis(s.duration);
+        }
+        else {
+            // Ещё стоит: сколько прошло с отправки пульса
+            auto loop = std::find_if(loops_.begin(), loops_.end(), [&](const auto& l) { return l->open_stall == s.id; });
+            item["durationMs"] = millis(loop != loops_.end() ? now - (*loop)->posted : s.duration);
+        }
+        bj::array stack;
+        for (const auto& frame : s.stack) stack.emplace_back(frame);
+        item["stack"] = std::move(stack);
+        list.push_back(std::move(item));
+    }
+    out["stalls"] = std::move(list);
+    return out;
+}
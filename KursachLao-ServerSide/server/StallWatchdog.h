@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/json.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Сторож цикла событий (/admin/stalls).
+// Обработчики выполняются синхронно на потоке io_context, и один долгий handleGetAllData
+// или чтение большого файла замораживает все соединения. Сторож раз в interval (threshold / 4)
+// кладёт в каждый наблюдаемый io_context пульс; если пульс не выполнился за threshold, цикл завис:
+// записываем, что он сейчас делает (Activity — маршрут обработчика), и стек его потока
+// (сигнал потоку, backtrace в обработчике сигнала). Когда пульс наконец выполнится,
+// длительность зависания попадает в запись и в гистограмму event_loop_stall_seconds.
+class StallWatchdog : public BaseModule {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        Clock::duration threshold = std::chrono::milliseconds(200);   // 0 — выключен
+        size_t capacity = 32;                                         // Записей в /admin/stalls
+    };
+
+    // Чем занят поток цикла событий: строка должна жить дольше области (литерал, имя маршрута).
+    // Стоит два relaxed-сохранения — можно оборачивать каждый обработчик
+    class Activity {
+    public:
+        explicit Activity(const char* what) : saved_(current().exchange(what, std::memory_order_relaxed)) {}
+        ~Activity() { current().store(saved_, std::memory_order_relaxed); }
+
+        Activity(const Activity&) = delete;
+        Activity& operator=(const Activity&) = delete;
+
+    private:
+        const char* saved_;
+    };
+
+    explicit StallWatchdog(Options options, const std::string& name = "StallWatchdog", const int& id = -1);
+    ~StallWatchdog() override;
+
+    StallWatchdog(const StallWatchdog&) = delete;
+    StallWatchdog& operator=(const StallWatchdog&) = delete;
+
+    // До initialize: какие циклы наблюдать
+    void watch(boost::asio::io_context& ioc, std::string name);
+
+    // Последние зависания, новые первыми
+    boost::json::object report() const;
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    struct Stall {
+        std::uint64_t id = 0;
+        std::chrono::system_clock::time_point time{};
+        std::string loop;
+        std::string activity;
+        Clock::duration duration{};
+        bool finished = false;      // false — цикл ещё стоит (duration — сколько уже)
+        std::vector<std::string> stack;
+    };
+
+    struct Loop;
+
+    static std::atomic<const char*>& current() {
+        thread_local std::atomic<const char*> activity{ nullptr };
+        return activity;
+    }
+
+    const Options options_;
+    Clock::duration interval_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+
+    mutable std::mutex mutex_;      // Состояние циклов и кольцо записей
+    std::deque<Stall> stalls_;
+    std::uint64_t next_id_ = 1;
+
+    std::thread worker_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    void run();
+    void beat(Loop& loop);
+    void reportStall(Loop& loop, Clock::duration waited);
+    std::vector<std::string> captureStack(Loop& loop);
+};
@@ -0,0 +1,258 @@
+﻿#include "Tracer.h"
+#include "JsonEscape.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace {
+    // Идентификаторы и выборка — свой генератор на поток, без блокировок
+    std::mt19937_64& rng() {
+        thread_local std::mt19937_64 gen{ std::random_device{}() };
+        return gen;
+    }
+
+    std::uint64_t randomId() {
+        std::uint64_t id = 0;
+        while (id == 0) id = rng()();
+        return id;
+    }
+
+    bool parseHex(std::string_view hex, std::uint64_t& out) {
+        out = 0;
+        for (char ch : hex) {
+            int v;
+            if (ch >= '0' && ch <= '9') v = ch - '0';
+            else if (ch >= 'a' && ch <= 'f') v = ch - 'a' + 10;
+            else return false;   // По спецификации — только строчные
+            out = (out << 4) | static_cast<std::uint64_t>(v);
+        }
+        return true;
+    }
+
+    void appendHex(std::string& out, std::uint64_t v) {
+        char buf[17];
+        std::snprintf(buf, sizeof buf, "%016llx", static_cast<unsigned long long>(v));
+        out.append(buf, 16);
+    }
+
+    // Обрезка до max байт, не разрывая UTF-8 символ
+    std::string_view utf8Prefix(std::string_view sv, size_t max) {
+        if (sv.size() <= max) return sv;
+        size_t n = max;
+        while (n > 0 && (static_cast<unsigned char>(sv[n]) & 0xC0) == 0x80) --n;
+        return sv.substr(0, n);
+    }
+}
+
+bool SpanContext::parse(std::string_view tp, SpanContext& out) {
+    // 00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01
+    if (tp.size() < 55 || tp[2] != '-' || tp[35] != '-' || tp[52] != '-') return false;
+    if (tp.substr(0, 2) == "ff") return false;
+    if (tp.substr(0, 2) == "00" && tp.size() != 55) return false;
+
+    SpanContext ctx;
+    std::uint64_t flags = 0;
+    if (!parseHex(tp.substr(3, 16), ctx.trace_hi) || !parseHex(tp.substr(19, 16), ctx.trace_lo)
+        || !parseHex(tp.substr(36, 16), ctx.span_id) || !parseHex(tp.substr(53, 2), flags)) {
+        return false;
+    }
+    if (!ctx.valid()) return false;
+    ctx.sampled = (flags & 1) != 0;
+    out = ctx;
+    return true;
+}
+
+std::string SpanContext::traceparent() const {
+    std::string out = "00-";
+    out.reserve(55);
+    appendHex(out, trace_hi);
+    appendHex(out, trace_lo);
+    out += '-';
+    appendHex(out, span_id);
+    out += sampled ? "-01" : "-00";
+    return out;
+}
+
+Tracer::Tracer(Options options, const std::string& name, const int& id)
+    : BaseModule(name, id)
+    , sample_ratio_(std::clamp(options.sample_ratio, 0.0, 1.0))
+    , service_name_(std::move(options.service_name))
+    , writer_(std::move(options.file), std::chrono::milliseconds(500)) {
+}
+
+Tracer::~Tracer() {
+    shutdown();
+}
+
+bool Tracer::onInitialize() {
+    if (writer_.options().path.empty()) {
+        return true;  // Выключен — beginRequest ничего не выбирает
+    }
+    steady_to_unix_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch() - Clock::now().time_since_epoch());
+
+    // Одна строка OTLP/JSON на пачку: {"resourceSpans":[{"resource":...,"scopeSpans":[{"scope":...,"spans":[...]}]}]}
+    BatchFileWriter<SpanRecord, 4096>::Format format;
+    format.append = [this](std::string& out, const SpanRecord& r) { appendSpan(out, r); };
+    format.prefix = R"({"resourceSpans":[{"resource":{"attributes":[{"key":"service.name","value":{"stringValue":")";
+    appendJsonEscaped(format.prefix, service_name_);
+    format.prefix += R"("}}]},"scopeSpans":[{"scope":{"name":"KursachLao-ServerSide"},"spans":[)";
+    format.separator = ",";
+    format.suffix = "]}]}]}\n";
+    format.max_batch = 1024;
+    if (!writer_.start(std::move(format))) {
+        LOG_ERROR("Tracer: cannot open " << writer_.options().path.string());
+        return false;
+    }
+    DbObserver::add(this);
+    MetricsRegistry::instance().addCallback(MetricsRegistry::Type::Counter, "trace_spans_dropped_total",
+        "Spans lost because the export queue was full", {}, [this] { return static_cast<double>(dropped()); });
+    LOG_INFO("Tracer: sampling " << sample_ratio_ * 100 << "% of requests to " << writer_.options().path.string());
+    return true;
+}
+
+void Tracer::onShutdown() {
+    DbObserver::remove(this);
+    writer_.stop();
+}
+
+Tracer::RequestTrace Tracer::beginRequest(std::string_view traceparent, Clock::time_point start) {
+    if (!active()) return {};
+
+    RequestTrace trace;
+    SpanContext remote;
+    if (!traceparent.empty() && SpanContext::parse(traceparent, remote)) {
+        // Решение вызывающей стороны важнее своей доли выборки
+        if (!remote.sampled) return {};
+        trace.context = remote;
+        trace.remote_parent = remote.span_id;
+    }
+    else {
+        if (sample_ratio_ <= 0.0) return {};
+        if (sample_ratio_ < 1.0 && std::generate_canonical<double, 53>(rng()) >= sample_ratio_) return {};
+        trace.context.trace_hi = randomId();
+        trace.context.trace_lo = randomId();
+        trace.context.sampled = true;
+    }
+    trace.context.span_id = randomId();
+    trace.tracer = this;
+    trace.start = start;
+    return trace;
+}
+
+void Tracer::fill(SpanRecord& r, const SpanContext& trace, std::uint64_t parent, std::string_view name,
+    const char* attr_key, std::string_view attr) {
+    r.trace_hi = trace.trace_hi;
+    r.trace_lo = trace.trace_lo;
+    r.span_id = randomId();
+    r.parent_id = parent;
+    name = utf8Prefix(name, sizeof r.name);
+    r.name_size = static_cast<std::uint8_t>(name.size());
+    std::memcpy(r.name, name.data(), r.name_size);
+    r.attr_key = attr_key;
+    attr = attr_key ? utf8Prefix(attr, sizeof r.attr) : std::string_view{};
+    r.attr_size = static_cast<std::uint16_t>(attr.size());
+    if (r.attr_size > 0) std::memcpy(r.attr, attr.data(), r.attr_size);
+}
+
+void Tracer::submit(const SpanRecord& r) {
+    writer_.push([&](SpanRecord& slot) { slot = r; });
+}
+
+std::uint64_t Tracer::onBegin(const Operation&) {
+    Active& active = current();
+    if (active.tracer != this) return 0;
+    const std::uint64_t parent = active.context.span_id;
+    active.context.span_id = randomId();
+    return parent;
+}
+
+void Tracer::onEnd(const Operation& op, std::uint64_t parent, DbObserver::Clock::duration elapsed) {
+    if (parent == 0) return;  // Запрос не выбран
+    Active& active = current();
+    SpanRecord r;
+    fill(r, active.context, parent, op.name, op.sql.empty() ? nullptr : "db.statement", op.sql);
+    r.span_id = active.context.span_id;
+    r.end = Clock::now();
+    r.start = r.end - elapsed;
+    submit(r);
+    active.context.span_id = parent;
+}
+
+void Tracer::span(const SpanContext& parent, const char* name, Clock::time_point start, Clock::time_point end,
+    const char* attr_key, std::string_view attr) {
+    SpanRecord r;
+    fill(r, parent, parent.span_id, name, attr_key, attr);
+    r.start = start;
+    r.end = end;
+    submit(r);
+}
+
+void Tracer::finishRequest(const RequestTrace& trace, std::string_view method, std::string_view route,
+    unsigned status, Clock::time_point write_start) {
+    const auto now = Clock::now();
+    span(trace.context, "write", write_start, now);
+
+    SpanRecord root;
+    std::string name;
+    name.reserve(method.size() + 1 + route.size());
+    name.append(method).append(" ").append(route);
+    fill(root, trace.context, trace.remote_parent, name, "http.route", route);
+    root.span_id = trace.context.span_id;
+    root.kind = Kind::Server;
+    root.http_status = status;
+    root.start = trace.start;
+    root.end = now;
+    submit(root);
+}
+
+void Tracer::appendSpan(std::string& out, const SpanRecord& r) const {
+    auto unixNanos = [this](Clock::time_point t) {
+        return std::to_string((std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()) + steady_to_unix_).count());
+    };
+
+    out += R"({"traceId":")";
+    appendHex(out, r.trace_hi);
+    appendHex(out, r.trace_lo);
+    out += R"(","spanId":")";
+    appendHex(out, r.span_id);
+    out += '"';
+    if (r.parent_id != 0) {
+        out += R"(,"parentSpanId":")";
+        appendHex(out, r.parent_id);
+        out += '"';
+    }
+    out += R"(,"name":")";
+    appendJsonEscaped(out, std::string_view(r.name, r.name_size));
+    out += R"(","kind":)";
+    out += std::to_string(static_cast<int>(r.kind));
+    out += R"(,"startTimeUnixNano":")";
+    out += unixNanos(r.start);
+    out += R"(","endTimeUnixNano":")";
+    out += unixNanos(r.end);
+    out += R"(","attributes":[)";
+    bool first = true;
+    if (r.attr_key) {
+        out += R"({"key":")";
+        out += r.attr_key;
+        out += R"(","value":{"stringValue":")";
+        appendJsonEscaped(out, std::string_view(r.attr, r.attr_size));
+        out += R"("}})";
+        first = false;
+    }
+    if (r.http_status != 0) {
+        if (!first) out += ',';
+        out += R"({"key":"http.status_code","value":{"intValue":")";
+        out += std::to_string(r.http_status);
+        out += R"("}})";
+    }
+    out += ']';
+    if (r.http_status >= 500) {
+        out += R"(,"status":{"code":2})";   // STATUS_CODE_ERROR
+    }
+    out += '}';
+}
@@ -0,0 +1,176 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+#include "DbObserver.h"
+#include "BatchFileWriter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Трейсинг запросов: спаны пути запроса выгружаются в файл в формате OTLP/JSON
+// (одна строка — один ExportTraceServiceRequest, как у file-экспортера OpenTelemetry Collector).
+//
+//   GET /api/all-data                 серверный спан: от accept (первый запрос соединения) или чтения до записи ответа
+//   ├─ accept, read                   только для первого запроса соединения
+//   ├─ route                          лимиты, сброс нагрузки, поиск маршрута
+//   ├─ handler / filecache
+//   │  ├─ db.query ×N                 каждый SQL-оператор (DatabaseMapper::execute)
+//   │  └─ serialize
+//   └─ write                          async_write ответа
+//
+// Выборка решается один раз в начале запроса: входящий traceparent с флагом sampled продолжает
+// чужой трейс, иначе запрос берётся с вероятностью sample_ratio. Для невыбранного запроса
+// Span — одна проверка thread_local указателя. Операции с БД (db.query, db.stream, db.decode)
+// приходят через DbObserver: слой БД о трейсинге не знает. Выбранные спаны уходят в очередь BatchFileWriter,
+// файл пишет фоновый поток пачками (как AccessLog).
+
+struct SpanContext {
+    std::uint64_t trace_hi = 0;
+    std::uint64_t trace_lo = 0;
+    std::uint64_t span_id = 0;
+    bool sampled = false;
+
+    bool valid() const { return (trace_hi | trace_lo) != 0 && span_id != 0; }
+
+    // W3C Trace Context: "00-<trace-id 32 hex>-<parent-id 16 hex>-<flags 2 hex>"
+    static bool parse(std::string_view traceparent, SpanContext& out);
+    std::string traceparent() const;
+};
+
+class Tracer : public BaseModule, private DbObserver {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Kind : std::uint8_t { Internal = 1, Server = 2 };   // Значения SpanKind из OTLP
+
+    struct Options {
+        RotatingFile::Options file{ {}, 64ull * 1024 * 1024, std::chrono::hours(24), 3 };  // Пустой path — выключен
+        double sample_ratio = 0.01;
+        std::string service_name = "KursachLao-ServerSide";
+    };
+
+    struct SpanRecord {
+        std::uint64_t trace_hi = 0;
+        std::uint64_t trace_lo = 0;
+        std::uint64_t span_id = 0;
+        std::uint64_t parent_id = 0;
+        Clock::time_point start{};
+        Clock::time_point end{};
+        Kind kind = Kind::Internal;
+        unsigned http_status = 0;           // Только у серверного спана
+        const char* attr_key = nullptr;     // Строковый литерал: "db.statement", "http.route" ...
+        std::uint8_t name_size = 0;
+        std::uint16_t attr_size = 0;
+        char name[64];
+        char attr[256];
+    };
+
+    // Трейс, к которому привязываются Span на этом потоке. tracer == nullptr — запрос не выбран
+    struct Active {
+        Tracer* tracer = nullptr;
+        SpanContext context;    // span_id — текущий родитель
+    };
+
+    static Active& current() {
+        thread_local Active active;
+        return active;
+    }
+
+    // Трейс одного запроса; context.span_id — корневой (серверный) спан
+    struct RequestTrace {
+        Tracer* tracer = nullptr;
+        SpanContext context;
+        std::uint64_t remote_parent = 0;    // span-id из входящего traceparent
+        Clock::time_point start{};
+
+        explicit operator bool() const { return tracer != nullptr; }
+        Active active() const { return { tracer, context }; }
+    };
+
+    // Делает трейс текущим для потока на время области (обработчик, операция пакета)
+    class Activation {
+    public:
+        explicit Activation(const Active& active) : saved_(current()) { current() = active; }
+        explicit Activation(const RequestTrace& trace) : Activation(trace.active()) {}
+        ~Activation() { current() = saved_; }
+
+        Activation(const Activation&) = delete;
+        Activation& operator=(const Activation&) = delete;
+
+    private:
+        Active saved_;
+    };
+
+    // Вложенный спан текущего трейса. attr копируется сразу — строка может не дожить до конца области
+    class Span {
+    public:
+        explicit Span(const char* name, const char* attr_key = nullptr, std::string_view attr = {}) {
+            Active& active = current();
+            if (!active.tracer) return;
+            tracer_ = active.tracer;
+            parent_ = active.context.span_id;
+            tracer_->fill(record_, active.context, parent_, name, attr_key, attr);
+            record_.start = Clock::now();
+            active.context.span_id = record_.span_id;
+        }
+
+        ~Span() {
+            if (!tracer_) return;
+            record_.end = Clock::now();
+            tracer_->submit(record_);
+            current().context.span_id = parent_;
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        Tracer* tracer_ = nullptr;
+        std::uint64_t parent_ = 0;
+        SpanRecord record_;
+    };
+
+    explicit Tracer(Options options, const std::string& name = "Tracer", const int& id = -1);
+    ~Tracer() override;
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    bool active() const { return writer_.active(); }
+
+    // Решение о выборке. Невыбранный — пустой RequestTrace
+    RequestTrace beginRequest(std::string_view traceparent, Clock::time_point start);
+
+    // Спан с известными границами (accept, read, route), дочерний к parent
+    void span(const SpanContext& parent, const char* name, Clock::time_point start, Clock::time_point end,
+        const char* attr_key = nullptr, std::string_view attr = {});
+
+    // После записи ответа: спан write и корневой "<METHOD> <route>"
+    void finishRequest(const RequestTrace& trace, std::string_view method, std::string_view route,
+        unsigned status, Clock::time_point write_start);
+
+    unsigned long long dropped() const { return writer_.dropped(); }
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    const double sample_ratio_;
+    const std::string service_name_;
+    std::chrono::nanoseconds steady_to_unix_{};   // Смещение steady_clock -> unix time, один раз при старте
+    BatchFileWriter<SpanRecord, 4096> writer_;
+
+    void fill(SpanRecord& r, const SpanContext& trace, std::uint64_t parent, std::string_view name,
+        const char* attr_key, std::string_view attr);
+    void submit(const SpanRecord& r);
+
+    // Спан операции с БД, если текущий трейс наш: onBegin делает его текущим родителем
+    // и возвращает прежнего, onEnd отправляет спан и восстанавливает родителя
+    std::uint64_t onBegin(const Operation& op) override;
+    void onEnd(const Operation& op, std::uint64_t parent, DbObserver::Clock::duration elapsed) override;
+
+    void appendSpan(std::string& out, const SpanRecord& r) const;
+};
@@ -0,0 +1,63 @@
+﻿#include "LoadShedder.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace {
+    // Гоняет io_context duration, раз в 5 мс запоминая наибольший уровень сброса
+    int maxLevelWhileRunning(boost::asio::io_context& ioc, const LoadShedder& shedder,
+        std::chrono::milliseconds duration) {
+        int max_level = 0;
+        boost::asio::steady_timer sampler(ioc);
+        std::function<void()> sample = [&] {
+            max_level = std::max(max_level, shedder.stats().level);
+            sampler.expires_after(5ms);
+            sampler.async_wait([&](const boost::system::error_code& ec) { if (!ec) sample(); });
+        };
+        sample();
+        ioc.run_for(duration);
+        return max_level;
+    }
+}
+
+// Одна блокировка цикла на 150 мс в начале окна — единственная проба окна опаздывает,
+// но это разовый всплеск: уровень не поднимается
+TEST(LoadShedderTest, SingleStallDoesNotRaiseLevel) {
+    boost::asio::io_context ioc;
+    LoadShedder shedder(ioc);
+    shedder.setTargets(20ms, LoadShedder::Duration::zero());
+    ASSERT_TRUE(shedder.initialize());
+
+    boost::asio::post(ioc, [] { std::this_thread::sleep_for(150ms); });
+    const int max_level = maxLevelWhileRunning(ioc, shedder, 600ms);
+    shedder.shutdown();
+
+    EXPECT_EQ(max_level, 0);
+    EXPECT_EQ(shedder.stats().congested_intervals, 0u);
+}
+
+// Цикл занят постоянно — задержка высокая во всех пробах окна, сброс включается
+TEST(LoadShedderTest, SustainedLagRaisesLevel) {
+    boost::asio::io_context ioc;
+    LoadShedder shedder(ioc);
+    shedder.setTargets(20ms, LoadShedder::Duration::zero());
+    ASSERT_TRUE(shedder.initialize());
+
+    std::function<void()> busy = [&] {
+        std::this_thread::sleep_for(60ms);
+        boost::asio::post(ioc, busy);
+    };
+    boost::asio::post(ioc, busy);
+    const int max_level = maxLevelWhileRunning(ioc, shedder, 1500ms);
+    shedder.shutdown();
+
+    EXPECT_GE(max_level, 1);
+}
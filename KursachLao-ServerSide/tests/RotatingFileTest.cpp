@@ -0,0 +1,102 @@
+﻿#include "RotatingFile.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Свой каталог на тест, удаляется в конце
+    class RotatingFileTest : public ::testing::Test {
+    protected:
+        fs::path dir_;
+
+        void SetUp() override {
+            const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+            dir_ = fs::temp_directory_path() / (std::string("rotating-file-") + info->name());
+            fs::remove_all(dir_);
+            fs::create_directories(dir_);
+        }
+
+        void TearDown() override { fs::remove_all(dir_); }
+
+        std::vector<std::string> rotatedFiles() const {
+            std::vector<std::string> names;
+            for (const auto& entry : fs::directory_iterator(dir_)) {
+                const auto name = entry.path().filename().string();
+                if (name != "access.log" && name != "access.log.created"
+                    && name.rfind("access.log.", 0) == 0) {
+                    names.push_back(name);
+                }
+            }
+            return names;
+        }
+    };
+
+    void writeFile(const fs::path& path, const std::string& text) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+    }
+}
+
+// Файл создан раньше max_age, но дописывался только что (mtime свежий) — после перезапуска
+// возраст считается от создания, и первая же запись его ротирует
+TEST_F(RotatingFileTest, RotatesByAgeAfterReopenDespiteRecentWrites) {
+    const auto path = dir_ / "access.log";
+    writeFile(path, "old line\n");
+    const auto created = std::chrono::system_clock::now() - std::chrono::hours(48);
+    writeFile(dir_ / "access.log.created",
+        std::to_string(std::chrono::duration_cast<std::chrono::seconds>(created.time_since_epoch()).count()) + "\n");
+    fs::last_write_time(path, fs::file_time_type::clock::now());
+
+    RotatingFile file({ path, 1024 * 1024, std::chrono::hours(24), 5 });
+    ASSERT_TRUE(file.open());
+    file.write("new line\n");
+    file.close();
+
+    EXPECT_EQ(rotatedFiles().size(), 1u);
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    EXPECT_EQ(line, "new line");
+}
+
+// Свежий файл по возрасту не ротируется, и метка создания переживает перезапуск
+TEST_F(RotatingFileTest, KeepsYoungFileAcrossReopen) {
+    const auto path = dir_ / "access.log";
+    {
+        RotatingFile file({ path, 1024 * 1024, std::chrono::hours(24), 5 });
+        ASSERT_TRUE(file.open());
+        file.write("first\n");
+        file.close();
+    }
+    RotatingFile file({ path, 1024 * 1024, std::chrono::hours(24), 5 });
+    ASSERT_TRUE(file.open());
+    file.write("second\n");
+    file.close();
+
+    EXPECT_TRUE(rotatedFiles().empty());
+    EXPECT_TRUE(fs::exists(dir_ / "access.log.created"));
+}
+
+// Несколько ротаций в одну секунду не затирают друг друга; чужие файлы с тем же
+// префиксом ретенция не трогает
+TEST_F(RotatingFileTest, RetentionKeepsForeignFiles) {
+    const auto path = dir_ / "access.log";
+    writeFile(dir_ / "access.log.gz", "foreign");
+    writeFile(dir_ / "access.log.bak", "foreign");
+
+    RotatingFile file({ path, 4, std::chrono::hours(24), 2 });
+    ASSERT_TRUE(file.open());
+    for (int i = 0; i < 6; ++i) file.write("0123456789\n");
+    file.close();
+
+    EXPECT_TRUE(fs::exists(dir_ / "access.log.gz"));
+    EXPECT_TRUE(fs::exists(dir_ / "access.log.bak"));
+    // gz и bak + две последние ротации
+    EXPECT_EQ(rotatedFiles().size(), 4u);
+}
@@ -0,0 +1,164 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+// Гистограмма задержек в микросекундах, лог-линейная, как HdrHistogram (и LatencyHistogram в utils/Metrics.h,
+// только точнее): октава [2^k, 2^(k+1)) делится на kSubBuckets равных частей — три значащие цифры.
+// Значения меньше kSubBuckets мкс хранятся точно, больше max — в последнюю корзину.
+// Не потокобезопасна: у каждого потока генератора своя, в конце они складываются через add().
+class HdrHistogram {
+public:
+    static constexpr unsigned kSubBuckets = 1024;
+    static constexpr unsigned kSubBits = std::bit_width(kSubBuckets) - 1;
+
+    explicit HdrHistogram(std::uint64_t max_micros = 3'600'000'000ull)
+        : max_(max_micros), counts_(indexOf(max_micros) + 1) {}
+
+    void record(std::uint64_t us, std::uint64_t count = 1) {
+        us = std::min(us, max_);
+        counts_[indexOf(us)] += count;
+        total_ += count;
+        min_seen_ = std::min(min_seen_, us);
+        max_seen_ = std::max(max_seen_, us);
+    }
+
+    // Поправка на coordinated omission (как recordValueWithExpectedInterval в HdrHistogram):
+    // пока ждали ответ дольше interval, не ушли запросы, которые должны были уйти по графику, —
+    // дописываем их задержки us - interval, us - 2 * interval, ...
+    void recordCorrected(std::uint64_t us, std::uint64_t interval, std::uint64_t count = 1) {
+        record(us, count);
+        if (interval == 0) return;
+        for (std::uint64_t missed = us > interval ? us - interval : 0; missed >= interval; missed -= interval) {
+            record(missed, count);
+        }
+    }
+
+    // Копия с поправкой для замкнутого цикла: interval — ожидаемый промежуток между запросами соединения
+    HdrHistogram corrected(std::uint64_t interval) const {
+        HdrHistogram out(max_);
+        for (std::size_t i = 0; i < counts_.size(); ++i) {
+            if (counts_[i] > 0) out.recordCorrected(valueAt(i), interval, counts_[i]);
+        }
+        // Корзины хранят нижнюю границу, точные крайние значения берём у исходной
+        out.min_seen_ = std::min(out.min_seen_, min_seen_);
+        out.max_seen_ = std::max(out.max_seen_, max_seen_);
+        return out;
+    }
+
+    void add(const HdrHistogram& other) {
+        const std::size_t n = std::min(counts_.size(), other.counts_.size());
+        for (std::size_t i = 0; i < n; ++i) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        min_seen_ = std::min(min_seen_, other.min_seen_);
+        max_seen_ = std::max(max_seen_, other.max_seen_);
+    }
+
+    std::uint64_t count() const { return total_; }
+    std::uint64_t min() const { return total_ ? min_seen_ : 0; }
+    std::uint64_t max() const { return max_seen_; }
+
+    double mean() const {
+        if (total_ == 0) return 0;
+        double sum = 0;
+        for (std::size_t i = 0; i < counts_.size(); ++i) sum += static_cast<double>(counts_[i]) * midpointOf(i);
+        return sum / static_cast<double>(total_);
+    }
+
+    double stddev() const {
+        if (total_ == 0) return 0;
+        const double m = mean();
+        double sum = 0;
+        for (std::size_t i = 0; i < counts_.size(); ++i) {
+            const double d = midpointOf(i) - m;
+            sum += static_cast<double>(counts_[i]) * d * d;
+        }
+        return std::sqrt(sum / static_cast<double>(total_));
+    }
+
+    // Значение percentile (0..100): верхняя граница корзины, но не больше максимума
+    std::uint64_t percentile(double p) const {
+        if (total_ == 0) return 0;
+        const auto rank = std::max<std::uint64_t>(1,
+            static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(total_))));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(highestOf(i), max_seen_);
+        }
+        return max_seen_;
+    }
+
+    // Распределение в формате .hgrm (HdrHistogram outputPercentileDistribution), значения в миллисекундах:
+    // его понимает plotFiles.html из HdrHistogram. ticks — точек на каждую половину оставшегося хвоста
+    void writePercentiles(std::ostream& out, unsigned ticks = 5) const {
+        char line[128];
+        out << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+        std::uint64_t seen = 0;
+        double next = 0;
+        for (std::size_t i = 0; i < counts_.size() && total_ > 0; ++i) {
+            if (counts_[i] == 0) continue;
+            seen += counts_[i];
+            const double reached = 100.0 * static_cast<double>(seen) / static_cast<double>(total_);
+            if (reached < next && seen < total_) continue;
+            const double value = static_cast<double>(std::min(highestOf(i), max_seen_)) / 1000.0;
+            if (seen < total_) {
+                std::snprintf(line, sizeof line, "%12.3f %2.12f %10llu %14.2f\n", value, reached / 100.0,
+                    static_cast<unsigned long long>(seen), 1.0 / (1.0 - reached / 100.0));
+            }
+            else {
+                std::snprintf(line, sizeof line, "%12.3f %2.12f %10llu\n", value, 1.0,
+                    static_cast<unsigned long long>(seen));
+            }
+            out << line;
+            // Следующая точка: хвост 100 - reached делится пополам каждые ticks точек
+            const double half = std::exp2(std::floor(std::log2(100.0 / std::max(100.0 - reached, 1e-9))));
+            next = reached + 100.0 / (half * 2 * ticks);
+        }
+        std::snprintf(line, sizeof line, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean() / 1000.0, stddev() / 1000.0);
+        out << line;
+        std::snprintf(line, sizeof line, "#[Max     = %12.3f, Total count    = %12llu]\n",
+            static_cast<double>(max_seen_) / 1000.0, static_cast<unsigned long long>(total_));
+        out << line;
+        std::snprintf(line, sizeof line, "#[Buckets = %12zu, SubBuckets     = %12u]\n",
+            counts_.size() / kSubBuckets, kSubBuckets);
+        out << line;
+    }
+
+private:
+    std::uint64_t max_;
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t total_ = 0;
+    std::uint64_t min_seen_ = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max_seen_ = 0;
+
+    static std::size_t indexOf(std::uint64_t us) {
+        if (us < kSubBuckets) return static_cast<std::size_t>(us);
+        const unsigned octave = static_cast<unsigned>(std::bit_width(us)) - 1;     // >= kSubBits
+        const std::size_t sub = static_cast<std::size_t>(us >> (octave - kSubBits)) - kSubBuckets;
+        return kSubBuckets + (octave - kSubBits) * kSubBuckets + sub;
+    }
+
+    // Нижняя граница корзины и её ширина
+    static std::uint64_t valueAt(std::size_t index) {
+        if (index < kSubBuckets) return index;
+        const std::size_t shift = (index - kSubBuckets) / kSubBuckets;
+        const std::size_t sub = (index - kSubBuckets) % kSubBuckets;
+        return static_cast<std::uint64_t>(kSubBuckets + sub) << shift;
+    }
+
+    static std::uint64_t widthOf(std::size_t index) {
+        return index < kSubBuckets ? 1 : std::uint64_t{ 1 } << ((index - kSubBuckets) / kSubBuckets);
+    }
+
+    static std::uint64_t highestOf(std::size_t index) { return valueAt(index) + widthOf(index) - 1; }
+    static double midpointOf(std::size_t index) {
+        return static_cast<double>(valueAt(index)) + static_cast<double>(widthOf(index) - 1) / 2;
+    }
+};
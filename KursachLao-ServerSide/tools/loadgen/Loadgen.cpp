@@ -0,0 +1,539 @@
+﻿// Генератор HTTP-нагрузки для сервера: воспроизводимые профили вместо ручного curl в цикле.
+//
+// Режимы:
+//  - замкнутый цикл (--rate 0): каждое соединение держит --pipeline запросов в полёте
+//    и отправляет следующий, как только пришёл ответ;
+//  - открытый цикл (--rate N): N запросов в секунду на всех по расписанию, независимо от ответов.
+//    Задержка считается от запланированного момента отправки, поэтому очередь из-за медленного
+//    сервера в ней видна (поправка на coordinated omission, как в wrk2).
+// Для замкнутого цикла дополнительно печатается гистограмма с поправкой HdrHistogram
+// (ожидаемый интервал — средняя задержка / pipeline или --co-interval-us).
+//
+// Пример: loadgen --scenario tools/loadgen/scenario.txt -c 64 -t 4 --rate 2000 -d 60
+// Сервер по умолчанию ограничивает частоту по IP: для замеров запускайте его с --allow-cidr 127.0.0.1/32.
+
+#include "HdrHistogram.h"
+#include "Scenario.h"
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/program_options.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace po = boost::program_options;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    constexpr std::uint64_t kBodyLimit = 512ull * 1024 * 1024;         // /api/all-data бывает большим
+    constexpr auto kReconnectBackoff = std::chrono::milliseconds(20);
+
+    struct Options {
+        std::string host = "127.0.0.1";
+        std::string port = "8080";
+        std::string scenario;
+        unsigned threads = 0;               // 0 — по числу ядер, но не больше соединений
+        unsigned connections = 16;
+        double duration_s = 30;
+        double warmup_s = 5;
+        double rate = 0;                    // Запросов в секунду на всех, 0 — замкнутый цикл
+        unsigned pipeline = 1;
+        bool keep_alive = true;
+        double grace_s = 5;                 // Сколько ждать ответы на запросы, отправленные до конца замера
+        std::vector<std::string> headers;
+        std::uint64_t seed = 1;
+        std::uint64_t co_interval_us = 0;   // 0 — средняя задержка / pipeline
+        std::string hgrm;
+    };
+
+    // Общие для всех потоков параметры прогона (только чтение)
+    struct Run {
+        Options options;
+        Scenario scenario;
+        std::vector<tcp::endpoint> endpoints;
+        Clock::time_point start;
+        Clock::time_point measure_from;     // Конец прогрева
+        Clock::time_point stop_at;          // Конец замера: новые запросы больше не создаются
+        Clock::duration interval{};         // Открытый цикл: промежуток между запросами одного соединения
+
+        bool openLoop() const { return options.rate > 0; }
+    };
+
+    struct Stats {
+        explicit Stats(std::size_t entries) : per_entry(entries) {}
+
+        HdrHistogram latency;
+        std::vector<HdrHistogram> per_entry;
+        std::array<std::uint64_t, 6> status_classes{};    // По status / 100; [0] — не HTTP-статус
+        std::uint64_t too_many_requests = 0;              // 429 — сработал лимит сервера
+        std::uint64_t overloaded = 0;                     // 503 — сброс нагрузки
+        std::uint64_t bytes = 0;
+        std::uint64_t connect_errors = 0;
+        std::uint64_t io_errors = 0;
+        std::uint64_t dropped = 0;          // Отправлены, но соединение закрылось раньше ответа
+        std::uint64_t unfinished = 0;       // Не дождались ответа за grace
+
+        void add(const Stats& other) {
+            latency.add(other.latency);
+            for (std::size_t i = 0; i < per_entry.size(); ++i) per_entry[i].add(other.per_entry[i]);
+            for (std::size_t i = 0; i < status_classes.size(); ++i) status_classes[i] += other.status_classes[i];
+            too_many_requests += other.too_many_requests;
+            overloaded += other.overloaded;
+            bytes += other.bytes;
+            connect_errors += other.connect_errors;
+            io_errors += other.io_errors;
+            dropped += other.dropped;
+            unfinished += other.unfinished;
+        }
+    };
+
+    struct Request {
+        std::size_t entry;
+        Clock::time_point start;            // Запланированный (открытый цикл) или фактический момент отправки
+    };
+
+    class Connection;
+
+    // Поток генератора: свой io_context, свои соединения и статистика — без общих блокировок
+    class Worker {
+    public:
+        Worker(const Run& run, std::size_t index)
+            : run_(run), rng_(run.options.seed + index), pick_(run.scenario.distribution()),
+            stats_(run.scenario.entries.size()), stop_timer_(ioc_) {}
+
+        void addConnection(std::size_t global_index);
+        void run();
+
+        const Run& params() const { return run_; }
+        net::io_context& ioc() { return ioc_; }
+        Stats& stats() { return stats_; }
+        std::size_t pickEntry() { return pick_(rng_); }
+        void appendRequest(std::string& out, std::size_t entry) { run_.scenario.append(out, entry, rng_); }
+
+        bool measured(const Request& r) const { return r.start >= run_.measure_from && r.start < run_.stop_at; }
+
+        void record(const Request& r, unsigned status, std::size_t bytes, Clock::time_point now) {
+            if (!measured(r)) return;
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(now - r.start).count();
+            const auto value = static_cast<std::uint64_t>(us > 0 ? us : 0);
+            stats_.latency.record(value);
+            stats_.per_entry[r.entry].record(value);
+            ++stats_.status_classes[status >= 100 && status < 600 ? status / 100 : 0];
+            if (status == 429) ++stats_.too_many_requests;
+            if (status == 503) ++stats_.overloaded;
+            stats_.bytes += bytes;
+        }
+
+        // После конца замера: как только все соединения без запросов — поток свободен
+        void maybeFinish();
+
+    private:
+        const Run& run_;
+        net::io_context ioc_{ 1 };
+        std::mt19937_64 rng_;
+        std::discrete_distribution<std::size_t> pick_;
+        Stats stats_;
+        net::steady_timer stop_timer_;
+        std::vector<std::shared_ptr<Connection>> connections_;
+
+        void stopAll();
+    };
+
+    class Connection : public std::enable_shared_from_this<Connection> {
+    public:
+        Connection(Worker& worker, std::size_t global_index)
+            : worker_(worker), run_(worker.params()), index_(global_index),
+            socket_(worker.ioc()), schedule_timer_(worker.ioc()), reconnect_timer_(worker.ioc()) {}
+
+        void start() {
+            if (run_.openLoop()) {
+                // Соединения сдвинуты по фазе, чтобы запросы шли равномерно, а не пачками
+                next_ = run_.start + run_.interval * static_cast<Clock::rep>(index_) / static_cast<Clock::rep>(run_.options.connections);
+                scheduleNext();
+            }
+            connect();
+        }
+
+        void stop() {
+            stopped_ = true;
+            ++generation_;
+            for (const auto& r : in_flight_) if (worker_.measured(r)) ++worker_.stats().unfinished;
+            for (const auto& r : pending_) if (worker_.measured(r)) ++worker_.stats().unfinished;
+            in_flight_.clear();
+            pending_.clear();
+            schedule_timer_.cancel();
+            reconnect_timer_.cancel();
+            beast::error_code ignored;
+            socket_.close(ignored);
+        }
+
+        bool idle() const { return stopped_ || (in_flight_.empty() && pending_.empty()); }
+
+    private:
+        Worker& worker_;
+        const Run& run_;
+        const std::size_t index_;
+        tcp::socket socket_;
+        net::steady_timer schedule_timer_;
+        net::steady_timer reconnect_timer_;
+        beast::flat_buffer buffer_;
+        std::optional<http::response_parser<http::string_body>> parser_;
+        std::string write_buf_;
+        std::deque<Request> pending_;       // Созданы, ещё не отправлены
+        std::deque<Request> in_flight_;     // Отправлены, ждут ответа (по порядку — pipelining)
+        Clock::time_point next_{};
+        std::uint64_t generation_ = 0;      // Завершения операций прошлого подключения игнорируются
+        bool connected_ = false;
+        bool writing_ = false;
+        bool reading_ = false;
+        bool stopped_ = false;
+
+        bool generating() const { return !stopped_ && Clock::now() < run_.stop_at; }
+
+        void connect() {
+            const auto gen = ++generation_;
+            net::async_connect(socket_, run_.endpoints, [self = shared_from_this(), gen](beast::error_code ec, const tcp::endpoint&) {
+                if (gen != self->generation_) return;
+                if (ec) {
+                    ++self->worker_.stats().connect_errors;
+                    return self->reconnect(true);
+                }
+                self->onConnected();
+            });
+        }
+
+        void onConnected() {
+            connected_ = true;
+            beast::error_code ignored;
+            socket_.set_option(tcp::no_delay(true), ignored);
+            if (!run_.openLoop() && generating()) {
+                while (pending_.size() + in_flight_.size() < run_.options.pipeline) enqueue(Clock::now());
+            }
+            trySend();
+        }
+
+        // Разрыв: на отправленные запросы ответов уже не будет; неотправленные ждут нового подключения
+        void reconnect(bool backoff) {
+            worker_.stats().dropped += in_flight_.size();
+            in_flight_.clear();
+            write_buf_.clear();
+            buffer_.clear();
+            connected_ = writing_ = reading_ = false;
+            ++generation_;
+            beast::error_code ignored;
+            socket_.close(ignored);
+            if (stopped_) return;
+            if (!backoff) return connect();
+            reconnect_timer_.expires_after(kReconnectBackoff);
+            reconnect_timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (!ec && !self->stopped_) self->connect();
+            });
+        }
+
+        void scheduleNext() {
+            if (next_ >= run_.stop_at) return;
+            schedule_timer_.expires_at(next_);
+            schedule_timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (ec || self->stopped_) return;
+                // Поток мог проснуться поздно: все пропущенные запросы — со своим временем по расписанию
+                const auto now = Clock::now();
+                while (self->next_ <= now && self->next_ < self->run_.stop_at) {
+                    self->enqueue(self->next_);
+                    self->next_ += self->run_.interval;
+                }
+                self->scheduleNext();
+            });
+        }
+
+        void enqueue(Clock::time_point start) {
+            pending_.push_back({ worker_.pickEntry(), start });
+            trySend();
+        }
+
+        // Всё, что помещается в окно pipelining, уходит одной записью
+        void trySend() {
+            if (!connected_ || writing_) return;
+            while (!pending_.empty() && in_flight_.size() < run_.options.pipeline) {
+                in_flight_.push_back(pending_.front());
+                pending_.pop_front();
+                worker_.appendRequest(write_buf_, in_flight_.back().entry);
+            }
+            if (write_buf_.empty()) return;
+
+            writing_ = true;
+            net::async_write(socket_, net::buffer(write_buf_), [self = shared_from_this(), gen = generation_](beast::error_code ec, std::size_t) {
+                if (gen != self->generation_) return;
+                self->writing_ = false;
+                self->write_buf_.clear();
+                if (ec) {
+                    ++self->worker_.stats().io_errors;
+                    return self->reconnect(true);
+                }
+                self->startRead();
+                self->trySend();
+            });
+        }
+
+        void startRead() {
+            if (reading_ || in_flight_.empty()) return;
+            reading_ = true;
+            parser_.emplace();
+            parser_->body_limit(kBodyLimit);
+            http::async_read(socket_, buffer_, *parser_, [self = shared_from_this(), gen = generation_](beast::error_code ec, std::size_t bytes) {
+                if (gen != self->generation_) return;
+                self->reading_ = false;
+                if (ec) {
+                    ++self->worker_.stats().io_errors;
+                    return self->reconnect(true);
+                }
+                self->onResponse(bytes);
+            });
+        }
+
+        void onResponse(std::size_t bytes) {
+            const auto now = Clock::now();
+            const Request request = in_flight_.front();
+            in_flight_.pop_front();
+            const auto& res = parser_->get();
+            worker_.record(request, res.result_int(), bytes, now);
+            // Со своим Connection: close сервер вправе закрыть соединение, не повторяя заголовок
+            const bool keep_alive = run_.options.keep_alive && res.keep_alive();
+
+            // Замкнутый цикл: следующий запрос сразу; без keep-alive его время включает новое подключение
+            if (!run_.openLoop() && generating()) pending_.push_back({ worker_.pickEntry(), now });
+
+            if (!keep_alive) {
+                reconnect(false);
+            }
+            else {
+                trySend();
+                startRead();
+            }
+            if (!generating()) worker_.maybeFinish();
+        }
+    };
+
+    void Worker::addConnection(std::size_t global_index) {
+        connections_.push_back(std::make_shared<Connection>(*this, global_index));
+    }
+
+    void Worker::run() {
+        for (auto& c : connections_) c->start();
+        stop_timer_.expires_at(run_.stop_at + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(run_.options.grace_s)));
+        stop_timer_.async_wait([this](beast::error_code ec) {
+            if (!ec) stopAll();
+        });
+        ioc_.run();
+    }
+
+    void Worker::maybeFinish() {
+        for (const auto& c : connections_) {
+            if (!c->idle()) return;
+        }
+        stopAll();
+        stop_timer_.cancel();
+    }
+
+    void Worker::stopAll() {
+        for (auto& c : connections_) c->stop();
+    }
+
+    double ms(std::uint64_t us) { return static_cast<double>(us) / 1000.0; }
+
+    void printLatency(std::ostream& out, const char* title, const HdrHistogram& h) {
+        static constexpr double kPercentiles[] = { 50, 75, 90, 99, 99.9, 99.99 };
+        out << title << "\n";
+        char line[160];
+        std::snprintf(line, sizeof line, "  %10s %10s %10s %10s %10s %10s %10s %10s\n",
+            "p50", "p75", "p90", "p99", "p99.9", "p99.99", "max", "mean");
+        out << line;
+        std::snprintf(line, sizeof line, "  %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+            ms(h.percentile(kPercentiles[0])), ms(h.percentile(kPercentiles[1])), ms(h.percentile(kPercentiles[2])),
+            ms(h.percentile(kPercentiles[3])), ms(h.percentile(kPercentiles[4])), ms(h.percentile(kPercentiles[5])),
+            ms(h.max()), h.mean() / 1000.0);
+        out << line;
+    }
+
+    void printReport(const Run& run, const Stats& stats) {
+        const auto& o = run.options;
+        const std::uint64_t completed = stats.latency.count();
+        char line[256];
+
+        std::cout << "\nRequests: " << completed << " in " << o.duration_s << " s ("
+            << static_cast<double>(completed) / o.duration_s << " req/s), "
+            << static_cast<double>(stats.bytes) / (1024.0 * 1024.0) << " MiB read\n";
+        std::snprintf(line, sizeof line, "Responses: 1xx %llu, 2xx %llu, 3xx %llu, 4xx %llu (429: %llu), 5xx %llu (503: %llu)\n",
+            static_cast<unsigned long long>(stats.status_classes[1]), static_cast<unsigned long long>(stats.status_classes[2]),
+            static_cast<unsigned long long>(stats.status_classes[3]), static_cast<unsigned long long>(stats.status_classes[4]),
+            static_cast<unsigned long long>(stats.too_many_requests), static_cast<unsigned long long>(stats.status_classes[5]),
+            static_cast<unsigned long long>(stats.overloaded));
+        std::cout << line;
+        std::snprintf(line, sizeof line, "Errors: connect %llu, io %llu, dropped %llu, unfinished %llu\n",
+            static_cast<unsigned long long>(stats.connect_errors), static_cast<unsigned long long>(stats.io_errors),
+            static_cast<unsigned long long>(stats.dropped), static_cast<unsigned long long>(stats.unfinished));
+        std::cout << line << "\n";
+
+        const HdrHistogram* report = &stats.latency;
+        std::optional<HdrHistogram> corrected;
+        if (run.openLoop()) {
+            printLatency(std::cout, "Latency, ms (from scheduled send time, corrected for coordinated omission):", stats.latency);
+        }
+        else {
+            printLatency(std::cout, "Latency, ms (closed loop, as measured):", stats.latency);
+            const std::uint64_t interval = o.co_interval_us > 0 ? o.co_interval_us
+                : static_cast<std::uint64_t>(stats.latency.mean() / o.pipeline);
+            corrected = stats.latency.corrected(interval);
+            std::cout << "\n";
+            printLatency(std::cout, ("Latency, ms (corrected for coordinated omission, expected interval "
+                + std::to_string(interval) + " us):").c_str(), *corrected);
+            report = &*corrected;
+        }
+
+        std::cout << "\nPer request:\n";
+        std::snprintf(line, sizeof line, "  %8s %10s %10s %10s %10s  %s\n", "share", "count", "p50", "p99", "max", "request");
+        std::cout << line;
+        for (std::size_t i = 0; i < run.scenario.entries.size(); ++i) {
+            const auto& entry = run.scenario.entries[i];
+            const auto& h = stats.per_entry[i];
+            std::snprintf(line, sizeof line, "  %7.1f%% %10llu %10.3f %10.3f %10.3f  ",
+                completed ? 100.0 * static_cast<double>(h.count()) / static_cast<double>(completed) : 0.0,
+                static_cast<unsigned long long>(h.count()), ms(h.percentile(50)), ms(h.percentile(99)), ms(h.max()));
+            std::cout << line << entry.method << " " << entry.target << "\n";
+        }
+
+        if (!o.hgrm.empty()) {
+            std::ofstream file(o.hgrm);
+            report->writePercentiles(file);
+            std::cout << "\nPercentile distribution written to " << o.hgrm << "\n";
+        }
+    }
+
+    std::optional<Options> parseOptions(int argc, char* argv[]) {
+        Options o;
+        po::options_description desc("Usage: loadgen --scenario <file> [options]");
+        desc.add_options()
+            ("help,h", "Show help")
+            ("host", po::value<std::string>(&o.host)->default_value(o.host), "Server address")
+            ("port,p", po::value<std::string>(&o.port)->default_value(o.port), "Server port")
+            ("scenario,s", po::value<std::string>(&o.scenario)->required(),
+                "Weighted request list: '<weight> <METHOD> <target> [json body]' per line")
+            ("connections,c", po::value<unsigned>(&o.connections)->default_value(o.connections), "Open connections")
+            ("threads,t", po::value<unsigned>(&o.threads)->default_value(0), "Threads (0 = hardware concurrency)")
+            ("duration,d", po::value<double>(&o.duration_s)->default_value(o.duration_s), "Measured seconds")
+            ("warmup", po::value<double>(&o.warmup_s)->default_value(o.warmup_s), "Seconds before measuring")
+            ("rate,r", po::value<double>(&o.rate)->default_value(0),
+                "Open loop: total requests per second on schedule (0 = closed loop)")
+            ("pipeline", po::value<unsigned>(&o.pipeline)->default_value(o.pipeline), "Requests in flight per connection")
+            ("no-keepalive", po::bool_switch(), "Send 'Connection: close' and reconnect for every request")
+            ("header,H", po::value<std::vector<std::string>>(&o.headers)->multitoken(), "Extra header 'Name: value'")
+            ("grace", po::value<double>(&o.grace_s)->default_value(o.grace_s), "Seconds to wait for outstanding responses")
+            ("seed", po::value<std::uint64_t>(&o.seed)->default_value(o.seed), "Random seed (same seed, same request sequence)")
+            ("co-interval-us", po::value<std::uint64_t>(&o.co_interval_us)->default_value(0),
+                "Closed loop: expected interval for coordinated omission correction (0 = mean latency / pipeline)")
+            ("hgrm", po::value<std::string>(&o.hgrm), "Write the percentile distribution (.hgrm) to this file");
+
+        po::variables_map vm;
+        try {
+            po::store(po::parse_command_line(argc, argv, desc), vm);
+            if (vm.count("help")) {
+                std::cout << desc << "\n";
+                return std::nullopt;
+            }
+            po::notify(vm);
+        }
+        catch (const po::error& e) {
+            std::cerr << "Error: " << e.what() << "\n" << desc << "\n";
+            return std::nullopt;
+        }
+        o.keep_alive = !vm["no-keepalive"].as<bool>();
+
+        if (o.connections == 0 || o.pipeline == 0 || o.duration_s <= 0 || o.warmup_s < 0 || o.rate < 0 || o.grace_s < 0) {
+            std::cerr << "Error: connections, pipeline and duration must be > 0; warmup, rate and grace >= 0\n";
+            return std::nullopt;
+        }
+        if (!o.keep_alive && o.pipeline > 1) {
+            std::cerr << "Error: pipelining needs keep-alive\n";
+            return std::nullopt;
+        }
+        if (o.threads == 0) o.threads = std::max(1u, std::thread::hardware_concurrency());
+        o.threads = std::min(o.threads, o.connections);
+        return o;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto options = parseOptions(argc, argv);
+    if (!options) return 1;
+
+    Run run;
+    run.options = std::move(*options);
+    const auto& o = run.options;
+
+    std::ifstream file(o.scenario);
+    if (!file) {
+        std::cerr << "Error: cannot open scenario " << o.scenario << "\n";
+        return 1;
+    }
+    std::string error;
+    auto scenario = Scenario::parse(file, error);
+    if (!scenario) {
+        std::cerr << "Error: " << o.scenario << ": " << error << "\n";
+        return 1;
+    }
+    run.scenario = std::move(*scenario);
+    run.scenario.prepare(o.host + ":" + o.port, o.headers, o.keep_alive);
+
+    try {
+        net::io_context ioc;
+        tcp::resolver resolver(ioc);
+        for (const auto& entry : resolver.resolve(o.host, o.port)) run.endpoints.push_back(entry.endpoint());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: cannot resolve " << o.host << ":" << o.port << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    if (run.openLoop()) {
+        run.interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(o.connections / o.rate));
+    }
+
+    std::cout << "loadgen: " << o.host << ":" << o.port << ", " << o.connections << " connections, " << o.threads
+        << " threads, " << (run.openLoop() ? "open loop " + std::to_string(o.rate) + " req/s" : std::string("closed loop"))
+        << ", pipeline " << o.pipeline << (o.keep_alive ? ", keep-alive" : ", no keep-alive")
+        << ", " << o.duration_s << " s after " << o.warmup_s << " s warmup\n";
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned i = 0; i < o.threads; ++i) workers.push_back(std::make_unique<Worker>(run, i));
+    for (unsigned i = 0; i < o.connections; ++i) workers[i % o.threads]->addConnection(i);
+
+    // Время старта общее: все потоки начинают по одному расписанию
+    const auto seconds = [](double s) { return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s)); };
+    run.start = Clock::now() + std::chrono::milliseconds(50);
+    run.measure_from = run.start + seconds(o.warmup_s);
+    run.stop_at = run.measure_from + seconds(o.duration_s);
+
+    std::vector<std::thread> threads;
+    for (auto& w : workers) threads.emplace_back([&w] { w->run(); });
+    for (auto& t : threads) t.join();
+
+    Stats total(run.scenario.entries.size());
+    for (const auto& w : workers) total.add(w->stats());
+    printReport(run, total);
+    return 0;
+}
@@ -0,0 +1,153 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Сценарий нагрузки: взвешенный список запросов, по одному на строку:
+//   <вес> <МЕТОД> <target> [тело до конца строки]
+// Пустые строки и строки с '#' в начале пропускаются. Тело уходит с Content-Type: application/json.
+// В target и теле {rand:A-B} заменяется случайным целым из [A, B] для каждого запроса —
+// так POST на /api/employees/{rand:1-50}/penalties расходится по разным сотрудникам.
+struct ScenarioEntry {
+    double weight = 0;
+    std::string method;
+    std::string target;
+    std::string body;
+    std::string head;       // Готовые заголовки без Host/Connection (см. Scenario::prepare)
+    bool templated = false;
+};
+
+class Scenario {
+public:
+    std::vector<ScenarioEntry> entries;
+
+    static std::optional<Scenario> parse(std::istream& in, std::string& error) {
+        Scenario scenario;
+        std::string line;
+        for (int line_no = 1; std::getline(in, line); ++line_no) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            const auto first = line.find_first_not_of(" \t");
+            if (first == std::string::npos || line[first] == '#') continue;
+
+            std::istringstream fields(line);
+            ScenarioEntry entry;
+            if (!(fields >> entry.weight >> entry.method >> entry.target) || entry.weight <= 0) {
+                error = "line " + std::to_string(line_no) + ": expected '<weight> <METHOD> <target> [body]'";
+                return std::nullopt;
+            }
+            if (entry.target.empty() || entry.target[0] != '/') {
+                error = "line " + std::to_string(line_no) + ": target must start with '/'";
+                return std::nullopt;
+            }
+            std::getline(fields >> std::ws, entry.body);
+            entry.templated = hasPlaceholder(entry.target) || hasPlaceholder(entry.body);
+            if (entry.templated && !validPlaceholders(entry.target + entry.body)) {
+                error = "line " + std::to_string(line_no) + ": bad placeholder, expected {rand:A-B}";
+                return std::nullopt;
+            }
+            scenario.entries.push_back(std::move(entry));
+        }
+        if (scenario.entries.empty()) {
+            error = "no requests";
+            return std::nullopt;
+        }
+        return scenario;
+    }
+
+    // Общие заголовки (Host, свои -H, Connection: close без keep-alive); для запросов без шаблонов
+    // текст собирается здесь один раз
+    void prepare(const std::string& host, const std::vector<std::string>& headers, bool keep_alive) {
+        common_ = "Host: " + host + "\r\nUser-Agent: kursach-loadgen\r\n";
+        for (const auto& h : headers) common_ += h + "\r\n";
+        if (!keep_alive) common_ += "Connection: close\r\n";
+        for (auto& entry : entries) {
+            if (!entry.templated) entry.head = render(entry.method, entry.target, entry.body);
+        }
+    }
+
+    std::discrete_distribution<std::size_t> distribution() const {
+        std::vector<double> weights;
+        for (const auto& entry : entries) weights.push_back(entry.weight);
+        return std::discrete_distribution<std::size_t>(weights.begin(), weights.end());
+    }
+
+    // Дописывает в out полный текст запроса
+    template <class Rng>
+    void append(std::string& out, std::size_t index, Rng& rng) const {
+        const auto& entry = entries[index];
+        if (!entry.templated) {
+            out += entry.head;
+            return;
+        }
+        out += render(entry.method, expand(entry.target, rng), expand(entry.body, rng));
+    }
+
+private:
+    std::string common_;
+
+    static constexpr std::string_view kPlaceholder = "{rand:";
+
+    static bool hasPlaceholder(const std::string& text) { return text.find(kPlaceholder) != std::string::npos; }
+
+    // {rand:A-B} -> A, B; pos — начало плейсхолдера, end — позиция после '}'
+    static bool parsePlaceholder(const std::string& text, std::size_t pos, long long& lo, long long& hi, std::size_t& end) {
+        const auto close = text.find('}', pos);
+        if (close == std::string::npos) return false;
+        const std::string range = text.substr(pos + kPlaceholder.size(), close - pos - kPlaceholder.size());
+        const auto dash = range.find('-', 1);
+        if (dash == std::string::npos) return false;
+        try {
+            std::size_t used = 0;
+            lo = std::stoll(range.substr(0, dash), &used);
+            if (used != dash) return false;
+            hi = std::stoll(range.substr(dash + 1), &used);
+            if (used != range.size() - dash - 1) return false;
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+        end = close + 1;
+        return lo <= hi;
+    }
+
+    static bool validPlaceholders(const std::string& text) {
+        long long lo, hi;
+        std::size_t end = 0;
+        for (auto pos = text.find(kPlaceholder); pos != std::string::npos; pos = text.find(kPlaceholder, end)) {
+            if (!parsePlaceholder(text, pos, lo, hi, end)) return false;
+        }
+        return true;
+    }
+
+    template <class Rng>
+    static std::string expand(const std::string& text, Rng& rng) {
+        std::string out;
+        long long lo, hi;
+        std::size_t from = 0, end = 0;
+        for (auto pos = text.find(kPlaceholder); pos != std::string::npos; pos = text.find(kPlaceholder, end)) {
+            parsePlaceholder(text, pos, lo, hi, end);   // Проверено в parse()
+            out.append(text, from, pos - from);
+            out += std::to_string(std::uniform_int_distribution<long long>(lo, hi)(rng));
+            from = end;
+        }
+        out.append(text, from, std::string::npos);
+        return out;
+    }
+
+    std::string render(const std::string& method, const std::string& target, const std::string& body) const {
+        std::string out = method + " " + target + " HTTP/1.1\r\n" + common_;
+        if (!body.empty()) out += "Content-Type: application/json\r\n";
+        if (!body.empty() || (method != "GET" && method != "HEAD")) {
+            out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        }
+        out += "\r\n";
+        out += body;
+        return out;
+    }
+};
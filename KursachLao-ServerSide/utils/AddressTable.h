@@ -0,0 +1,221 @@
+﻿#pragma once
+
+#include <boost/asio/ip/address.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Ключ клиента — сырые 16 байт адреса. IPv4 хранится как v4-mapped IPv6 (::ffff:a.b.c.d),
+// так что один и тот же клиент не раздваивается. Построение ключа не выделяет память.
+struct ClientKey {
+    std::array<unsigned char, 16> bytes{};
+
+    static ClientKey from(const boost::asio::ip::address& address) {
+        ClientKey key;
+        if (address.is_v4()) {
+            key.bytes = boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, address.to_v4()).to_bytes();
+        }
+        else {
+            key.bytes = address.to_v6().to_bytes();
+        }
+        return key;
+    }
+
+    boost::asio::ip::address toAddress() const {
+        boost::asio::ip::address_v6 v6(bytes);
+        if (v6.is_v4_mapped()) return boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, v6);
+        return v6;
+    }
+
+    // splitmix64 по обеим половинам — адреса из одной подсети расходятся по разным шардам
+    std::uint64_t hash() const {
+        std::uint64_t hi, lo;
+        std::memcpy(&hi, bytes.data(), 8);
+        std::memcpy(&lo, bytes.data() + 8, 8);
+        return mix(hi ^ mix(lo));
+    }
+
+    bool operator==(const ClientKey& other) const { return bytes == other.bytes; }
+
+private:
+    static std::uint64_t mix(std::uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+};
+
+// Таблица состояний по адресу клиента фиксированного размера.
+// ShardCount шардов со своим mutex (общей блокировки нет), в каждом — открытая адресация
+// с линейным пробированием на SlotsPerShard ячеек. Вся память выделяется в конструкторе,
+// поиск и вставка не аллоцируют. Если в окне пробирования нет места, вытесняется
+// самая давно не виденная запись (State::last_seen) среди тех, что разрешает вытеснять
+// предикат evictable; если таких нет — самая давняя вообще. Таблица не растёт под сканированием адресов.
+template <class State, std::size_t ShardCount = 16, std::size_t SlotsPerShard = 4096>
+class AddressTable {
+    static_assert((ShardCount & (ShardCount - 1)) == 0, "ShardCount must be a power of two");
+    static_assert((SlotsPerShard & (SlotsPerShard - 1)) == 0, "SlotsPerShard must be a power of two");
+
+public:
+    static constexpr std::size_t kMaxProbe = 16;
+
+    AddressTable() : shards_(std::make_unique<Shard[]>(ShardCount)) {}
+
+    // Любую запись можно вытеснить
+    struct EvictAny {
+        bool operator()(const State&) const { return true; }
+    };
+
+    // f(State&, bool inserted) под блокировкой шарда; возвращает результат f.
+    // Новая запись создаётся из State{} (или замещает вытесненную).
+    // evictable(const State&) — можно ли отдать запись под новый ключ в первую очередь
+    template <class F, class Evictable = EvictAny>
+    decltype(auto) access(const ClientKey& key, F&& f, Evictable&& evictable = {}) {
+        const auto h = key.hash();
+        Shard& shard = shards_[shardIndex(h)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        const std::size_t home = slotIndex(h);
+        Slot* free_slot = nullptr;
+        Slot* oldest = nullptr;            // среди разрешённых к вытеснению
+        Slot* oldest_any = nullptr;
+        for (std::size_t i = 0; i < kMaxProbe; ++i) {
+            Slot& slot = shard.slots[(home + i) & kSlotMask];
+            if (!slot.used) {
+                free_slot = &slot;
+                break;
+            }
+            if (slot.key == key) return f(slot.state, false);
+            if (!oldest_any || slot.state.last_seen < oldest_any->state.last_seen) oldest_any = &slot;
+            if ((!oldest || slot.state.last_seen < oldest->state.last_seen) && evictable(std::as_const(slot.state))) {
+                oldest = &slot;
+            }
+        }
+
+        Slot& target = free_slot ? *free_slot : oldest ? *oldest : *oldest_any;
+        if (free_slot) ++shard.size;
+        target.used = true;
+        target.key = key;
+        target.state = State{};
+        return f(target.state, true);
+    }
+
+    // f(State&) только для существующей записи; false — записи нет
+    template <class F>
+    bool update(const ClientKey& key, F&& f) {
+        const auto h = key.hash();
+        Shard& shard = shards_[shardIndex(h)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        const std::size_t home = slotIndex(h);
+        for (std::size_t i = 0; i < kMaxProbe; ++i) {
+            Slot& slot = shard.slots[(home + i) & kSlotMask];
+            if (!slot.used) return false;
+            if (slot.key == key) {
+                f(slot.state);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Удаляет записи, для которых pred(key, state) == true. Обходит только шарды [first, first + count),
+    // чтобы большую таблицу можно было чистить порциями. Возвращает число удалённых
+    template <class Pred>
+    std::size_t eraseIf(std::size_t first, std::size_t count, Pred&& pred) {
+        std::size_t erased = 0;
+        for (std::size_t s = first; s < first + count && s < ShardCount; ++s) {
+            Shard& shard = shards_[s];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (std::size_t i = 0; i < SlotsPerShard; ++i) {
+                // После сдвига в ячейку i может переехать следующая запись — проверяем снова
+                while (shard.slots[i].used && pred(shard.slots[i].key, shard.slots[i].state)) {
+                    eraseAt(shard, i);
+                    ++erased;
+                }
+            }
+        }
+        return erased;
+    }
+
+    template <class Pred>
+    std::size_t eraseIf(Pred&& pred) {
+        return eraseIf(0, ShardCount, std::forward<Pred>(pred));
+    }
+
+    // f(key, const State&) для каждой записи; шарды обходятся по очереди, каждый под своей блокировкой
+    template <class F>
+    void forEach(F&& f) const {
+        for (std::size_t s = 0; s < ShardCount; ++s) {
+            std::lock_guard<std::mutex> lock(shards_[s].mutex);
+            for (const auto& slot : shards_[s].slots) {
+                if (slot.used) f(slot.key, slot.state);
+            }
+        }
+    }
+
+    void clear() {
+        for (std::size_t s = 0; s < ShardCount; ++s) {
+            std::lock_guard<std::mutex> lock(shards_[s].mutex);
+            for (auto& slot : shards_[s].slots) slot.used = false;
+            shards_[s].size = 0;
+        }
+    }
+
+    std::size_t size() const {
+        std::size_t total = 0;
+        for (std::size_t s = 0; s < ShardCount; ++s) {
+            std::lock_guard<std::mutex> lock(shards_[s].mutex);
+            total += shards_[s].size;
+        }
+        return total;
+    }
+
+    static constexpr std::size_t shardCount() { return ShardCount; }
+    static constexpr std::size_t capacity() { return ShardCount * SlotsPerShard; }
+
+private:
+    static constexpr std::size_t kSlotMask = SlotsPerShard - 1;
+
+    struct Slot {
+        ClientKey key;
+        bool used = false;
+        State state{};
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::size_t size = 0;
+        std::array<Slot, SlotsPerShard> slots{};
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+
+    // Старшие биты хэша — шард, младшие — ячейка
+    static std::size_t shardIndex(std::uint64_t h) { return static_cast<std::size_t>(h >> 58) & (ShardCount - 1); }
+    static std::size_t slotIndex(std::uint64_t h) { return static_cast<std::size_t>(h) & kSlotMask; }
+
+    // Удаление со сдвигом назад (без надгробий): следующие записи цепочки подтягиваются
+    // на освободившееся место, если это не уводит их раньше их домашней ячейки
+    static void eraseAt(Shard& shard, std::size_t i) {
+        std::size_t j = i;
+        for (;;) {
+            j = (j + 1) & kSlotMask;
+            Slot& next = shard.slots[j];
+            if (!next.used) break;
+            const std::size_t home = slotIndex(next.key.hash());
+            const bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (stays) continue;
+            shard.slots[i] = next;
+            i = j;
+        }
+        shard.slots[i].used = false;
+        --shard.size;
+    }
+};
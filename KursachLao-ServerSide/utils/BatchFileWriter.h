@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include "MpscRing.h"
+#include "RotatingFile.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Асинхронная запись журнала в файл пачками (журнал доступа, трейсы).
+// Производители копируют запись фиксированного размера в MpscRing и не блокируются;
+// фоновый поток раз в flush_interval (и при остановке) выбирает очередь, форматирует
+// пачку через Format и пишет её одной записью в RotatingFile.
+// Если кольцо полно, запись теряется и считается в dropped().
+template <class Record, std::size_t Capacity>
+class BatchFileWriter {
+public:
+    // Пачка в файле: prefix, записи через separator, suffix
+    struct Format {
+        std::function<void(std::string& out, const Record& r)> append;
+        std::string prefix;
+        std::string separator;
+        std::string suffix;
+        std::size_t max_batch = 1024;   // Не больше записей в пачке: ротация срабатывает и под непрерывной нагрузкой
+    };
+
+    BatchFileWriter(RotatingFile::Options options, std::chrono::milliseconds flush_interval)
+        : flush_interval_(flush_interval), file_(std::move(options)) {}
+
+    ~BatchFileWriter() { stop(); }
+
+    BatchFileWriter(const BatchFileWriter&) = delete;
+    BatchFileWriter& operator=(const BatchFileWriter&) = delete;
+
+    const RotatingFile::Options& options() const { return file_.options(); }
+
+    bool active() const { return active_.load(std::memory_order_relaxed); }
+    unsigned long long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Открывает файл и запускает поток записи. false — файл не открылся
+    bool start(Format format) {
+        if (writer_.joinable()) return true;
+        if (!file_.open()) return false;
+        format_ = std::move(format);
+        stopping_ = false;
+        active_ = true;
+        writer_ = std::thread(&BatchFileWriter::run, this);
+        return true;
+    }
+
+    // Поток дописывает остаток очереди перед выходом, затем файл закрывается
+    void stop() {
+        if (!writer_.joinable()) return;
+        active_ = false;
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        writer_.join();
+        file_.close();
+    }
+
+    // Из любого потока; не блокируется и не выделяет память. fill(Record&) заполняет ячейку на месте
+    template <class F>
+    bool push(F&& fill) {
+        const bool pushed = ring_.tryPush(std::forward<F>(fill));
+        if (!pushed) dropped_.fetch_add(1, std::memory_order_relaxed);
+        return pushed;
+    }
+
+private:
+    MpscRing<Record, Capacity> ring_;
+    std::atomic<bool> active_{ false };
+    std::atomic<unsigned long long> dropped_{ 0 };
+
+    std::thread writer_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    const std::chrono::milliseconds flush_interval_;
+
+    // Только поток записи
+    Format format_;
+    RotatingFile file_;
+
+    void run() {
+        std::string batch;
+        batch.reserve(256 * 1024);
+        for (;;) {
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                wake_.wait_for(lock, flush_interval_, [this] { return stopping_; });
+                stopping = stopping_;
+            }
+            // Пачка целиком — одна запись в файл
+            while (drain(batch) > 0) {
+                file_.write(batch);
+            }
+            file_.flush();
+            if (stopping) break;
+        }
+    }
+
+    std::size_t drain(std::string& batch) {
+        batch.clear();
+        batch += format_.prefix;
+        std::size_t count = 0;
+        while (count < format_.max_batch && ring_.tryPop([&](const Record& r) {
+            if (count > 0) batch += format_.separator;
+            format_.append(batch, r);
+        })) {
+            ++count;
+        }
+        batch += format_.suffix;
+        return count;
+    }
+};
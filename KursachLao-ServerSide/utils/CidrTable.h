@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include "AddressTable.h"
+
+#include <boost/asio/ip/address.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class CidrAction : std::uint8_t { None, Allow, Deny };
+
+// Списки allow/deny по подсетям IPv4/IPv6 с поиском самого длинного совпавшего префикса.
+// Бинарное дерево по битам 128-битного адреса; IPv4 лежит под ::ffff:0:0/96, как в ClientKey.
+// Узлы в одном векторе (индексы вместо указателей); заполняется при старте,
+// match() ничего не выделяет и проходит не больше 128 узлов.
+class CidrTable {
+public:
+    CidrTable() : nodes_(1) {}
+
+    // "10.0.0.0/8", "2001:db8::/32", "192.168.1.5" (без длины — один адрес).
+    // false и error — если строка не разбирается
+    bool add(std::string_view cidr, CidrAction action, std::string& error) {
+        const auto slash = cidr.find('/');
+        const std::string address_text(cidr.substr(0, slash));
+
+        boost::system::error_code ec;
+        const auto address = boost::asio::ip::make_address(address_text, ec);
+        if (ec) {
+            error = "Invalid address in '" + std::string(cidr) + "'";
+            return false;
+        }
+
+        const int max_len = address.is_v4() ? 32 : 128;
+        int prefix = max_len;
+        if (slash != std::string_view::npos) {
+            const std::string len_text(cidr.substr(slash + 1));
+            try {
+                size_t used = 0;
+                prefix = std::stoi(len_text, &used);
+                if (used != len_text.size()) prefix = -1;
+            }
+            catch (const std::exception&) {
+                prefix = -1;
+            }
+            if (prefix < 0 || prefix > max_len) {
+                error = "Invalid prefix length in '" + std::string(cidr) + "'";
+                return false;
+            }
+        }
+        if (address.is_v4()) prefix += 96;
+
+        insert(ClientKey::from(address), prefix, action);
+        return true;
+    }
+
+    // Действие самого длинного совпавшего префикса; None — адрес ни в одном списке
+    CidrAction match(const ClientKey& key) const {
+        CidrAction result = nodes_[0].action;
+        std::uint32_t node = 0;
+        for (int bit = 0; bit < 128; ++bit) {
+            node = nodes_[node].child[bitAt(key, bit)];
+            if (node == 0) break;
+            if (nodes_[node].action != CidrAction::None) result = nodes_[node].action;
+        }
+        return result;
+    }
+
+    bool empty() const { return nodes_.size() == 1 && nodes_[0].action == CidrAction::None; }
+
+private:
+    struct Node {
+        std::uint32_t child[2] = { 0, 0 };   // 0 — нет потомка (корень потомком не бывает)
+        CidrAction action = CidrAction::None;
+    };
+
+    std::vector<Node> nodes_;
+
+    static unsigned bitAt(const ClientKey& key, int bit) {
+        return (key.bytes[bit / 8] >> (7 - bit % 8)) & 1u;
+    }
+
+    void insert(const ClientKey& key, int prefix, CidrAction action) {
+        std::uint32_t node = 0;
+        for (int bit = 0; bit < prefix; ++bit) {
+            const unsigned b = bitAt(key, bit);
+            if (nodes_[node].child[b] == 0) {
+                nodes_[node].child[b] = static_cast<std::uint32_t>(nodes_.size());
+                nodes_.emplace_back();
+            }
+            node = nodes_[node].child[b];
+        }
+        nodes_[node].action = action;
+    }
+};
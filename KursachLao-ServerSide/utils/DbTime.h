@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include <chrono>
+
+// Время, проведённое текущим запросом в транзакциях БД (для журнала доступа).
+// Обработчики выполняются синхронно на потоке io_context, поэтому хватает thread_local счётчика:
+// RequestHandler обнуляет его перед вызовом обработчика и читает при отправке ответа.
+// Отложенные ответы (WriteBatcher) выставляют значение своей операции перед вызовом done().
+class DbTime {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static Clock::duration& current() {
+        thread_local Clock::duration elapsed{};
+        return elapsed;
+    }
+
+    static void reset() { current() = Clock::duration::zero(); }
+
+    // Добавляет к счётчику время жизни области (транзакция целиком)
+    class Scope {
+    public:
+        Scope() : start_(Clock::now()) {}
+        ~Scope() { current() += Clock::now() - start_; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        Clock::duration elapsed() const { return Clock::now() - start_; }
+
+    private:
+        Clock::time_point start_;
+    };
+};
@@ -1,21 +1,34 @@
 ﻿#pragma once
 
 #include "BaseModule.h"
+#include "AddressTable.h"
+#include "CidrTable.h"
+#include "RateLimit.h"
+#include "Metrics.h"
 #include <boost/asio.hpp>
-#include <unordered_map>
+#include <array>
 #include <chrono>
-#include <mutex>
-#include <thread>
-#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <vector>
 
 // Простой модуль для защиты от DoS-атак на основе rate limiting по IP.
 // Алгоритм:
-// 1. Отслеживаем количество запросов от каждого IP в скользящем окне времени (например, 1 минута).
-// 2. Если количество запросов превышает порог (threshold), IP блокируется на заданное время (ban_duration).
-// 3. Периодическая очистка старых записей для экономии памяти.
-// 4. Интеграция: модуль может быть вызван в обработчике входящих соединений (например, в accept handler Boost Asio).
-//    Перед обработкой запроса проверяем isAllowed(ip), если нет - закрываем соединение.
-// Масштабируемость: в будущем можно добавить Redis для распределенного хранения, или более сложные алгоритмы (token bucket).
+// 1. Соединения: у каждого IP свой token bucket (connection_limit_). Accept handler
+//    вызывает isAllowed(address) до создания сессии; если токенов нет — IP блокируется
+//    на ban_duration_, соединения с него сразу закрываются.
+// 2. Запросы: отдельный bucket на каждый класс маршрутов (статика, чтение API, запись API).
+//    RequestHandler вызывает admitRequest() на каждый запрос, в том числе внутри keep-alive;
+//    превышение — 429 с Retry-After, соединение остаётся открытым.
+// 3. Очистка старых записей по таймеру asio на потоке сервера, порциями: за один шаг
+//    проходится один шард AddressTable, полный круг — shardCount() * sweep_step_.
+//    Отдельного потока нет, остановка мгновенная (cancel таймера).
+// 4. Подсети: allow (мониторинг — без лимитов) и deny (сразу закрыть) через CidrTable.
+// 5. Одновременные соединения с одного IP: admitConnection() выдаёт ConnectionLease,
+//    сессия держит её до своего уничтожения.
+// Состояния лежат в AddressTable — ключ 16 байт адреса, шарды со своими mutex,
+// фиксированный объём памяти: проверка не аллоцирует и не берёт глобальную блокировку.
 
 class DoSProtectionModule : public BaseModule {
 private:
@@ -24,102 +37,259 @@ private:
     using Duration = Clock::duration;
 
     struct ClientInfo {
-        int request_count = 0;
-        TimePoint last_request;
+        TokenBucket connections;
+        std::array<TokenBucket, kRouteClassCount> requests;
+        TimePoint last_seen;
         TimePoint ban_until;
+        int open_connections = 0;
     };
+    using Clients = AddressTable<ClientInfo>;
 
-    std::unordered_map<std::string, ClientInfo> clients_; // IP -> info
-    std::mutex mutex_; // Для thread-safety
-    std::thread cleanup_thread_; // Для периодической очистки
-    std::atomic<bool> running_; // Флаг для остановки cleanup
+    // shared_ptr: аренды соединений могут пережить модуль (сессии в очереди io_context)
+    std::shared_ptr<Clients> clients_ = std::make_shared<Clients>();
+    CidrTable cidr_;
+    boost::asio::steady_timer sweep_timer_;
+    size_t next_shard_ = 0;     // Шард для следующего шага очистки
+    bool running_ = false;
 
-    // Настройки (можно вынести в конфиг в будущем)
-    const int max_requests_per_minute_ = 100; // Порог запросов в минуту
-    const Duration window_duration_ = std::chrono::minutes(1);
+    // Настройки (переопределяются из ServerConfig)
+    RateLimit connection_limit_{ 100.0 / 60, 100 };  // Около 100 соединений в минуту
+    int max_connections_per_ip_ = 32;                // 0 — без ограничения
+    std::array<RateLimit, kRouteClassCount> route_limits_{ {
+        { 50, 200 },   // static
+        { 20, 60 },    // api-read
+        { 5, 20 },     // api-write
+    } };
     const Duration ban_duration_ = std::chrono::minutes(5);
-    const Duration cleanup_interval_ = std::chrono::minutes(10);
-
-    void cleanupLoop() {
-        while (running_) {
-            {
-                std::lock_guard<std::mutex> lock(mutex_);
-                auto now = Clock::now();
-                for (auto it = clients_.begin(); it != clients_.end(); ) {
-                    if (now - it->second.last_request > cleanup_interval_) {
-                        it = clients_.erase(it);
-                    }
-                    else {
-                        ++it;
-                    }
-                }
+    const Duration idle_ttl_ = std::chrono::minutes(10);        // Запись без активности удаляется
+    const Duration sweep_step_ = std::chrono::seconds(2);       // Пауза между шардами
+
+    // Решения для /metrics: по исходу Admission и отказы в запросах по классу маршрута
+    std::array<Counter*, 4> admissions_{};
+    std::array<Counter*, kRouteClassCount> limited_requests_{};
+
+    void scheduleSweep() {
+        sweep_timer_.expires_after(sweep_step_);
+        sweep_timer_.async_wait([this](const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::operation_aborted || !running_) {
+                return;
             }
-            std::this_thread::sleep_for(cleanup_interval_);
-        }
+            sweepStep();
+            scheduleSweep();
+        });
+    }
+
+    // Запись без блокировки и открытых соединений: при вытеснении ничего не теряется,
+    // кроме запаса токенов
+    static auto evictableAt(TimePoint now) {
+        return [now](const ClientInfo& info) { return now >= info.ban_until && info.open_connections == 0; };
+    }
+
+    void sweepStep() {
+        const auto now = Clock::now();
+        const auto evictable = evictableAt(now);
+        clients_->eraseIf(next_shard_, 1, [&](const ClientKey&, const ClientInfo& info) {
+            return now - info.last_seen > idle_ttl_ && evictable(info);
+        });
+        next_shard_ = (next_shard_ + 1) % Clients::shardCount();
     }
 
 public:
-    DoSProtectionModule(const std::string& name = "DoSProtection", const int& id = -1)
-        : BaseModule(name, id), running_(false) {
+    explicit DoSProtectionModule(boost::asio::io_context& ioc,
+        const std::string& name = "DoSProtection", const int& id = -1)
+        : BaseModule(name, id), sweep_timer_(ioc) {
+        auto& metrics = MetricsRegistry::instance();
+        static constexpr const char* kResults[] = { "accepted", "denied", "rate_limited", "too_many_connections" };
+        for (size_t i = 0; i < admissions_.size(); ++i) {
+            admissions_[i] = &metrics.counter("dos_connections_total", "New connections by admission result",
+                MetricsRegistry::label("result", kResults[i]));
+        }
+        for (size_t i = 0; i < kRouteClassCount; ++i) {
+            limited_requests_[i] = &metrics.counter("dos_requests_limited_total", "Requests rejected with 429",
+                MetricsRegistry::label("class", routeClassName(static_cast<RouteClass>(i))));
+        }
     }
 
-    ~DoSProtectionModule() {
-        if (running_) {
-            running_ = false;
-            if (cleanup_thread_.joinable()) {
-                cleanup_thread_.join();
+    // Настройка до initialize() или на потоке io_context (admin API): проверки идут на нём же
+    void setConnectionLimit(const RateLimit& limit) { connection_limit_ = limit; }
+    void setRouteLimit(RouteClass rc, const RateLimit& limit) { route_limits_[static_cast<size_t>(rc)] = limit; }
+    void setMaxConnectionsPerIp(int max) { max_connections_per_ip_ = max; }
+    bool addCidrRule(std::string_view cidr, CidrAction action, std::string& error) { return cidr_.add(cidr, action, error); }
+
+    const RateLimit& connectionLimit() const { return connection_limit_; }
+    const RateLimit& routeLimit(RouteClass rc) const { return route_limits_[static_cast<size_t>(rc)]; }
+    int maxConnectionsPerIp() const { return max_connections_per_ip_; }
+
+    // Занятое соединение; при уничтожении счётчик адреса уменьшается. Пустая аренда ничего не считает
+    class ConnectionLease {
+    public:
+        ConnectionLease() = default;
+        ConnectionLease(std::weak_ptr<Clients> clients, const ClientKey& key)
+            : clients_(std::move(clients)), key_(key) {}
+
+        ConnectionLease(ConnectionLease&& other) noexcept
+            : clients_(std::move(other.clients_)), key_(other.key_) {
+            other.clients_.reset();
+        }
+
+        ConnectionLease& operator=(ConnectionLease&& other) noexcept {
+            if (this != &other) {
+                release();
+                clients_ = std::move(other.clients_);
+                key_ = other.key_;
+                other.clients_.reset();
             }
+            return *this;
         }
-    }
+
+        ConnectionLease(const ConnectionLease&) = delete;
+        ConnectionLease& operator=(const ConnectionLease&) = delete;
+
+        ~ConnectionLease() { release(); }
+
+    private:
+        std::weak_ptr<Clients> clients_;
+        ClientKey key_;
+
+        void release() {
+            if (auto clients = clients_.lock()) {
+                // Запись могла быть вытеснена — тогда считать уже нечего
+                clients->update(key_, [](ClientInfo& info) {
+                    if (info.open_connections > 0) --info.open_connections;
+                });
+            }
+            clients_.reset();
+        }
+    };
+
+    enum class Admission { Accepted, Denied, RateLimited, TooManyConnections };
 
 protected:
     bool onInitialize() override {
-        // Инициализация: запуск cleanup потока
         running_ = true;
-        cleanup_thread_ = std::thread(&DoSProtectionModule::cleanupLoop, this);
+        MetricsRegistry::instance().addCallback(MetricsRegistry::Type::Gauge, "dos_tracked_clients",
+            "Addresses with rate-limit state", {}, [this] { return static_cast<double>(trackedClients()); });
+        scheduleSweep();
         return true;
     }
 
     void onShutdown() override {
-        // Остановка cleanup потока
         running_ = false;
-        if (cleanup_thread_.joinable()) {
-            cleanup_thread_.join();
-        }
-        clients_.clear();
+        sweep_timer_.cancel();
+        clients_->clear();
     }
 
 public:
-    // Основной метод: проверить, разрешен ли запрос от этого IP
-    // Вызывать в обработчике соединений, перед обработкой запроса.
+    // Проверить, разрешено ли соединение с этого адреса.
+    // Вызывать в обработчике соединений, перед созданием сессии.
     // Возвращает true, если разрешено; false, если заблокировано.
+    bool isAllowed(const boost::asio::ip::address& address) {
+        ConnectionLease lease;
+        return admitConnection(address, lease) == Admission::Accepted;
+    }
+
+    // Полная проверка нового соединения: подсети, частота, число открытых.
+    // При Accepted lease занимает место адреса (для allow-подсетей остаётся пустой)
+    Admission admitConnection(const boost::asio::ip::address& address, ConnectionLease& lease) {
+        const Admission result = admit(address, lease);
+        admissions_[static_cast<size_t>(result)]->inc();
+        return result;
+    }
+
     bool isAllowed(const std::string& ip) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto now = Clock::now();
+        boost::system::error_code ec;
+        auto address = boost::asio::ip::make_address(ip, ec);
+        return ec ? false : isAllowed(address);
+    }
 
-        auto& info = clients_[ip];
+    // Проверить отдельный запрос. nullopt — можно обрабатывать;
+    // иначе — через сколько повторить (для Retry-After)
+    std::optional<Duration> admitRequest(const ClientKey& client, RouteClass rc) {
+        const auto& limit = route_limits_[static_cast<size_t>(rc)];
+        if (limit.unlimited() || cidr_.match(client) == CidrAction::Allow) return std::nullopt;
 
-        // Если забанен
-        if (now < info.ban_until) {
-            return false;
-        }
+        const auto now = Clock::now();
+        auto retry_after = clients_->access(client, [&](ClientInfo& info, bool) -> std::optional<Duration> {
+            info.last_seen = now;
+            Duration retry_after{};
+            if (info.requests[static_cast<size_t>(rc)].take(limit, now, retry_after)) {
+                return std::nullopt;
+            }
+            return retry_after;
+        }, evictableAt(now));
+        if (retry_after) limited_requests_[static_cast<size_t>(rc)]->inc();
+        return retry_after;
+    }
+
+    size_t trackedClients() const { return clients_->size(); }
 
-        // Обновляем счетчик
-        if (now - info.last_request > window_duration_) {
-            // Окно истекло, сброс
-            info.request_count = 1;
+    // Снимок состояния адреса для admin API
+    struct ClientState {
+        ClientKey key;
+        int open_connections = 0;
+        Duration idle{};
+        Duration banned_for{};      // Сколько осталось блокировки, 0 — не заблокирован
+    };
+
+    // Не больше limit записей: сначала заблокированные, потом по числу открытых соединений
+    std::vector<ClientState> listClients(size_t limit) const {
+        const auto now = Clock::now();
+        std::vector<ClientState> list;
+        clients_->forEach([&](const ClientKey& key, const ClientInfo& info) {
+            list.push_back({ key, info.open_connections, now - info.last_seen,
+                info.ban_until > now ? info.ban_until - now : Duration::zero() });
+        });
+        const auto order = [](const ClientState& a, const ClientState& b) {
+            if (a.banned_for != b.banned_for) return a.banned_for > b.banned_for;
+            if (a.open_connections != b.open_connections) return a.open_connections > b.open_connections;
+            return a.idle < b.idle;
+        };
+        if (list.size() > limit) {
+            std::partial_sort(list.begin(), list.begin() + static_cast<std::ptrdiff_t>(limit), list.end(), order);
+            list.resize(limit);
         }
         else {
-            ++info.request_count;
+            std::sort(list.begin(), list.end(), order);
         }
-        info.last_request = now;
+        return list;
+    }
+
+    // Снимает блокировку и возвращает адресу полный запас токенов. false — адрес не отслеживается
+    bool unban(const boost::asio::ip::address& address) {
+        return clients_->update(ClientKey::from(address), [](ClientInfo& info) {
+            info.ban_until = {};
+            info.connections = {};
+            info.requests = {};
+        });
+    }
 
-        // Проверяем порог
-        if (info.request_count > max_requests_per_minute_) {
-            info.ban_until = now + ban_duration_;
-            return false;
+private:
+    Admission admit(const boost::asio::ip::address& address, ConnectionLease& lease) {
+        const ClientKey key = ClientKey::from(address);
+        switch (cidr_.match(key)) {
+        case CidrAction::Allow: return Admission::Accepted;
+        case CidrAction::Deny: return Admission::Denied;
+        case CidrAction::None: break;
         }
 
-        return true;
+        const auto now = Clock::now();
+        return clients_->access(key, [&](ClientInfo& info, bool) {
+            // Активность отмечаем и у забаненного: иначе под вытеснением он выглядит давно ушедшим
+            info.last_seen = now;
+            // Если забанен
+            if (now < info.ban_until) {
+                return Admission::RateLimited;
+            }
+            if (max_connections_per_ip_ > 0 && info.open_connections >= max_connections_per_ip_) {
+                return Admission::TooManyConnections;
+            }
+            if (!info.connections.take(connection_limit_, now)) {
+                info.ban_until = now + ban_duration_;
+                return Admission::RateLimited;
+            }
+            ++info.open_connections;
+            lease = ConnectionLease(clients_, key);
+            return Admission::Accepted;
+        }, evictableAt(now));
     }
 };
\ No newline at end of file
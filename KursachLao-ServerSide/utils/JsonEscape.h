@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+
+// Экранирование строк для JSON, который собирается вручную (потоковые списки, журналы, трейсы).
+// Кавычки, обратная косая черта и управляющие символы; остальные байты (в том числе UTF-8) — как есть.
+
+// Содержимое строки без кавычек
+inline void appendJsonEscaped(std::string& out, std::string_view sv) {
+    static constexpr char hex[] = "0123456789abcdef";
+    for (char ch : sv) {
+        auto c = static_cast<unsigned char>(ch);
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xF];
+            }
+            else {
+                out += ch;
+            }
+        }
+    }
+}
+
+// Строка целиком, в кавычках
+inline void appendJsonString(std::string& out, std::string_view sv) {
+    out += '"';
+    appendJsonEscaped(out, sv);
+    out += '"';
+}
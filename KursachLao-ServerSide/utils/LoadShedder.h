@@ -0,0 +1,175 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+#include "RateLimit.h"
+#include "Metrics.h"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+#include <unordered_set>
+
+// Сброс нагрузки в духе CoDel. Два сигнала перегрузки:
+// 1. Задержка цикла событий: таймер раз в probe_interval_ сравнивает, насколько позже
+//    срока он сработал (сколько ждала очередь io_context).
+// 2. Время выполнения запросов (от прочтения до ответа), которое сообщает RequestHandler.
+// Как в CoDel, смотрим минимум за окно interval_: разовые всплески не считаются,
+// перегрузка — когда даже лучший показатель окна выше цели. Окно судится только после
+// min_probes_ проб: одна долгая блокировка даёт одну пробу, и окно продлевается, пока
+// не наберётся минимум по нескольким.
+// Пока перегрузка держится, уровень растёт и отсекаются всё более важные запросы (503):
+//   1 — Low (например, полная перезагрузка /api/all-data),
+//   2 — Normal (остальные чтения API),
+//   3 — High (запись и статика) — только при затяжной перегрузке.
+// Каждое окно без перегрузки снижает уровень на единицу.
+
+enum class ShedPriority : std::size_t { Low, Normal, High };
+constexpr std::size_t kShedPriorityCount = 3;
+
+class LoadShedder : public BaseModule {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = Clock::duration;
+
+    struct Stats {
+        int level = 0;
+        Duration last_min_lag{};
+        Duration last_min_latency{};
+        std::array<unsigned long long, kShedPriorityCount> shed{};   // Сколько отсечено по приоритетам
+        unsigned long long congested_intervals = 0;
+    };
+
+    explicit LoadShedder(boost::asio::io_context& ioc,
+        const std::string& name = "LoadShedder", const int& id = -1)
+        : BaseModule(name, id), probe_timer_(ioc) {
+    }
+
+    // Цели задержки; нулевая цель отключает соответствующий сигнал
+    void setTargets(Duration lag_target, Duration latency_target) {
+        lag_target_ = lag_target;
+        latency_target_ = latency_target;
+    }
+
+    void addLowPriorityPath(const std::string& path) { low_priority_paths_.insert(path); }
+
+    ShedPriority priorityOf(const std::string& path, RouteClass route_class) const {
+        if (low_priority_paths_.count(path)) return ShedPriority::Low;
+        return route_class == RouteClass::ApiRead ? ShedPriority::Normal : ShedPriority::High;
+    }
+
+    // true — запрос нужно отклонить с 503
+    bool shouldShed(ShedPriority priority) {
+        if (static_cast<int>(priority) >= stats_.level) return false;
+        ++stats_.shed[static_cast<size_t>(priority)];
+        return true;
+    }
+
+    void recordLatency(Duration latency) {
+        if (!window_has_latency_ || latency < window_min_latency_) window_min_latency_ = latency;
+        window_has_latency_ = true;
+    }
+
+    const Stats& stats() const { return stats_; }
+
+protected:
+    bool onInitialize() override {
+        running_ = true;
+        registerMetrics();
+        window_start_ = Clock::now();
+        window_min_lag_ = Duration::max();
+        window_probes_ = 0;
+        scheduleProbe();
+        return true;
+    }
+
+    void onShutdown() override {
+        running_ = false;
+        probe_timer_.cancel();
+    }
+
+private:
+    // Решения читаются из stats() в момент выдачи /metrics
+    void registerMetrics() {
+        using Type = MetricsRegistry::Type;
+        auto& metrics = MetricsRegistry::instance();
+        metrics.addCallback(Type::Gauge, "load_shedding_level", "Current shedding level (0 = off, 3 = all priorities)", {},
+            [this] { return static_cast<double>(stats_.level); });
+        metrics.addCallback(Type::Counter, "load_shedding_congested_intervals_total",
+            "Intervals where the minimum lag or latency exceeded the target", {},
+            [this] { return static_cast<double>(stats_.congested_intervals); });
+        static constexpr const char* kPriorities[] = { "low", "normal", "high" };
+        for (std::size_t i = 0; i < kShedPriorityCount; ++i) {
+            metrics.addCallback(Type::Counter, "load_shed_requests_total", "Requests rejected with 503",
+                MetricsRegistry::label("priority", kPriorities[i]), [this, i] { return static_cast<double>(stats_.shed[i]); });
+        }
+    }
+
+    static constexpr int kMaxLevel = 3;
+    // Сколько окон подряд с перегрузкой нужно для уровня 1, 2, 3
+    static constexpr std::array<unsigned, kMaxLevel> kWindowsForLevel = { 1, 5, 20 };
+
+    boost::asio::steady_timer probe_timer_;
+    bool running_ = false;
+
+    Duration lag_target_ = std::chrono::milliseconds(20);
+    Duration latency_target_ = std::chrono::milliseconds(200);
+    const Duration probe_interval_ = std::chrono::milliseconds(10);
+    const Duration interval_ = std::chrono::milliseconds(100);
+    // Меньше проб в окне — о минимуме судить рано (половина от interval_ / probe_interval_)
+    const unsigned min_probes_ = static_cast<unsigned>(std::max<Duration::rep>(1, interval_ / probe_interval_ / 2));
+
+    std::unordered_set<std::string> low_priority_paths_;
+
+    Clock::time_point window_start_{};
+    Duration window_min_lag_ = Duration::max();
+    unsigned window_probes_ = 0;
+    Duration window_min_latency_{};
+    bool window_has_latency_ = false;
+    unsigned congested_run_ = 0;
+    Stats stats_;
+
+    void scheduleProbe() {
+        const auto deadline = Clock::now() + probe_interval_;
+        probe_timer_.expires_at(deadline);
+        probe_timer_.async_wait([this, deadline](const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::operation_aborted || !running_) {
+                return;
+            }
+            const auto now = Clock::now();
+            window_min_lag_ = std::min(window_min_lag_, std::max(Duration::zero(), now - deadline));
+            ++window_probes_;
+            // Проб мало — окно ещё ничего не говорит: не растим уровень и не сбрасываем серию, а продлеваем
+            if (now - window_start_ >= interval_ && window_probes_ >= min_probes_) {
+                closeWindow(now);
+            }
+            scheduleProbe();
+        });
+    }
+
+    void closeWindow(Clock::time_point now) {
+        const bool lag_high = lag_target_ > Duration::zero() && window_min_lag_ > lag_target_;
+        const bool latency_high = latency_target_ > Duration::zero() && window_has_latency_
+            && window_min_latency_ > latency_target_;
+
+        stats_.last_min_lag = window_min_lag_;
+        stats_.last_min_latency = window_has_latency_ ? window_min_latency_ : Duration::zero();
+
+        if (lag_high || latency_high) {
+            ++stats_.congested_intervals;
+            ++congested_run_;
+            int level = 0;
+            while (level < kMaxLevel && congested_run_ >= kWindowsForLevel[level]) ++level;
+            stats_.level = std::max(stats_.level, level);
+        }
+        else {
+            congested_run_ = 0;
+            stats_.level = std::max(0, stats_.level - 1);
+        }
+
+        window_start_ = now;
+        window_min_lag_ = Duration::max();
+        window_probes_ = 0;
+        window_has_latency_ = false;
+    }
+};
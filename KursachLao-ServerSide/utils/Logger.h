@@ -0,0 +1,214 @@
+﻿#pragma once
+
+#include "MpscRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Асинхронный логгер. Поток запроса форматирует строку в буфер на стеке и кладёт её
+// в lock-free кольцо (MpscRing); в консоль пишет отдельный поток пачками, без flush на строку.
+// Если кольцо полно, строка отбрасывается (счётчик dropped) — логгер никогда не блокирует вызывающего.
+//
+// Уровни отсекаются дважды:
+// - при сборке: LOG_COMPILE_LEVEL (0 debug .. 3 error), вызовы ниже него не попадают в код;
+// - при запуске: Logger::instance().setLevel() (--log-level).
+//
+//   LOG_INFO("Client connected from " << address << ":" << port);
+
+enum class LogLevel : int { Debug = 0, Info = 1, Warn = 2, Error = 3 };
+
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL 1
+#else
+#define LOG_COMPILE_LEVEL 0
+#endif
+#endif
+
+class Logger {
+public:
+    static constexpr std::size_t kMaxLine = 240;
+
+    struct Record {
+        LogLevel level = LogLevel::Info;
+        std::chrono::system_clock::time_point time{};
+        std::uint16_t size = 0;
+        char text[kMaxLine];
+    };
+
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    void setLevel(LogLevel level) { level_.store(static_cast<int>(level), std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return static_cast<int>(level) >= level_.load(std::memory_order_relaxed); }
+
+    void write(LogLevel level, std::string_view text) {
+        const bool pushed = ring_.tryPush([&](Record& r) {
+            r.level = level;
+            r.time = std::chrono::system_clock::now();
+            r.size = static_cast<std::uint16_t>(std::min(text.size(), kMaxLine));
+            std::memcpy(r.text, text.data(), r.size);
+        });
+        if (!pushed) dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    unsigned long long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static std::string_view levelName(LogLevel level) {
+        switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warn: return "WARN";
+        case LogLevel::Error: return "ERROR";
+        }
+        return "?";
+    }
+
+    static bool parseLevel(std::string_view name, LogLevel& out) {
+        for (auto level : { LogLevel::Debug, LogLevel::Info, LogLevel::Warn, LogLevel::Error }) {
+            std::string_view n = levelName(level);
+            if (name.size() == n.size() && std::equal(n.begin(), n.end(), name.begin(),
+                [](char a, char b) { return a == std::toupper(static_cast<unsigned char>(b)); })) {
+                out = level;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Останавливает поток записи, дописав всё, что уже в очереди (при остановке сервера).
+    // Читатель у кольца один — сам поток записи, поэтому здесь только join
+    void shutdown() {
+        running_ = false;
+        if (writer_.joinable()) writer_.join();
+    }
+
+private:
+    MpscRing<Record, 8192> ring_;
+    std::atomic<int> level_{ LOG_COMPILE_LEVEL };
+    std::atomic<unsigned long long> dropped_{ 0 };
+    unsigned long long dropped_reported_ = 0;
+    std::atomic<bool> running_{ true };
+    std::thread writer_;
+
+    Logger() : writer_([this] { run(); }) {}
+
+    ~Logger() {
+        shutdown();
+    }
+
+    void run() {
+        std::string out, err;
+        out.reserve(64 * 1024);
+        err.reserve(16 * 1024);
+        while (running_.load(std::memory_order_relaxed)) {
+            if (!drain(out, err)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+        drain(out, err);
+    }
+
+    // Одна пачка: всё, что есть в кольце, одним fwrite на поток вывода. false — было пусто
+    bool drain(std::string& out, std::string& err) {
+        out.clear();
+        err.clear();
+        bool any = false;
+        while (ring_.tryPop([&](Record& r) {
+            std::string& dst = r.level >= LogLevel::Warn ? err : out;
+            appendPrefix(dst, r.time, r.level);
+            dst.append(r.text, r.size);
+            dst += '\n';
+        })) {
+            any = true;
+        }
+
+        const auto dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != dropped_reported_) {
+            appendPrefix(err, std::chrono::system_clock::now(), LogLevel::Warn);
+            err += "Logger: " + std::to_string(dropped - dropped_reported_) + " lines dropped (queue full)\n";
+            dropped_reported_ = dropped;
+        }
+
+        if (!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+        }
+        if (!err.empty()) {
+            std::fwrite(err.data(), 1, err.size(), stderr);
+            std::fflush(stderr);
+        }
+        return any;
+    }
+
+    static void appendPrefix(std::string& dst, std::chrono::system_clock::time_point time, LogLevel level) {
+        const auto t = std::chrono::system_clock::to_time_t(time);
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000;
+        std::tm tm{};
+#ifdef _WIN32
+        localtime_s(&tm, &t);
+#else
+        localtime_r(&t, &tm);
+#endif
+        char buf[48];
+        const int n = std::snprintf(buf, sizeof buf, "%04d-%02d-%02d %02d:%02d:%02d.%03d [%s] ",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+            static_cast<int>(ms), levelName(level).data());
+        dst.append(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+    }
+};
+
+// Строка лога на стеке: ostream поверх фиксированного буфера, длинное обрезается.
+// В деструкторе уходит в очередь логгера
+class LogLine {
+public:
+    explicit LogLine(LogLevel level) : level_(level), buf_(data_, sizeof data_), stream_(&buf_) {}
+    ~LogLine() { Logger::instance().write(level_, std::string_view(data_, buf_.size())); }
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    std::ostream& stream() { return stream_; }
+
+private:
+    class FixedBuf : public std::streambuf {
+    public:
+        FixedBuf(char* data, std::size_t size) { setp(data, data + size); }
+        std::size_t size() const { return static_cast<std::size_t>(pptr() - pbase()); }
+    protected:
+        int_type overflow(int_type) override { return traits_type::eof(); }
+    };
+
+    LogLevel level_;
+    char data_[Logger::kMaxLine];
+    FixedBuf buf_;
+    std::ostream stream_;
+};
+
+#define LOG_AT(level, expr)                                              \
+    do {                                                                 \
+        if constexpr (static_cast<int>(level) >= LOG_COMPILE_LEVEL) {    \
+            if (Logger::instance().enabled(level)) {                     \
+                LogLine log_line_(level);                                \
+                log_line_.stream() << expr;                              \
+            }                                                            \
+        }                                                                \
+    } while (0)
+
+#define LOG_DEBUG(expr) LOG_AT(LogLevel::Debug, expr)
+#define LOG_INFO(expr) LOG_AT(LogLevel::Info, expr)
+#define LOG_WARN(expr) LOG_AT(LogLevel::Warn, expr)
+#define LOG_ERROR(expr) LOG_AT(LogLevel::Error, expr)
@@ -0,0 +1,287 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Метрики в формате Prometheus (text 0.0.4), отдаются по /metrics.
+// Счётчики и гистограммы — атомики с relaxed-порядком: запись на горячем пути без блокировок.
+// Реестр блокируется только при регистрации (до старта или один раз на маршрут) и при выдаче /metrics.
+// Модули берут ссылки на свои метрики заранее и дальше обращаются к ним напрямую:
+//
+//   static Counter& hits = MetricsRegistry::instance().counter("filecache_hits_total", "Cache hits");
+//   hits.inc();
+//
+// Значения, которые и так хранит модуль (размер кэша, число клиентов), не дублируются —
+// их читает колбэк в момент выдачи (addCallback).
+
+class Counter {
+public:
+    void inc(std::uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> value_{ 0 };
+};
+
+class Gauge {
+public:
+    void set(std::int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(std::int64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    void sub(std::int64_t n = 1) { value_.fetch_sub(n, std::memory_order_relaxed); }
+    std::int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> value_{ 0 };
+};
+
+// Лог-линейная гистограмма задержек в микросекундах (как HDR с низкой точностью):
+// каждая октава [2^k, 2^(k+1)) делится на kSubBuckets равных частей, ошибка — не больше 1/kSubBuckets.
+// Границы: 1, 2, 3, 4, 6, 8, 12, 16, 24 ... мкс, последняя — 2^kOctaves мкс (~67 с); больше — в +Inf.
+// Запись — один fetch_add по индексу, вычисленному через bit_width
+class LatencyHistogram {
+public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    static constexpr unsigned kSubBuckets = 2;
+    static constexpr unsigned kSubBits = std::bit_width(kSubBuckets) - 1;
+    static constexpr unsigned kOctaves = 26;
+    static constexpr std::size_t kBuckets = kSubBuckets + (kOctaves - kSubBits) * kSubBuckets;   // Без переполнения
+
+    void record(Duration d) {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        recordMicros(us > 0 ? static_cast<std::uint64_t>(us) : 0);
+    }
+
+    void recordMicros(std::uint64_t us) {
+        buckets_[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+        sum_us_.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    // Верхняя (не включая) граница корзины в микросекундах
+    static constexpr std::uint64_t upperBound(std::size_t index) {
+        if (index < kSubBuckets) return index + 1;
+        const std::size_t octave = (index - kSubBuckets) / kSubBuckets + kSubBits;
+        const std::size_t sub = (index - kSubBuckets) % kSubBuckets;
+        const std::uint64_t width = std::uint64_t{ 1 } << (octave - kSubBits);
+        return (kSubBuckets + sub + 1) * width;
+    }
+
+    static constexpr std::size_t bucketOf(std::uint64_t us) {
+        if (us < kSubBuckets) return static_cast<std::size_t>(us);
+        const unsigned octave = static_cast<unsigned>(std::bit_width(us)) - 1;   // >= kSubBits
+        if (octave >= kOctaves) return kBuckets;                                // Переполнение
+        const std::size_t sub = static_cast<std::size_t>(us >> (octave - kSubBits)) & (kSubBuckets - 1);
+        return kSubBuckets + (octave - kSubBits) * kSubBuckets + sub;
+    }
+
+    std::uint64_t bucket(std::size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+    std::uint64_t sumMicros() const { return sum_us_.load(std::memory_order_relaxed); }
+
+    std::uint64_t count() const {
+        std::uint64_t total = 0;
+        for (const auto& b : buckets_) total += b.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // Верхняя граница корзины, в которую попал q-квантиль (0..1); 0 — если записей нет
+    std::uint64_t percentileMicros(double q) const {
+        const std::uint64_t total = count();
+        if (total == 0) return 0;
+        const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += bucket(i);
+            if (seen >= rank) return upperBound(i);
+        }
+        return upperBound(kBuckets - 1);
+    }
+
+private:
+    static_assert((kSubBuckets & (kSubBuckets - 1)) == 0, "kSubBuckets must be a power of two");
+
+    std::array<std::atomic<std::uint64_t>, kBuckets + 1> buckets_{};
+    std::atomic<std::uint64_t> sum_us_{ 0 };
+};
+
+class MetricsRegistry {
+public:
+    enum class Type { Counter, Gauge, Histogram };
+
+    static MetricsRegistry& instance() {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // labels — готовая строка без скобок: label("route", r) + "," + label("code", "2xx").
+    // Повторная регистрация того же имени и меток возвращает ту же метрику
+    Counter& counter(std::string_view name, std::string_view help, std::string_view labels = {}) {
+        return *series(name, help, Type::Counter, labels).counter;
+    }
+
+    Gauge& gauge(std::string_view name, std::string_view help, std::string_view labels = {}) {
+        return *series(name, help, Type::Gauge, labels).gauge;
+    }
+
+    LatencyHistogram& histogram(std::string_view name, std::string_view help, std::string_view labels = {}) {
+        return *series(name, help, Type::Histogram, labels).histogram;
+    }
+
+    // Значение читается при каждой выдаче /metrics (на потоке сервера).
+    // Объект, захваченный в read, должен жить, пока сервер отвечает на запросы
+    void addCallback(Type type, std::string_view name, std::string_view help, std::string_view labels,
+        std::function<double()> read) {
+        if (type == Type::Histogram) throw std::logic_error("Metrics: histogram callbacks are not supported");
+        series(name, help, type, labels).read = std::move(read);
+    }
+
+    // key="value" с экранированием по правилам формата (в шаблонах маршрутов есть обратные слэши)
+    static std::string label(std::string_view key, std::string_view value) {
+        std::string out(key);
+        out += "=\"";
+        for (char ch : value) {
+            if (ch == '\\' || ch == '"') {
+                out += '\\';
+                out += ch;
+            }
+            else if (ch == '\n') {
+                out += "\\n";
+            }
+            else {
+                out += ch;
+            }
+        }
+        out += '"';
+        return out;
+    }
+
+    std::string render() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string out;
+        out.reserve(32 * 1024);
+        for (const auto& family : families_) {
+            out += "# HELP " + family->name + " " + family->help + "\n";
+            out += "# TYPE " + family->name + " " + typeName(family->type) + "\n";
+            for (const auto& s : family->series) {
+                if (family->type == Type::Histogram) {
+                    renderHistogram(out, family->name, s->labels, *s->histogram);
+                    continue;
+                }
+                double value = 0;
+                if (s->read) value = s->read();
+                else if (s->counter) value = static_cast<double>(s->counter->value());
+                else value = static_cast<double>(s->gauge->value());
+                appendSample(out, family->name, s->labels, {}, value);
+            }
+        }
+        return out;
+    }
+
+private:
+    struct Series {
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<LatencyHistogram> histogram;
+        std::function<double()> read;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<std::unique_ptr<Series>> series;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Family>> families_;
+
+    MetricsRegistry() = default;
+
+    Series& series(std::string_view name, std::string_view help, Type type, std::string_view labels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Family* family = nullptr;
+        for (auto& f : families_) {
+            if (f->name == name) {
+                family = f.get();
+                break;
+            }
+        }
+        if (!family) {
+            families_.push_back(std::make_unique<Family>(Family{ std::string(name), std::string(help), type, {} }));
+            family = families_.back().get();
+        }
+        else if (family->type != type) {
+            throw std::logic_error("Metrics: " + std::string(name) + " registered with another type");
+        }
+
+        for (auto& s : family->series) {
+            if (s->labels == labels) return *s;
+        }
+        auto s = std::make_unique<Series>();
+        s->labels = std::string(labels);
+        switch (type) {
+        case Type::Counter: s->counter = std::make_unique<Counter>(); break;
+        case Type::Gauge: s->gauge = std::make_unique<Gauge>(); break;
+        case Type::Histogram: s->histogram = std::make_unique<LatencyHistogram>(); break;
+        }
+        family->series.push_back(std::move(s));
+        return *family->series.back();
+    }
+
+    static const char* typeName(Type type) {
+        switch (type) {
+        case Type::Counter: return "counter";
+        case Type::Gauge: return "gauge";
+        case Type::Histogram: return "histogram";
+        }
+        return "untyped";
+    }
+
+    static void appendSample(std::string& out, std::string_view name, std::string_view labels,
+        std::string_view extra_label, double value) {
+        out += name;
+        if (!labels.empty() || !extra_label.empty()) {
+            out += '{';
+            out += labels;
+            if (!labels.empty() && !extra_label.empty()) out += ',';
+            out += extra_label;
+            out += '}';
+        }
+        // Целые (счётчики, корзины) — без экспоненты, остальное — 9 значащих цифр
+        char buf[40];
+        const bool integral = value == static_cast<double>(static_cast<std::int64_t>(value)) && value < 1e15 && value > -1e15;
+        std::snprintf(buf, sizeof buf, integral ? " %.0f\n" : " %.9g\n", value);
+        out += buf;
+    }
+
+    // Корзины накопительные; _count равен +Inf, поэтому считается из тех же корзин
+    static void renderHistogram(std::string& out, const std::string& name, const std::string& labels,
+        const LatencyHistogram& h) {
+        const std::string bucket_name = name + "_bucket";
+        std::uint64_t cumulative = 0;
+        char le[48];
+        for (std::size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+            cumulative += h.bucket(i);
+            std::snprintf(le, sizeof le, "le=\"%.9g\"", static_cast<double>(LatencyHistogram::upperBound(i)) / 1e6);
+            appendSample(out, bucket_name, labels, le, static_cast<double>(cumulative));
+        }
+        cumulative += h.bucket(LatencyHistogram::kBuckets);
+        appendSample(out, bucket_name, labels, "le=\"+Inf\"", static_cast<double>(cumulative));
+        appendSample(out, name + "_sum", labels, {}, static_cast<double>(h.sumMicros()) / 1e6);
+        appendSample(out, name + "_count", labels, {}, static_cast<double>(cumulative));
+    }
+};
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Ограниченная lock-free очередь: много писателей, один читатель (схема Вьюкова).
+// У каждой ячейки свой номер последовательности: писатель занимает позицию CAS-ом по head_,
+// заполняет ячейку на месте и публикует её номером pos + 1; читатель освобождает — pos + Capacity.
+// Память выделяется один раз; если очередь полна, tryPush сразу возвращает false.
+template <class T, std::size_t Capacity>
+class MpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpscRing() : cells_(std::make_unique<Cell[]>(Capacity)) {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // fill(T&) заполняет ячейку прямо в очереди, без промежуточной копии
+    template <class F>
+    bool tryPush(F&& fill) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & kMask];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    fill(cell.value);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;  // Полна: читатель ещё не освободил ячейку
+            }
+            else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Только из потока-читателя. consume(T&) вызывается на месте
+    template <class F>
+    bool tryPop(F&& consume) {
+        Cell& cell = cells_[tail_ & kMask];
+        const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(tail_ + 1) < 0) {
+            return false;
+        }
+        consume(cell.value);
+        cell.seq.store(tail_ + Capacity, std::memory_order_release);
+        ++tail_;
+        return true;
+    }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    static constexpr std::size_t kMask = Capacity - 1;
+
+    struct Cell {
+        std::atomic<std::size_t> seq{ 0 };
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<std::size_t> head_{ 0 };   // Писатели
+    alignas(64) std::size_t tail_ = 0;                  // Читатель
+};
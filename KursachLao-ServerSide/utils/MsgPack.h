@@ -0,0 +1,129 @@
+﻿#pragma once
+
+#include <boost/json.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+
+// Кодирование boost::json::value в MessagePack (https://msgpack.org/).
+// Числа — в самой короткой форме: целые через fixint/int8..int64,
+// дробные с целым значением — как целые, остальные — float32, если он точен, иначе float64.
+namespace msgpack {
+
+    inline void putBigEndian(std::string& out, std::uint64_t v, int bytes) {
+        for (int i = bytes - 1; i >= 0; --i) {
+            out += static_cast<char>((v >> (i * 8)) & 0xFF);
+        }
+    }
+
+    inline void encodeInt(std::string& out, std::int64_t v) {
+        if (v >= 0) {
+            if (v <= 0x7F) { out += static_cast<char>(v); return; }                              // positive fixint
+            if (v <= 0xFF) { out += '\xCC'; putBigEndian(out, v, 1); return; }                  // uint8
+            if (v <= 0xFFFF) { out += '\xCD'; putBigEndian(out, v, 2); return; }                // uint16
+            if (v <= 0xFFFFFFFFLL) { out += '\xCE'; putBigEndian(out, v, 4); return; }          // uint32
+            out += '\xCF'; putBigEndian(out, static_cast<std::uint64_t>(v), 8);                 // uint64
+            return;
+        }
+        if (v >= -32) { out += static_cast<char>(v); return; }                                  // negative fixint
+        auto u = static_cast<std::uint64_t>(v);
+        if (v >= std::numeric_limits<std::int8_t>::min()) { out += '\xD0'; putBigEndian(out, u, 1); return; }
+        if (v >= std::numeric_limits<std::int16_t>::min()) { out += '\xD1'; putBigEndian(out, u, 2); return; }
+        if (v >= std::numeric_limits<std::int32_t>::min()) { out += '\xD2'; putBigEndian(out, u, 4); return; }
+        out += '\xD3'; putBigEndian(out, u, 8);
+    }
+
+    inline void encodeUint(std::string& out, std::uint64_t v) {
+        if (v <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+            return encodeInt(out, static_cast<std::int64_t>(v));
+        }
+        out += '\xCF';
+        putBigEndian(out, v, 8);
+    }
+
+    inline void encodeDouble(std::string& out, double d) {
+        // 2^53 — дальше не каждое целое представимо в double, оставляем как есть
+        constexpr double kExactIntLimit = 9007199254740992.0;
+        if (std::isfinite(d) && std::trunc(d) == d && std::fabs(d) <= kExactIntLimit) {
+            return encodeInt(out, static_cast<std::int64_t>(d));
+        }
+        auto f = static_cast<float>(d);
+        if (static_cast<double>(f) == d || std::isnan(d)) {
+            std::uint32_t bits;
+            std::memcpy(&bits, &f, sizeof bits);
+            out += '\xCA';
+            putBigEndian(out, bits, 4);
+            return;
+        }
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof bits);
+        out += '\xCB';
+        putBigEndian(out, bits, 8);
+    }
+
+    inline void encodeString(std::string& out, std::string_view s) {
+        auto n = s.size();
+        if (n <= 31) out += static_cast<char>(0xA0 | n);
+        else if (n <= 0xFF) { out += '\xD9'; putBigEndian(out, n, 1); }
+        else if (n <= 0xFFFF) { out += '\xDA'; putBigEndian(out, n, 2); }
+        else { out += '\xDB'; putBigEndian(out, n, 4); }
+        out.append(s.data(), n);
+    }
+
+    inline void encodeContainerHeader(std::string& out, std::size_t n, char fix, char c16, char c32) {
+        if (n <= 15) out += static_cast<char>(static_cast<unsigned char>(fix) | n);
+        else if (n <= 0xFFFF) { out += c16; putBigEndian(out, n, 2); }
+        else { out += c32; putBigEndian(out, n, 4); }
+    }
+
+    inline void encode(std::string& out, const boost::json::value& jv) {
+        switch (jv.kind()) {
+        case boost::json::kind::null:
+            out += '\xC0';
+            break;
+        case boost::json::kind::bool_:
+            out += jv.get_bool() ? '\xC3' : '\xC2';
+            break;
+        case boost::json::kind::int64:
+            encodeInt(out, jv.get_int64());
+            break;
+        case boost::json::kind::uint64:
+            encodeUint(out, jv.get_uint64());
+            break;
+        case boost::json::kind::double_:
+            encodeDouble(out, jv.get_double());
+            break;
+        case boost::json::kind::string: {
+            const auto& s = jv.get_string();
+            encodeString(out, std::string_view(s.data(), s.size()));
+            break;
+        }
+        case boost::json::kind::array: {
+            const auto& arr = jv.get_array();
+            encodeContainerHeader(out, arr.size(), '\x90', '\xDC', '\xDD');
+            for (const auto& item : arr) encode(out, item);
+            break;
+        }
+        case boost::json::kind::object: {
+            const auto& obj = jv.get_object();
+            encodeContainerHeader(out, obj.size(), '\x80', '\xDE', '\xDF');
+            for (const auto& kv : obj) {
+                encodeString(out, std::string_view(kv.key().data(), kv.key().size()));
+                encode(out, kv.value());
+            }
+            break;
+        }
+        }
+    }
+
+    inline std::string encode(const boost::json::value& jv) {
+        std::string out;
+        out.reserve(256);
+        encode(out, jv);
+        return out;
+    }
+}
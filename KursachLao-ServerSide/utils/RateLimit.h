@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+
+// Лимит token bucket: per_second токенов в секунду, не больше burst в запасе.
+// per_second <= 0 — без ограничений.
+struct RateLimit {
+    double per_second = 0;
+    double burst = 0;
+
+    bool unlimited() const { return per_second <= 0; }
+
+    // Формат "rate:burst" (например "20:60") или просто "rate" (burst = rate)
+    static std::optional<RateLimit> parse(const std::string& text) {
+        try {
+            size_t used = 0;
+            RateLimit limit;
+            limit.per_second = std::stod(text, &used);
+            limit.burst = limit.per_second;
+            if (used < text.size()) {
+                if (text[used] != ':') return std::nullopt;
+                const std::string rest = text.substr(used + 1);
+                limit.burst = std::stod(rest, &used);
+                if (used != rest.size()) return std::nullopt;
+            }
+            if (limit.per_second < 0 || limit.burst < (limit.unlimited() ? 0 : 1)) return std::nullopt;
+            return limit;
+        }
+        catch (const std::exception&) {
+            return std::nullopt;
+        }
+    }
+};
+
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Забирает один токен. Если токенов нет — false и retry_after: когда появится следующий
+    bool take(const RateLimit& limit, Clock::time_point now, Clock::duration& retry_after) {
+        if (limit.unlimited()) return true;
+
+        if (!started_) {
+            tokens_ = limit.burst;
+            started_ = true;
+        }
+        else {
+            const double elapsed = std::chrono::duration<double>(now - refilled_).count();
+            tokens_ = std::min(limit.burst, tokens_ + std::max(0.0, elapsed) * limit.per_second);
+        }
+        refilled_ = now;
+
+        if (tokens_ < 1.0) {
+            retry_after = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>((1.0 - tokens_) / limit.per_second));
+            return false;
+        }
+        tokens_ -= 1.0;
+        return true;
+    }
+
+    bool take(const RateLimit& limit, Clock::time_point now) {
+        Clock::duration ignored{};
+        return take(limit, now, ignored);
+    }
+
+private:
+    double tokens_ = 0;
+    Clock::time_point refilled_{};
+    bool started_ = false;  // Первый запрос получает полный запас
+};
+
+// Классы маршрутов со своими лимитами запросов
+enum class RouteClass : std::size_t { Static, ApiRead, ApiWrite };
+constexpr std::size_t kRouteClassCount = 3;
+
+inline const char* routeClassName(RouteClass rc) {
+    switch (rc) {
+    case RouteClass::Static: return "static";
+    case RouteClass::ApiRead: return "api-read";
+    case RouteClass::ApiWrite: return "api-write";
+    }
+    return "unknown";
+}
@@ -0,0 +1,145 @@
+﻿#pragma once
+
+#include <boost/json/storage_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+// Арена на время одного запроса (по одной на сессию).
+// Из неё берут память поля заголовков beast, буфер тела запроса и JSON-деревья
+// (через storage_ptr). Освобождение отдельных блоков — пустая операция,
+// reset() между keep-alive запросами просто возвращает указатель в начало.
+// Если запрос не уместился в блок, при reset() блоки сливаются в один большой —
+// следующий такой же запрос обойдётся без malloc.
+class RequestArena : public boost::json::memory_resource {
+public:
+    explicit RequestArena(std::size_t initial_size = 16 * 1024,
+        std::size_t max_retained = 1024 * 1024)
+        : max_retained_(std::max(initial_size, max_retained)) {
+        pushBlock(initial_size);
+    }
+
+    ~RequestArena() override {
+        releaseBlocks();
+    }
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    void* take(std::size_t size, std::size_t align) {
+        auto p = alignUp(ptr_, align);
+        if (p + size > end_) {
+            // Новый блок хотя бы вдвое больше предыдущего, чтобы число блоков росло логарифмически
+            pushBlock(std::max(size + align, head_->size * 2));
+            p = alignUp(ptr_, align);
+        }
+        ptr_ = p + size;
+        return reinterpret_cast<void*>(p);
+    }
+
+    void reset() noexcept {
+        if (head_->prev) {
+            std::size_t total = 0;
+            for (Block* b = head_; b; b = b->prev) total += b->size;
+            releaseBlocks();
+            pushBlock(std::min(total, max_retained_));
+        }
+        ptr_ = head_->data();
+    }
+
+    std::size_t capacity() const noexcept {
+        std::size_t total = 0;
+        for (Block* b = head_; b; b = b->prev) total += b->size;
+        return total;
+    }
+
+protected:
+    void* do_allocate(std::size_t size, std::size_t align) override {
+        return take(size, align);
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const boost::json::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    struct Block {
+        Block* prev;
+        std::size_t size;
+
+        std::uintptr_t data() noexcept { return reinterpret_cast<std::uintptr_t>(this + 1); }
+    };
+
+    Block* head_ = nullptr;
+    std::uintptr_t ptr_ = 0;
+    std::uintptr_t end_ = 0;
+    std::size_t max_retained_;
+
+    static std::uintptr_t alignUp(std::uintptr_t p, std::size_t align) noexcept {
+        return (p + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1);
+    }
+
+    void pushBlock(std::size_t size) {
+        void* raw = std::malloc(sizeof(Block) + size);
+        if (!raw) throw std::bad_alloc();
+        head_ = new (raw) Block{ head_, size };
+        ptr_ = head_->data();
+        end_ = ptr_ + size;
+    }
+
+    void releaseBlocks() noexcept {
+        while (head_) {
+            Block* prev = head_->prev;
+            std::free(head_);
+            head_ = prev;
+        }
+    }
+};
+
+// JSON-контейнеры на арене не вызывают деструкторы элементов: всё освободит reset()
+template <>
+struct boost::json::is_deallocate_trivial<RequestArena> : std::true_type {};
+
+// STL-аллокатор поверх арены. Без арены (по умолчанию) — обычный new/delete,
+// так что тип запроса остаётся тем же и вне сессии.
+template <class T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    explicit ArenaAllocator(RequestArena* arena) noexcept : arena_(arena) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(std::size_t n) {
+        if (arena_) return static_cast<T*>(arena_->take(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        if (!arena_) ::operator delete(p);
+    }
+
+    RequestArena* arena() const noexcept { return arena_; }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena_ == other.arena(); }
+
+private:
+    RequestArena* arena_ = nullptr;
+};
+
+// storage_ptr для JSON, собираемого в рамках запроса (арена берётся из аллокатора заголовков)
+template <class T>
+boost::json::storage_ptr jsonStorage(const ArenaAllocator<T>& alloc) {
+    if (auto* arena = alloc.arena()) return boost::json::storage_ptr(arena);
+    return {};
+}
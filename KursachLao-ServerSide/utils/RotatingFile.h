@@ -0,0 +1,186 @@
+﻿#pragma once
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// Файл журнала с ротацией по размеру и возрасту (журнал доступа, трейсы).
+// Перед записью пачки проверяет пределы; при ротации текущий файл переименовывается
+// в <имя>.YYYYmmdd-HHMMSS (UTC), при совпадении имени — <имя>.YYYYmmdd-HHMMSS.N;
+// старые сверх keep_files удаляются (только файлы с таким суффиксом).
+// Время создания файла хранится рядом, в <имя>.created (секунды unix time): по нему считается
+// возраст и после перезапуска. mtime не годится — его сдвигает каждая запись.
+// Если переименовать не удалось, файл пишется дальше, следующая попытка — через kRetryDelay.
+// Не потокобезопасен: пишет один поток-писатель владельца.
+class RotatingFile {
+public:
+    struct Options {
+        std::filesystem::path path;
+        std::uint64_t max_bytes = 64ull * 1024 * 1024;      // Ротация по размеру
+        std::chrono::hours max_age{ 24 };                   // и по возрасту файла
+        unsigned keep_files = 5;                            // Сколько старых файлов хранить
+    };
+
+    static constexpr std::chrono::minutes kRetryDelay{ 1 };
+
+    explicit RotatingFile(Options options) : options_(std::move(options)) {}
+
+    const Options& options() const { return options_; }
+
+    bool open() {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        if (options_.path.has_parent_path()) {
+            fs::create_directories(options_.path.parent_path(), ec);
+        }
+        file_.open(options_.path, std::ios::binary | std::ios::app);
+        const auto size = fs::file_size(options_.path, ec);
+        file_bytes_ = ec ? 0 : size;
+
+        // Новый или пустой файл начинает отсчёт возраста заново; без метки (журнал прошлых
+        // версий) — тоже, метка появится сейчас
+        const auto now = std::chrono::system_clock::now();
+        if (file_bytes_ == 0 || !readCreated(opened_)) {
+            opened_ = now;
+            writeCreated(opened_);
+        }
+        opened_ = std::min(opened_, now);
+        return static_cast<bool>(file_);
+    }
+
+    // Пачка целиком — одна запись в файл
+    void write(std::string_view batch) {
+        rotateIfNeeded();
+        file_.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+        file_bytes_ += batch.size();
+    }
+
+    void flush() { file_.flush(); }
+    void close() { file_.close(); }
+
+private:
+    Options options_;
+    std::ofstream file_;
+    std::uint64_t file_bytes_ = 0;
+    std::chrono::system_clock::time_point opened_{};
+    std::chrono::system_clock::time_point retry_at_{};   // До этого момента ротацию не пробуем
+
+    std::filesystem::path createdPath() const { return options_.path.string() + ".created"; }
+
+    bool readCreated(std::chrono::system_clock::time_point& out) const {
+        std::ifstream in(createdPath());
+        long long seconds = 0;
+        if (!(in >> seconds) || seconds <= 0) return false;
+        out = std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+        return true;
+    }
+
+    void writeCreated(std::chrono::system_clock::time_point created) const {
+        std::ofstream out(createdPath(), std::ios::trunc);
+        out << std::chrono::duration_cast<std::chrono::seconds>(created.time_since_epoch()).count() << '\n';
+    }
+
+    // Суффикс имени после "<имя>.", который даёт ротация: YYYYmmdd-HHMMSS[.N].
+    // Номер N (0 — без него); nullopt — файл не наш (access.log.gz, access.log.bak ...)
+    static std::optional<unsigned> rotatedSequence(std::string_view suffix) {
+        constexpr std::size_t kStamp = 15;
+        if (suffix.size() < kStamp) return std::nullopt;
+        for (std::size_t i = 0; i < kStamp; ++i) {
+            const bool ok = i == 8 ? suffix[i] == '-' : (suffix[i] >= '0' && suffix[i] <= '9');
+            if (!ok) return std::nullopt;
+        }
+        if (suffix.size() == kStamp) return 0u;
+        if (suffix[kStamp] != '.' || suffix.size() == kStamp + 1) return std::nullopt;
+        unsigned seq = 0;
+        const auto digits = suffix.substr(kStamp + 1);
+        auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), seq);
+        if (ec != std::errc{} || end != digits.data() + digits.size()) return std::nullopt;
+        return seq;
+    }
+
+    void rotateIfNeeded() {
+        namespace fs = std::filesystem;
+        const auto now = std::chrono::system_clock::now();
+        if (file_bytes_ < options_.max_bytes && now - opened_ < options_.max_age) {
+            return;
+        }
+        if (now < retry_at_) {
+            return;
+        }
+
+        file_.close();
+
+        // access.log -> access.log.20260101-120000
+        const auto t = std::chrono::system_clock::to_time_t(now);
+        std::tm tm{};
+#ifdef _WIN32
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        char suffix[48];
+        std::snprintf(suffix, sizeof suffix, ".%04d%02d%02d-%02d%02d%02d",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        // Две ротации в одну секунду (или часы назад) — не затираем прошлый файл
+        std::string rotated_name = options_.path.string() + suffix;
+        std::error_code ec;
+        for (unsigned seq = 1; fs::exists(rotated_name, ec); ++seq) {
+            rotated_name = options_.path.string() + suffix + "." + std::to_string(seq);
+        }
+        fs::rename(options_.path, fs::path(rotated_name), ec);
+        if (ec) {
+            // Иначе каждая следующая пачка снова пробует, пишет предупреждение и обходит каталог
+            LOG_WARN("RotatingFile: rotation of " << options_.path.string() << " failed: " << ec.message()
+                << ", retrying in " << kRetryDelay.count() << " min");
+            retry_at_ = now + kRetryDelay;
+            open();
+            return;
+        }
+
+        removeOldFiles();
+        open();
+    }
+
+    // Старые файлы сверх keep_files удаляем: по метке времени, при равной — по номеру
+    void removeOldFiles() {
+        namespace fs = std::filesystem;
+        struct Rotated {
+            std::string stamp;
+            unsigned seq;
+            fs::path path;
+        };
+
+        std::error_code ec;
+        const auto dir = options_.path.has_parent_path() ? options_.path.parent_path() : fs::path(".");
+        const std::string prefix = options_.path.filename().string() + ".";
+        std::vector<Rotated> rotated;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            const auto name = entry.path().filename().string();
+            if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+            const std::string_view suffix = std::string_view(name).substr(prefix.size());
+            if (auto seq = rotatedSequence(suffix)) {
+                rotated.push_back({ std::string(suffix.substr(0, 15)), *seq, entry.path() });
+            }
+        }
+        if (rotated.size() <= options_.keep_files) return;
+
+        std::sort(rotated.begin(), rotated.end(), [](const Rotated& a, const Rotated& b) {
+            return a.stamp != b.stamp ? a.stamp < b.stamp : a.seq < b.seq;
+        });
+        for (std::size_t i = 0; i + options_.keep_files < rotated.size(); ++i) {
+            fs::remove(rotated[i].path, ec);
+        }
+    }
+};
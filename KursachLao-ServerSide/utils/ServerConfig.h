@@ -3,10 +3,16 @@
 //Всё это - временное решение навайбкоженное за 3 минуты
 #pragma once
 
+#include "RateLimit.h"
+#include "Logger.h"
+
 #include <boost/program_options.hpp>
+#include <array>
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace fs = std::filesystem;
 namespace po = boost::program_options;
@@ -15,10 +21,44 @@ struct ServerConfig {
     std::string address = "0.0.0.0";
     int         port = 8080;
     std::string directory = "static";
+    int         group_commit_us = 0;      // Окно группового коммита, 0 — выключен
+    int         group_commit_max = 64;    // Максимум операций в одной транзакции
+
+    // Лимиты "токенов в секунду:запас" на IP, 0 — без ограничений
+    RateLimit   connection_limit{ 100.0 / 60, 100 };
+    std::array<RateLimit, kRouteClassCount> route_limits{ {
+        { 50, 200 },   // static
+        { 20, 60 },    // api-read
+        { 5, 20 },     // api-write
+    } };
+    int         max_connections_per_ip = 32;    // Одновременных соединений с IP, 0 — без ограничения
+    std::vector<std::string> allow_cidrs;       // Подсети без лимитов (мониторинг)
+    std::vector<std::string> deny_cidrs;        // Подсети, соединения с которых сразу закрываются
+    int         shed_lag_ms = 20;               // Цель задержки цикла событий для сброса нагрузки, 0 — не учитывать
+    int         shed_latency_ms = 200;          // Цель времени ответа API, 0 — не учитывать
+    LogLevel    log_level = LogLevel::Info;
+    std::string access_log;                     // Файл журнала доступа, пусто — выключен
+    int         access_log_max_mb = 64;         // Ротация по размеру
+    int         access_log_rotate_hours = 24;   // и по возрасту
+    int         access_log_keep = 5;            // Сколько старых файлов хранить
+    std::string trace_file;                     // Файл трейсов (OTLP/JSON), пусто — выключен
+    double      trace_sample = 0.01;            // Доля запросов с трейсом (входящий traceparent — всегда)
+    int         slow_request_ms = 500;          // Порог медленного запроса, 0 — не отслеживать
+    int         slow_query_ms = 100;            // Порог медленного SQL-оператора, 0 — не отслеживать
+    RateLimit   slow_explain_rate{ 0.1, 3 };    // EXPLAIN медленных операторов, 0 — без планов
+    int         slow_log_size = 64;             // Записей в /admin/slow, 0 — журнал выключен
+    int         stall_threshold_ms = 200;       // Зависание цикла событий для /admin/stalls, 0 — сторож выключен
+    std::string admin_address = "127.0.0.1";    // Слушатель admin API
+    int         admin_port = 0;                 // 0 — admin API выключен
+    std::string admin_token;                    // Bearer-токен admin API (или KURSACH_ADMIN_TOKEN)
 
     // Метод для парсинга и валидации аргументов
     static ServerConfig parse(int argc, char* argv[]) {
         ServerConfig config;
+        std::string connection_limit = "1.67:100";
+        std::array<std::string, kRouteClassCount> route_limits = { "50:200", "20:60", "5:20" };
+        std::string log_level = "info";
+        std::string slow_explain_rate = "0.1:3";
 
         po::options_description desc("Available options");
         desc.add_options()
@@ -28,7 +68,59 @@ struct ServerConfig {
             ("port,p", po::value<int>(&config.port)->default_value(8080),
                 "Port to listen on")
             ("directory,d", po::value<std::string>(&config.directory)->default_value("static"),
-                "Path to static files directory");
+                "Path to static files directory")
+            ("group-commit-us", po::value<int>(&config.group_commit_us)->default_value(0),
+                "Group commit window for small writes in microseconds (0 = disabled)")
+            ("group-commit-max", po::value<int>(&config.group_commit_max)->default_value(64),
+                "Max writes per group commit transaction")
+            ("limit-connections", po::value<std::string>(&connection_limit)->default_value(connection_limit),
+                "New connections per IP, rate:burst per second (0 = unlimited)")
+            ("limit-static", po::value<std::string>(&route_limits[0])->default_value(route_limits[0]),
+                "Static file requests per IP, rate:burst per second")
+            ("limit-api-read", po::value<std::string>(&route_limits[1])->default_value(route_limits[1]),
+                "API GET requests per IP, rate:burst per second")
+            ("limit-api-write", po::value<std::string>(&route_limits[2])->default_value(route_limits[2]),
+                "API write requests per IP, rate:burst per second")
+            ("max-connections-per-ip", po::value<int>(&config.max_connections_per_ip)->default_value(32),
+                "Max simultaneously open connections per IP (0 = unlimited)")
+            ("allow-cidr", po::value<std::vector<std::string>>(&config.allow_cidrs)->multitoken(),
+                "Subnets exempt from limits, e.g. 10.0.0.0/8 (repeatable)")
+            ("deny-cidr", po::value<std::vector<std::string>>(&config.deny_cidrs)->multitoken(),
+                "Subnets to refuse connections from (repeatable)")
+            ("shed-lag-ms", po::value<int>(&config.shed_lag_ms)->default_value(20),
+                "Event loop lag target for load shedding in ms (0 = ignore)")
+            ("shed-latency-ms", po::value<int>(&config.shed_latency_ms)->default_value(200),
+                "API response time target for load shedding in ms (0 = ignore)")
+            ("log-level", po::value<std::string>(&log_level)->default_value(log_level),
+                "Minimum log level: debug, info, warn, error")
+            ("access-log", po::value<std::string>(&config.access_log)->default_value(""),
+                "Access log file (JSON lines), empty = disabled")
+            ("access-log-max-mb", po::value<int>(&config.access_log_max_mb)->default_value(64),
+                "Rotate the access log when it grows past this size")
+            ("access-log-rotate-hours", po::value<int>(&config.access_log_rotate_hours)->default_value(24),
+                "Rotate the access log at least this often")
+            ("access-log-keep", po::value<int>(&config.access_log_keep)->default_value(5),
+                "Number of rotated access log files to keep")
+            ("trace-file", po::value<std::string>(&config.trace_file)->default_value(""),
+                "Write request traces as OTLP/JSON lines to this file, empty = disabled")
+            ("trace-sample", po::value<double>(&config.trace_sample)->default_value(0.01, "0.01"),
+                "Fraction of requests to trace (0..1); sampled incoming traceparent is always traced")
+            ("slow-request-ms", po::value<int>(&config.slow_request_ms)->default_value(500),
+                "Record requests slower than this in /admin/slow (0 = off)")
+            ("slow-query-ms", po::value<int>(&config.slow_query_ms)->default_value(100),
+                "Record SQL statements slower than this in /admin/slow (0 = off)")
+            ("slow-explain-rate", po::value<std::string>(&slow_explain_rate)->default_value(slow_explain_rate),
+                "EXPLAIN of slow statements on a side connection, rate:burst per second (0 = no plans)")
+            ("slow-log-size", po::value<int>(&config.slow_log_size)->default_value(64),
+                "Number of entries kept for /admin/slow (0 = disabled)")
+            ("stall-threshold-ms", po::value<int>(&config.stall_threshold_ms)->default_value(200),
+                "Report event loop stalls longer than this in /admin/stalls (0 = off)")
+            ("admin-address", po::value<std::string>(&config.admin_address)->default_value("127.0.0.1"),
+                "IP address for the admin API listener")
+            ("admin-port", po::value<int>(&config.admin_port)->default_value(0),
+                "Port for the admin API (0 = disabled)")
+            ("admin-token", po::value<std::string>(&config.admin_token)->default_value(""),
+                "Bearer token for the admin API; defaults to $KURSACH_ADMIN_TOKEN");
 
         po::variables_map vm;
         try {
@@ -46,6 +138,69 @@ struct ServerConfig {
                 std::exit(EXIT_FAILURE);
             }
 
+            if (config.group_commit_us < 0 || config.group_commit_max <= 0) {
+                std::cerr << "Error: group commit window must be >= 0 and max writes > 0\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            auto parseLimit = [](const std::string& text, const char* option) {
+                auto limit = RateLimit::parse(text);
+                if (!limit) {
+                    std::cerr << "Error: --" << option << " must look like rate:burst (e.g. 20:60)\n";
+                    std::exit(EXIT_FAILURE);
+                }
+                return *limit;
+            };
+            config.connection_limit = parseLimit(connection_limit, "limit-connections");
+            config.route_limits[0] = parseLimit(route_limits[0], "limit-static");
+            config.route_limits[1] = parseLimit(route_limits[1], "limit-api-read");
+            config.route_limits[2] = parseLimit(route_limits[2], "limit-api-write");
+            config.slow_explain_rate = parseLimit(slow_explain_rate, "slow-explain-rate");
+
+            if (config.max_connections_per_ip < 0) {
+                std::cerr << "Error: max-connections-per-ip must be >= 0\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (!Logger::parseLevel(log_level, config.log_level)) {
+                std::cerr << "Error: log-level must be one of debug, info, warn, error\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.access_log_max_mb <= 0 || config.access_log_rotate_hours <= 0 || config.access_log_keep < 0) {
+                std::cerr << "Error: access log size and rotation interval must be > 0, keep >= 0\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.trace_sample < 0.0 || config.trace_sample > 1.0) {
+                std::cerr << "Error: trace-sample must be in the range 0-1\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.slow_request_ms < 0 || config.slow_query_ms < 0 || config.slow_log_size < 0
+                || config.stall_threshold_ms < 0) {
+                std::cerr << "Error: slow log and stall thresholds and size must be >= 0\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.admin_port < 0 || config.admin_port > 65535 || config.admin_port == config.port) {
+                std::cerr << "Error: admin-port must be in the range 0-65535 and differ from port\n";
+                std::exit(EXIT_FAILURE);
+            }
+            // Токен в командной строке виден в ps — лучше через переменную окружения
+            if (config.admin_token.empty()) {
+                if (const char* token = std::getenv("KURSACH_ADMIN_TOKEN")) config.admin_token = token;
+            }
+            if (config.admin_port > 0 && config.admin_token.size() < 16) {
+                std::cerr << "Error: admin API needs a token of at least 16 characters (--admin-token or KURSACH_ADMIN_TOKEN)\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.shed_lag_ms < 0 || config.shed_latency_ms < 0) {
+                std::cerr << "Error: load shedding targets must be >= 0\n";
+                std::exit(EXIT_FAILURE);
+            }
+
             // Проверка существования директории (не критично, только предупреждение)
             if (!fs::exists(config.directory)) {
                 std::cerr << "Warning: directory '" << config.directory << "' does not exist\n";
@@ -61,7 +216,17 @@ struct ServerConfig {
         std::cout << "Server configuration:\n"
             << " Address: " << config.address << "\n"
             << " Port: " << config.port << "\n"
-            << " Directory: " << config.directory << "\n\n";
+            << " Directory: " << config.directory << "\n"
+            << " Group commit: " << (config.group_commit_us > 0
+                ? std::to_string(config.group_commit_us) + " us / " + std::to_string(config.group_commit_max) + " writes"
+                : std::string("off")) << "\n"
+            << " Rate limits: connections " << connection_limit
+            << ", static " << route_limits[0]
+            << ", api-read " << route_limits[1]
+            << ", api-write " << route_limits[2] << "\n"
+            << " Connections per IP: " << (config.max_connections_per_ip > 0
+                ? std::to_string(config.max_connections_per_ip) : std::string("unlimited"))
+            << ", allow " << config.allow_cidrs.size() << " / deny " << config.deny_cidrs.size() << " subnets\n\n";
 
         return config;
     }
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#if defined(__linux__)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#endif
+
+// Символизация адресов стека прямо в процессе (профиль, сторож цикла событий).
+// dladdr видит только динамическую таблицу символов: имена функций самого сервера
+// доступны благодаря ENABLE_EXPORTS (-rdynamic), static-функции остаются "модуль+смещение".
+class StackTrace {
+public:
+    // return_address — адрес возврата (все кадры, кроме прерванного): он указывает на инструкцию
+    // после call, которая может принадлежать уже следующей функции
+    static std::string symbolize(void* pc, bool return_address) {
+        void* addr = return_address ? static_cast<char*>(pc) - 1 : pc;
+        char buf[32];
+#if defined(__linux__)
+        Dl_info info{};
+        if (::dladdr(addr, &info) && info.dli_sname) {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+            std::free(demangled);
+            return name;
+        }
+        // Без имени: модуль+смещение, как у perf
+        if (info.dli_fname && info.dli_fbase) {
+            std::string name = info.dli_fname;
+            name = name.substr(name.find_last_of('/') + 1);
+            std::snprintf(buf, sizeof buf, "+0x%zx",
+                static_cast<size_t>(static_cast<char*>(addr) - static_cast<char*>(info.dli_fbase)));
+            return name + buf;
+        }
+#endif
+        std::snprintf(buf, sizeof buf, "0x%zx", reinterpret_cast<size_t>(addr));
+        return buf;
+    }
+};
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "LambdaSenders.h"
+#include "RequestArena.h"
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/program_options.hpp>
@@ -9,8 +10,12 @@
 using file_body = boost::beast::http::file_body;
 using string_body = boost::beast::http::string_body;
 
+// Запрос с телом и заголовками на арене сессии (RequestArena); без арены — обычная куча
+using arena_fields = boost::beast::http::basic_fields<ArenaAllocator<char>>;
+using arena_string_body = boost::beast::http::basic_string_body<char, std::char_traits<char>, ArenaAllocator<char>>;
+
 using fRequest = boost::beast::http::request<file_body>;
-using sRequest = boost::beast::http::request<string_body>;
+using sRequest = boost::beast::http::request<arena_string_body, arena_fields>;
 
 using fResponce = boost::beast::http::response<file_body>;
 using sResponce = boost::beast::http::response<string_body>;
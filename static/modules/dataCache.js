@@ -1,4 +1,86 @@
-﻿class DataCache {
+﻿// Декодер MessagePack (подмножество, которое отдаёт сервер: nil, bool, int/uint, float32/64, str, array, map)
+function decodeMsgPack(buffer) {
+    const view = new DataView(buffer);
+    const bytes = new Uint8Array(buffer);
+    const utf8 = new TextDecoder();
+    let pos = 0;
+
+    const str = (len) => {
+        const s = utf8.decode(bytes.subarray(pos, pos + len));
+        pos += len;
+        return s;
+    };
+    const arr = (len) => {
+        const out = new Array(len);
+        for (let i = 0; i < len; i++) out[i] = read();
+        return out;
+    };
+    const map = (len) => {
+        const out = {};
+        for (let i = 0; i < len; i++) {
+            const key = read();
+            out[key] = read();
+        }
+        return out;
+    };
+    const u64 = (signed) => {
+        const v = signed ? view.getBigInt64(pos) : view.getBigUint64(pos);
+        pos += 8;
+        return Number(v);
+    };
+
+    function read() {
+        const b = bytes[pos++];
+        if (b <= 0x7f) return b;
+        if (b >= 0xe0) return b - 0x100;
+        if ((b & 0xe0) === 0xa0) return str(b & 0x1f);
+        if ((b & 0xf0) === 0x90) return arr(b & 0x0f);
+        if ((b & 0xf0) === 0x80) return map(b & 0x0f);
+
+        let v;
+        switch (b) {
+            case 0xc0: return null;
+            case 0xc2: return false;
+            case 0xc3: return true;
+            case 0xca: v = view.getFloat32(pos); pos += 4; return v;
+            case 0xcb: v = view.getFloat64(pos); pos += 8; return v;
+            case 0xcc: return bytes[pos++];
+            case 0xcd: v = view.getUint16(pos); pos += 2; return v;
+            case 0xce: v = view.getUint32(pos); pos += 4; return v;
+            case 0xcf: return u64(false);
+            case 0xd0: return view.getInt8(pos++);
+            case 0xd1: v = view.getInt16(pos); pos += 2; return v;
+            case 0xd2: v = view.getInt32(pos); pos += 4; return v;
+            case 0xd3: return u64(true);
+            case 0xd9: return str(bytes[pos++]);
+            case 0xda: v = view.getUint16(pos); pos += 2; return str(v);
+            case 0xdb: v = view.getUint32(pos); pos += 4; return str(v);
+            case 0xdc: v = view.getUint16(pos); pos += 2; return arr(v);
+            case 0xdd: v = view.getUint32(pos); pos += 4; return arr(v);
+            case 0xde: v = view.getUint16(pos); pos += 2; return map(v);
+            case 0xdf: v = view.getUint32(pos); pos += 4; return map(v);
+            default: throw new Error(`Unsupported MessagePack type 0x${b.toString(16)}`);
+        }
+    }
+
+    return read();
+}
+
+// Колоночный вид коллекции (?layout=columnar): {layout, fields, types, rows, columns: [[...], ...]}
+// разворачивается обратно в массив объектов. Обычный массив возвращается как есть.
+function rowsFromColumnar(collection) {
+    if (!collection || collection.layout !== 'columnar') return collection;
+    const { fields, columns, rows } = collection;
+    const out = new Array(rows);
+    for (let r = 0; r < rows; r++) {
+        const item = {};
+        for (let c = 0; c < fields.length; c++) item[fields[c]] = columns[c][r];
+        out[r] = item;
+    }
+    return out;
+}
+
+class DataCache {
     constructor(options = {}) {
         this.storageKey = options.storageKey || 'hr_data_cache_v1';
         this.cache = {
@@ -13,6 +95,10 @@
         this.apiBaseUrl = options.apiBaseUrl || '/api';
         this.enablePersistence = typeof options.enablePersistence === 'boolean' ? options.enablePersistence : true;
         this.isOfflineMode = false; // Новый флаг для оффлайн-режима
+        // Бинарные ответы (MessagePack) для GET — меньше трафика и быстрее разбор all-data
+        this.useMsgPack = options.useMsgPack === true;
+        // Коллекции в колоночном виде — имена полей не повторяются в каждой строке
+        this.useColumnar = options.useColumnar === true;
 
         this._loadFromStorage();
     }
@@ -61,6 +147,7 @@
         try {
             const url = `${this.apiBaseUrl}${path}`;
             const headers = { 'Content-Type': 'application/json' };
+            if (this.useMsgPack) headers['Accept'] = 'application/msgpack, application/json;q=0.9';
             // Placeholder for future auth
             // headers['Authorization'] = 'Bearer ' + localStorage.getItem('authToken');
 
@@ -81,7 +168,11 @@
                 throw error;
             }
 
-            const data = await res.json();
+            // Сервер может ответить JSON и на запрос msgpack (ошибки, списки) — смотрим Content-Type
+            const contentType = res.headers.get('Content-Type') || '';
+            const data = contentType.includes('msgpack')
+                ? decodeMsgPack(await res.arrayBuffer())
+                : await res.json();
 
             if (data.lastUpdated && new Date(data.lastUpdated) > new Date(this.cache.lastUpdated || 0)) {
                 this.cache.lastUpdated = data.lastUpdated;
@@ -103,6 +194,8 @@
 
     setOptions(opts = {}) {
         if (typeof opts.apiBaseUrl === 'string') this.apiBaseUrl = opts.apiBaseUrl;
+        if (typeof opts.useMsgPack === 'boolean') this.useMsgPack = opts.useMsgPack;
+        if (typeof opts.useColumnar === 'boolean') this.useColumnar = opts.useColumnar;
         if (typeof opts.enablePersistence === 'boolean') this.enablePersistence = opts.enablePersistence;
         if (opts.storageKey) this.storageKey = opts.storageKey;
         this._saveToStorage();
@@ -115,8 +208,11 @@
         }
 
         try {
-            const serverData = await this._syncToServer('GET', '/all-data');
+            const serverData = await this._syncToServer('GET', this.useColumnar ? '/all-data?layout=columnar' : '/all-data');
             if (serverData) {
+                for (const key of ['employees', 'hours', 'penalties', 'bonuses']) {
+                    serverData[key] = rowsFromColumnar(serverData[key]);
+                }
                 this.cache = { ...this.cache, ...serverData };
                 this._markUpdated();
                 return this.cache;
@@ -160,6 +256,24 @@
     }
 
     async getDashboardData() {
+        return this.fetchDashboard();
+    }
+
+    // Только сводка (/api/dashboard) — сервер отдаёт одну готовую строку, таблицы не качаем.
+    // Без _markUpdated: иначе подписчики dataCache:updated снова запросят сводку.
+    async fetchDashboard() {
+        try {
+            const dashboard = await this._syncToServer('GET', '/dashboard');
+            if (dashboard) {
+                this.cache.dashboard = dashboard;
+                this._saveToStorage();
+                return dashboard;
+            }
+        } catch (err) {
+            // Сеть недоступна — ниже вернём то, что есть локально
+        }
+
+        if (this.cache.dashboard) return this.cache.dashboard;
         await this.fetchAllData();
         return this.cache.dashboard;
     }
@@ -174,6 +288,26 @@
         return this.cache.hours.find(h => h.employeeId === employeeId) || { employeeId, regularHours: 0, overtime: 0, undertime: 0 };
     }
 
+    // Постраничная выборка одного ресурса (/api/<resource>?after_id=&limit=&fields=).
+    // В отличие от fetchAllData тянет только нужные колонки и строки.
+    async fetchList(resource, { fields = null, filters = {}, limit = 500 } = {}) {
+        const items = [];
+        let afterId = 0;
+        for (;;) {
+            const params = new URLSearchParams({ after_id: afterId, limit });
+            if (fields) params.set('fields', fields.join(','));
+            for (const [key, value] of Object.entries(filters)) params.set(key, value);
+            if (this.useColumnar) params.set('layout', 'columnar');
+
+            const page = await this._syncToServer('GET', `/${resource}?${params}`);
+            if (!page) throw new Error(`Failed to fetch ${resource}`); // оффлайн — пусть вызывающий возьмёт кэш
+            items.push(...rowsFromColumnar(page.items));
+            if (page.nextAfterId === null || page.nextAfterId === undefined) break;
+            afterId = page.nextAfterId;
+        }
+        return items;
+    }
+
     // ---------- CRUD operations with proper error propagation ----------
     async addEmployee(employeeData) {
         const payloadForServer = {